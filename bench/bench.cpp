@@ -0,0 +1,2216 @@
+// bench.cpp
+// 功能：在 Linux 上回放拖入轨迹，压测小窗的可移植热路径（relay_core.h / relay_sort.h）
+// - ingest：旧的 WM_DROPFILES 落地（按 DragQueryFileW 的方式逐个按下标取路径进 MAX_PATH 缓冲 + PathList::Add）；
+//   ingest/direct：现在的做法，relay_drop.h 一次线性解析 DROPFILES 块，块内指针直接 Add
+// - drop/*：拖入解析。先对拍 CF_HDROP（宽/窄、UTF-16、超长路径）与 Shell IDList（CIDA）的往返，
+//   再把截断、改坏的块和随机字节喂给解析器（配合 -fsanitize=address 查越界）；
+//   drop/hdrop、drop/idlist 为 1 万项的解析吞吐
+// - idle/*：空闲判定。先用注入的时间戳对照 IdleTracker（进入空闲、忙时推迟、唤醒后重新计时）与
+//   CompactPolicy 两个阈值两侧的判定；idle/poll 为定时器每次的判定开销
+// - list/compact：空闲模式下的列表收缩；list/footprint 一行给出收缩前后字节数与旧定长槽位的对比
+// - zip/*：拖出 ZIP 的流式生成（deflate 单线程 / 多线程、store、auto 混合），zip/size 给出压缩率；
+//   先校验 deflate 输出上界与 4G 边界两侧的 ZIP64 判定；
+//   --zip-out 把 auto 混合的归档写到文件，可用 unzip -t / zipinfo 校验
+// - exec/*：后台执行器。先做混合优先级 + 嵌套提交 + 随机取消的对照检查；exec/roundtrip 为提交到
+//   完成回调回到界面线程的整圈，exec/batching 给出每批完成回调个数，exec/fanout + exec/steal 为
+//   工作线程内派生子任务时的偷取，exec/latency 为批量任务占满时交互任务的起跑延迟
+// - history/*：撤销历史（持久化向量）。先拿 std::vector 做随机操作对照（含旧版本不被改动）；
+//   在 10 万项列表上测追加 1 项、删 1 项、清空、撤销/重做、按版本恢复列表的耗时与每步分配字节；
+//   history/footprint 给出 depth 步历史去重后的节点字节与整表拷贝的对比
+// - http/*：内置 HTTP 共享走回环压测。先校验索引页、整文件、Range、后缀 Range、416、坏 token、
+//   单连接 2 万个流水线请求、Stop 后再 Start 不沿用旧快照；
+//   http/large/sendfile 与 http/large/copy 比较零拷贝与 read + send 的吞吐；
+//   http/small/cN 用 N 个 keep-alive 连接（poll 驱动）反复取小文件，给出 req/s 与延迟分位数
+// - startup/*：冷启动计时。先拿参照实现对拍 FindSwitch（固定用例 + 随机命令行），Format/ParseStartupLine 往返，
+//   再把随机字节与截断/改坏的记录喂给解析器；startup/mark、startup/format、startup/switch 为打点与解析开销；
+//   --startup-log 汇总 main.cpp --trace-startup 写下的记录（首帧、就绪与各阶段耗时的分位数）
+// - dataobject/build：拖出列表拼装；dataobject/getdata：DROPFILES 块序列化
+// - tip/text：BuildTipText（不分组 / 按文件夹分组）；tip/layout：TipHeight + PlaceTipAboveTaskbar
+// - ini/load：DecodeIniBytes + IniDoc 解析 + LoadIniStyle 的全部键查找
+// - sort/full、sort/append：全量排序与 Ctrl 追加归并（先对拍增量归并与全量排序、相邻项的自然序）；
+//   sort/grouped：tip 按文件夹分组的顺序（first 含建分组表）
+//
+// 轨迹：内置合成轨迹（10 / 1k / 100k 文件 × 短 / 长路径，每条为一次覆盖拖入 + 一次 Ctrl 追加），
+//       或用 --trace 回放 main.cpp 通过 [debug] drop_trace 记录下来的文件
+// 输出：每项一行 JSON —— 吞吐、单次耗时分位数（微秒）、每次迭代的分配次数/字节
+//
+// 编译（Linux）:
+// g++ -std=c++17 -O2 -pthread bench/bench.cpp -o relay_bench
+// 运行：./relay_bench [--filter 子串] [--trace 文件]... [--ini config.ini] [--max-count N] [--iters N] [--zip-out 文件]
+//                    [--startup-log 文件]...
+
+#include "../relay_core.h"
+#include "../relay_drop.h"
+#include "../relay_exec.h"
+#include "../relay_history.h"
+#include "../relay_httpd.h"
+#include "../relay_idle.h"
+#include "../relay_list.h"
+#include "../relay_startup.h"
+#include "../relay_zip.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// ---------------- allocation counting ----------------
+// 计数用的全局 operator new/delete 基于 malloc/free；GCC 内联后会误报 new/free 不配对
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<uint64_t> g_allocCount{0};
+static std::atomic<uint64_t> g_allocBytes{0};
+
+void* operator new(size_t n) {
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(n, std::memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+// ---------------- options ----------------
+static const int APP_MAX_PATH = 260;   // 旧的 WM_DROPFILES 取路径缓冲（ingest 基线）
+static const int APP_HARD_MAX = 100;   // max_count 默认值（即旧的 HARD_MAX）
+
+struct Options {
+    const char* filter = nullptr;
+    std::vector<const char*> traces;
+    const char* ini = nullptr;
+    int maxCount = APP_HARD_MAX;
+    int iters = 0;                      // 0 = 自动（约 0.3s，至少 3 次）
+    const char* zipOut = nullptr;
+    std::vector<const char*> startupLogs;
+} g_opt;
+
+// ---------------- traces ----------------
+struct Drop {
+    bool append;
+    std::vector<std::wstring> paths;
+};
+
+struct Trace {
+    std::string name;
+    std::vector<Drop> drops;
+    size_t files = 0;
+};
+
+// 合成路径：多级目录、混合扩展名、名称带数字；long 版本目录层级接近 MAX_PATH
+static std::wstring SyntheticPath(std::mt19937& rng, bool longPath) {
+    static const wchar_t* const exts[] = { L"txt", L"PNG", L"jpg", L"docx", L"zip", L"" };
+    const wchar_t* ext = exts[rng() % 6];
+    wchar_t buf[512];
+    if (longPath) {
+        swprintf(buf, 512,
+                 L"D:\\Projects\\customer-deliverables\\2024-Q%u\\region-%u\\shared-assets\\"
+                 L"high-resolution-renders\\batch-%04u\\approved-for-release\\"
+                 L"Final_Report_%u_revision_%u_with_annotations%ls%ls",
+                 rng() % 4 + 1, rng() % 12, rng() % 2000, rng() % 5000, rng() % 30,
+                 *ext ? L"." : L"", ext);
+    } else {
+        swprintf(buf, 512, L"C:\\Users\\dev\\Desktop\\IMG_%u%ls%ls", rng() % 100000,
+                 *ext ? L"." : L"", ext);
+    }
+    return buf;
+}
+
+static Trace SyntheticTrace(size_t files, bool longPath) {
+    Trace t;
+    char name[64];
+    snprintf(name, sizeof(name), "synthetic-%zu-%s", files, longPath ? "long" : "short");
+    t.name = name;
+
+    std::mt19937 rng((uint32_t)(files * 2 + longPath));
+    size_t extra = files / 10 ? files / 10 : 1;
+    t.drops.resize(2);
+    t.drops[0].append = false;
+    t.drops[1].append = true;
+    for (size_t i = 0; i < files; ++i) t.drops[0].paths.push_back(SyntheticPath(rng, longPath));
+    for (size_t i = 0; i < extra; ++i) t.drops[1].paths.push_back(SyntheticPath(rng, longPath));
+    t.files = files + extra;
+    return t;
+}
+
+// main.cpp 的轨迹格式："D <n>" / "A <n>" 后跟 n 行 UTF-8 路径
+static bool LoadTrace(const char* file, Trace& t) {
+    FILE* f = fopen(file, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> raw;
+    uint8_t chunk[65536];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0) raw.insert(raw.end(), chunk, chunk + got);
+    fclose(f);
+
+    std::wstring text;
+    if (!relay::DecodeIniBytes(raw.data(), raw.size(), text)) return false;
+
+    t.name = file;
+    size_t pos = 0, want = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find(L'\n', pos);
+        if (eol == std::wstring::npos) eol = text.size();
+        std::wstring line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+        if (!line.empty() && line.back() == L'\r') line.pop_back();
+
+        if (want == 0) {
+            if (line.size() < 3 || (line[0] != L'D' && line[0] != L'A')) continue;
+            Drop d;
+            d.append = (line[0] == L'A');
+            want = wcstoul(line.c_str() + 2, nullptr, 10);
+            t.drops.push_back(d);
+            continue;
+        }
+        t.drops.back().paths.push_back(line);
+        t.files++;
+        want--;
+    }
+    return !t.drops.empty();
+}
+
+// ---------------- emulated Win32 pieces ----------------
+// HDROP：DROPFILES + 双 0 结尾列表
+static std::vector<uint8_t> BuildHdrop(const Drop& d) {
+    std::vector<const wchar_t*> rows(d.paths.size());
+    std::vector<uint32_t> order(d.paths.size());
+    for (size_t i = 0; i < rows.size(); ++i) { rows[i] = d.paths[i].c_str(); order[i] = (uint32_t)i; }
+
+    size_t chars = relay::FileListChars(rows.data(), order.data(), (int)rows.size());
+    std::vector<wchar_t> list(chars);
+    chars = relay::WriteFileList(rows.data(), order.data(), (int)rows.size(), list.data());
+
+    std::vector<uint8_t> block(relay::DropFilesBytes(chars));
+    relay::WriteDropFiles(block.data(), list.data(), chars);
+    return block;
+}
+
+// DragQueryFileW 的代价模型：每次调用都从列表头走到第 index 个
+static unsigned QueryDropFile(const uint8_t* block, unsigned index, wchar_t* out, unsigned cch) {
+    const wchar_t* p = (const wchar_t*)(block + ((const relay::DropFilesHeader*)block)->pFiles);
+    unsigned i = 0;
+    while (*p) {
+        size_t len = wcslen(p);
+        if (i == index) {
+            if (!out) return (unsigned)len;
+            size_t n = len < cch ? len : cch - 1;
+            memcpy(out, p, n * sizeof(wchar_t));
+            out[n] = 0;
+            return (unsigned)n;
+        }
+        p += len + 1;
+        ++i;
+    }
+    return index == 0xFFFFFFFFu ? i : 0;
+}
+
+// WM_DROPFILES 的处理流程；返回实际加入的条数（cap 即 max_count）
+static size_t Ingest(relay::PathList& list, const uint8_t* hdrop, bool append, int cap) {
+    unsigned total = QueryDropFile(hdrop, 0xFFFFFFFFu, nullptr, 0);
+    if (!append) list.Clear();
+    size_t added = 0;
+    for (unsigned i = 0; i < total && list.Count() < cap; ++i) {
+        wchar_t path[APP_MAX_PATH];
+        unsigned n = QueryDropFile(hdrop, i, path, APP_MAX_PATH);
+        if (n > 0) { list.Add(path, n); ++added; }
+    }
+    return added;
+}
+
+// IDropTarget::Drop / WM_DROPFILES 现在的处理流程：一次解析，块内指针直接 Add
+static size_t IngestDirect(relay::PathList& list, const std::vector<uint8_t>& hdrop, bool append, int cap) {
+    if (!append) list.Clear();
+    relay::DropFilesView v;
+    if (!relay::ParseDropFilesHeader(hdrop.data(), hdrop.size(), v, sizeof(wchar_t))) return 0;
+    size_t added = 0;
+    relay::ForEachDropPath<wchar_t>(v.list, v.bytes, [&](const wchar_t* p, size_t n) {
+        if (list.Count() < cap) { list.Add(p, n); ++added; }
+        return list.Count() < cap;
+    });
+    return added;
+}
+
+// ---------------- measurement ----------------
+using Clock = std::chrono::steady_clock;
+
+static bool Selected(const std::string& name) {
+    return !g_opt.filter || name.find(g_opt.filter) != std::string::npos;
+}
+
+static double Percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0;
+    size_t i = (size_t)(q * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(i, sorted.size() - 1)];
+}
+
+// setup 不计时；fn 为被测的一次操作；items 用于换算吞吐
+template <class Setup, class Fn>
+static void Measure(const std::string& bench, const std::string& trace, size_t items, Setup setup, Fn fn) {
+    if (!Selected(bench + " " + trace)) return;
+
+    setup();
+    fn();   // warm-up
+
+    std::vector<double> samples;
+    uint64_t allocs = 0, bytes = 0;
+    double spent = 0;
+    for (int i = 0;; ++i) {
+        if (g_opt.iters > 0 ? i >= g_opt.iters : (i >= 3 && (spent > 0.3e9 || i >= 10000))) break;
+        setup();
+        uint64_t a0 = g_allocCount.load(), b0 = g_allocBytes.load();
+        auto t0 = Clock::now();
+        fn();
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+        allocs += g_allocCount.load() - a0;
+        bytes += g_allocBytes.load() - b0;
+        samples.push_back(ns);
+        spent += ns;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    double mean = spent / samples.size();
+    printf("{\"bench\":\"%s\",\"trace\":\"%s\",\"n\":%zu,\"iters\":%zu,"
+           "\"p50_us\":%.3f,\"p90_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,\"mean_us\":%.3f,"
+           "\"items_per_s\":%.0f,\"allocs_per_iter\":%.1f,\"alloc_bytes_per_iter\":%.0f}\n",
+           bench.c_str(), trace.c_str(), items, samples.size(),
+           Percentile(samples, 0.50) / 1e3, Percentile(samples, 0.90) / 1e3,
+           Percentile(samples, 0.99) / 1e3, samples.back() / 1e3, mean / 1e3,
+           mean > 0 ? items / (mean / 1e9) : 0.0,
+           (double)allocs / samples.size(), (double)bytes / samples.size());
+    fflush(stdout);
+}
+
+static void Nothing() {}
+
+// ---------------- sort check ----------------
+// 容易撞上前缀编码边界的路径：大小写 / 前导 0 不同的同名目录、长数字串、超过 16 单位的公共前缀、
+// 非 ASCII、无扩展名与 ".bashrc"；大小和时间取值很少，制造大量平手
+static std::wstring SortCheckPath(std::mt19937& rng) {
+    static const wchar_t* const dirs[] = {
+        L"C:\\a", L"C:\\A", L"C:\\dir1", L"C:\\dir01", L"C:\\dir10", L"C:\\d\u00e9j\u00e0", L"D:\\\u4e2d\u6587",
+        L"C:\\shared-prefix-longer-than-sixteen", L"C:\\x\\y\\z", L"", L"\\\\srv\\share"
+    };
+    static const wchar_t* const stems[] = {
+        L"file", L"File", L"file0", L"img_", L"report-final-version-", L"\u00e9t\u00e9", L"\u4e2d", L"", L"a.b"
+    };
+    static const wchar_t* const exts[] = { L".txt", L".TXT", L".png", L".tar.gz", L"", L".7z", L".01", L".1" };
+    std::wstring p = dirs[rng() % 11];
+    if (!p.empty()) p += L'\\';
+    if (rng() % 16 == 0) p += L".bashrc";
+    else {
+        p += stems[rng() % 9];
+        unsigned r = rng() % 4;
+        if (r == 1) p += std::to_wstring(rng() % 20);
+        else if (r == 2) p += L"000" + std::to_wstring(rng() % 200);
+        else if (r == 3) p += L"123456789012345678901234" + std::to_wstring(rng() % 3);
+        p += exts[rng() % 8];
+    }
+    if (p.empty() || p.back() == L'\\') p += L'x';
+    return p;
+}
+
+static int SortCheckGroupCompare(const wchar_t* a, const wchar_t* b, relay::GroupMode mode) {
+    relay::GroupRef ga = relay::GroupOf(a, mode);
+    relay::GroupRef gb = relay::GroupOf(b, mode);
+    return relay::NaturalCompareN(ga.p, ga.n, gb.p, gb.n);
+}
+
+// 相邻两项满足所选排序方式（主键平手时按文件名自然序）
+static bool SortCheckAdjacent(const std::vector<relay::SortItem>& items, const uint32_t* order, uint32_t n,
+                              relay::SortMode mode) {
+    for (uint32_t i = 0; i + 1 < n; ++i) {
+        const relay::SortItem& a = items[order[i]];
+        const relay::SortItem& b = items[order[i + 1]];
+        if (mode == relay::SORT_DROP) {
+            if (order[i] != i) return false;
+            continue;
+        }
+        int c = 0;
+        if (mode == relay::SORT_SIZE) c = a.size < b.size ? -1 : a.size > b.size;
+        else if (mode == relay::SORT_MTIME) c = a.mtime < b.mtime ? -1 : a.mtime > b.mtime;
+        else if (mode != relay::SORT_NAME) c = SortCheckGroupCompare(a.path, b.path, relay::GroupModeForSort(mode));
+        if (c > 0) return false;
+        if (c == 0 && relay::NaturalCompare(relay::NamePart(a.path), relay::NamePart(b.path)) > 0) return false;
+    }
+    return true;
+}
+
+// 随机列表上对照：Reset(n0) 后分几次 Append 与一次 Reset(n) 顺序相同；相邻项有序；
+// tip 分组顺序与按分组名稳定排序的参照一致（分组表在追加之间被用过，走增量维护）
+static bool CheckSortView() {
+    std::mt19937 rng(26);
+    relay::Executor exec(3);    // 全量排序走执行器分块，增量一侧不带执行器，两边对拍
+    for (int round = 0; round < 60; ++round) {
+        const uint32_t n = 1 + rng() % (round < 50 ? 400 : 12000);
+        std::vector<std::wstring> paths(n);
+        for (auto& p : paths) p = SortCheckPath(rng);
+        std::vector<relay::SortItem> items(n);
+        for (uint32_t i = 0; i < n; ++i) {
+            items[i] = relay::SortItem{paths[i].c_str(), rng() % 4, 132000000000000000ull + rng() % 3};
+        }
+
+        for (int m = 0; m < relay::SORT_MODE_COUNT; ++m) {
+            const relay::SortMode mode = (relay::SortMode)m;
+            relay::SortView full;
+            full.Reset(mode, items.data(), n, &exec);
+            if (full.Size() != n || !SortCheckAdjacent(items, full.Order(), n, mode)) return false;
+            std::vector<bool> seen(n);
+            for (uint32_t i = 0; i < n; ++i) {
+                uint32_t x = full.Order()[i];
+                if (x >= n || seen[x]) return false;
+                seen[x] = true;
+            }
+
+            relay::SortView inc;
+            uint32_t at = rng() % (n + 1);
+            inc.Reset(mode, items.data(), at);
+            std::vector<uint32_t> grouped;
+            while (at < n) {
+                at += 1 + rng() % (n - at);
+                inc.Append(items.data(), at);
+                if (rng() % 2) inc.GroupedOrder(items.data(), (relay::GroupMode)(1 + rng() % 2), grouped);
+            }
+            if (inc.Size() != n || !std::equal(full.Order(), full.Order() + n, inc.Order())) return false;
+
+            for (relay::GroupMode gm : {relay::GROUP_NONE, relay::GROUP_FOLDER, relay::GROUP_EXT}) {
+                inc.GroupedOrder(items.data(), gm, grouped);
+                std::vector<uint32_t> ref(inc.Order(), inc.Order() + n);
+                if (gm != relay::GROUP_NONE) {
+                    std::stable_sort(ref.begin(), ref.end(), [&](uint32_t a, uint32_t b) {
+                        return SortCheckGroupCompare(items[a].path, items[b].path, gm) < 0;
+                    });
+                }
+                if (grouped != ref) return false;
+            }
+        }
+    }
+
+    // 固定分 5 块对拍 std::sort（块数不是 2 的幂，归并有落单的块）
+    std::vector<uint64_t> v(50000), ref;
+    for (uint64_t& x : v) x = rng() % 1000 * 100000 + (&x - v.data());
+    ref = v;
+    std::sort(ref.begin(), ref.end());
+    std::vector<uint64_t> a = v;
+    relay::ParallelSort(a.data(), a.data() + a.size(), std::less<uint64_t>(), &exec, 5);
+    if (a != ref) return false;
+
+    // dock 的排序任务本身就在执行器上：单工作线程时在任务里再分块也不能等死
+    relay::Executor single(1);
+    std::vector<uint64_t> b = v;
+    std::mutex mu;
+    std::condition_variable cv;
+    bool done = false;
+    single.Submit(relay::PRIORITY_INTERACTIVE, [&] {
+        relay::ParallelSort(b.data(), b.data() + b.size(), std::less<uint64_t>(), &single, 4);
+        std::lock_guard<std::mutex> lock(mu);
+        done = true;
+        cv.notify_all();
+    });
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] { return done; });
+    return b == ref;
+}
+
+// ---------------- scenarios ----------------
+static void BenchTrace(const Trace& t) {
+    std::vector<std::vector<uint8_t>> hdrops;
+    for (const Drop& d : t.drops) hdrops.push_back(BuildHdrop(d));
+
+    // ingest：完整回放所有拖入。两条路径对比的是解析代价，上限放宽到 trace 的条数，
+    // 否则都在 max_count 处停下，旧路径却仍要为计数走完整个块；吞吐按实际加入的条数算。
+    // 旧路径逐条取是 O(n^2)，超过 LEGACY_INGEST_MAX 条的 trace 只测新路径
+    static const size_t LEGACY_INGEST_MAX = 5000;
+    relay::PathList list;
+    const int ingestCap = std::max(g_opt.maxCount, (int)t.files);
+    auto replay = [&](size_t (*ingest)(relay::PathList&, const std::vector<uint8_t>&, bool, int)) {
+        size_t added = 0;
+        for (size_t i = 0; i < t.drops.size(); ++i) added += ingest(list, hdrops[i], t.drops[i].append, ingestCap);
+        return added;
+    };
+    auto legacy = [](relay::PathList& l, const std::vector<uint8_t>& h, bool append, int cap) {
+        return Ingest(l, h.data(), append, cap);
+    };
+    if (t.files <= LEGACY_INGEST_MAX && Selected("ingest " + t.name))
+        Measure("ingest", t.name, replay(legacy), Nothing, [&] { replay(legacy); });
+    if (Selected("ingest/direct " + t.name))
+        Measure("ingest/direct", t.name, replay(IngestDirect), Nothing, [&] { replay(IngestDirect); });
+
+    // 回放后的列表状态（按 max_count 截断，与 dock 一致）
+    for (size_t i = 0; i < t.drops.size(); ++i) Ingest(list, hdrops[i].data(), t.drops[i].append, g_opt.maxCount);
+    const int count = list.Count();
+    std::vector<const wchar_t*> paths(count), names(count);
+    std::vector<uint32_t> order(count);
+    for (int i = 0; i < count; ++i) {
+        paths[i] = list.Path(i);
+        names[i] = list.Name(i);
+        order[i] = (uint32_t)i;
+    }
+
+    // 空闲收缩：每次先逐条 Add 重新长出富余容量（与拖入时的增长方式相同，省掉 O(i) 的取路径）
+    auto regrow = [&](relay::PathList& l) {
+        l = relay::PathList();
+        for (int i = 0; i < count; ++i) l.Add(paths[i]);
+    };
+    relay::PathList grown;
+    Measure("list/compact", t.name, count, [&] { regrow(grown); }, [&] { grown.Compact(); });
+
+    {
+        relay::PathList fp;
+        regrow(fp);
+        size_t reserved = fp.ReservedBytes();
+        relay::CompactPolicy policy;
+        bool compact = policy.ShouldCompact(reserved, fp.UsedBytes());
+        if (compact) fp.Compact();
+        // 旧实现：paths + names 两张 HARD_MAX x MAX_PATH 表 + sizes/mtimes
+        size_t slots = (size_t)g_opt.maxCount * (2 * APP_MAX_PATH * sizeof(wchar_t) + 2 * sizeof(uint64_t));
+        if (Selected("list/footprint " + t.name)) {
+            printf("{\"bench\":\"list/footprint\",\"trace\":\"%s\",\"n\":%d,"
+                   "\"used_bytes\":%zu,\"reserved_bytes\":%zu,\"idle_bytes\":%zu,\"compacted\":%s,"
+                   "\"fixed_slot_bytes\":%zu}\n",
+                   t.name.c_str(), count, fp.UsedBytes(), reserved, fp.ReservedBytes(),
+                   compact ? "true" : "false", slots);
+            fflush(stdout);
+        }
+    }
+
+    Measure("dataobject/build", t.name, count, Nothing, [&] {
+        size_t chars = relay::FileListChars(paths.data(), order.data(), count);
+        wchar_t* buf = new wchar_t[chars];
+        relay::WriteFileList(paths.data(), order.data(), count, buf);
+        delete[] buf;
+    });
+
+    size_t chars = relay::FileListChars(paths.data(), order.data(), count);
+    std::vector<wchar_t> fileList(chars);
+    chars = relay::WriteFileList(paths.data(), order.data(), count, fileList.data());
+    Measure("dataobject/getdata", t.name, count, Nothing, [&] {
+        uint8_t* block = new uint8_t[relay::DropFilesBytes(chars)];
+        relay::WriteDropFiles(block, fileList.data(), chars);
+        delete[] block;
+    });
+
+    static wchar_t tipText[16384];
+    for (relay::GroupMode gm : {relay::GROUP_NONE, relay::GROUP_FOLDER}) {
+        relay::TipInput in{};
+        in.paths = paths.data();
+        in.names = names.data();
+        in.order = order.data();
+        in.count = count;
+        in.groupMode = gm;
+        in.maxLines = 30;
+        Measure(gm == relay::GROUP_NONE ? "tip/text" : "tip/text/grouped", t.name, count, Nothing, [&] {
+            relay::BuildTipText(in, tipText, 16384);
+        });
+    }
+
+    // 排序：不受 max_count 限制，直接用轨迹里的全部路径
+    static const bool sortOk = !Selected("sort/") || CheckSortView();
+    if (!sortOk) {
+        fprintf(stderr, "sort precheck failed: append + merge differs from a full sort\n");
+        return;
+    }
+    std::vector<relay::SortItem> items;
+    std::mt19937 rng(7);
+    for (const Drop& d : t.drops) {
+        for (const std::wstring& p : d.paths) {
+            items.push_back(relay::SortItem{p.c_str(), rng() % (64u << 20), 132000000000000000ull + rng()});
+        }
+    }
+    const uint32_t all = (uint32_t)items.size();
+    const uint32_t first = (uint32_t)t.drops[0].paths.size();
+    static const char* const modeNames[relay::SORT_MODE_COUNT] = {
+        "drop", "name", "ext", "size", "mtime", "folder"
+    };
+    // 与 dock 一样在执行器上分块（dock 里整个排序任务也在执行器上）
+    relay::Executor exec(0);
+    for (int m = 0; m < relay::SORT_MODE_COUNT; ++m) {
+        relay::SortView view;
+        Measure(std::string("sort/full/") + modeNames[m], t.name, all, Nothing, [&] {
+            view.Reset((relay::SortMode)m, items.data(), all, &exec);
+        });
+        if (first < all) {
+            Measure(std::string("sort/append/") + modeNames[m], t.name, all - first,
+                    [&] { view.Reset((relay::SortMode)m, items.data(), first, &exec); },
+                    [&] { view.Append(items.data(), all, &exec); });
+        }
+    }
+
+    // tip 的分组顺序：首次建分组表，之后只按名次稳定重排
+    relay::SortView view;
+    view.Reset(relay::SORT_NAME, items.data(), all);
+    std::vector<uint32_t> grouped;
+    Measure("sort/grouped/first", t.name, all, [&] { view.Reset(relay::SORT_NAME, items.data(), all); },
+            [&] { view.GroupedOrder(items.data(), relay::GROUP_FOLDER, grouped); });
+    Measure("sort/grouped/again", t.name, all, Nothing,
+            [&] { view.GroupedOrder(items.data(), relay::GROUP_FOLDER, grouped); });
+}
+
+static void BenchTipLayout() {
+    relay::Rect taskbar{0, 1040, 1920, 1080};
+    int sink = 0;
+    Measure("tip/layout", "-", 1, Nothing, [&] {
+        for (int lines = 1; lines <= 200; ++lines) {
+            int h = relay::TipHeight(lines, 9, 80, 0, 30);
+            int x = 0, y = 0;
+            relay::PlaceTipAboveTaskbar(1920, 1080, &taskbar, 320, h, 8, x, y);
+            sink += x + y;
+        }
+    });
+    if (sink == 42) puts("");
+}
+
+// 与 main.cpp WriteDefaultIni 输出一致的内容（UTF-8）
+static const char DEFAULT_INI[] =
+    "; TransFile config.ini\r\n"
+    "[window]\r\nx=-430\r\ny=-1\r\nw=60\r\nh=43\r\ntopmost=1\r\nmax_count=100\r\n"
+    "heal_interval_ms=1000\r\nshow_single_tip=0\r\n\r\n"
+    "[style]\r\nbg=0xFFFFFF\r\nfg=0x333333\r\nfont_size=16\r\nfont_name=Segoe UI\r\n"
+    "; layered=0\r\n; alpha=255\r\n; colorkey=0\r\n; colorkey_rgb=0x202020\r\n\r\n"
+    "[tip]\r\nw=320\r\nmin_h=80\r\nmax_lines=30\r\nmax_h=0\r\nfont_size=9\r\nmargin=8\r\n"
+    "auto_close_ms=2000\r\nclick_through=0\r\n\r\n"
+    "[list]\r\nsort=drop\r\ngroup=none\r\n\r\n"
+    "[idle]\r\nafter_ms=60000\r\ntrim_working_set=1\r\n\r\n"
+    "[zip]\r\ndefault=0\r\nname=FileRelay.zip\r\nmethod=auto\r\nthreads=0\r\n\r\n"
+    "[executor]\r\nworkers=0\r\n\r\n"
+    "[history]\r\ndepth=50\r\n\r\n"
+    "[http]\r\nautostart=0\r\nbind=127.0.0.1\r\nport=8765\r\n";
+
+static void BenchIni() {
+    std::vector<uint8_t> raw(DEFAULT_INI, DEFAULT_INI + sizeof(DEFAULT_INI) - 1);
+    std::string name = "default";
+    if (g_opt.ini) {
+        FILE* f = fopen(g_opt.ini, "rb");
+        if (f) {
+            raw.clear();
+            uint8_t chunk[4096];
+            size_t got;
+            while ((got = fread(chunk, 1, sizeof(chunk), f)) > 0) raw.insert(raw.end(), chunk, chunk + got);
+            fclose(f);
+            name = g_opt.ini;
+        }
+    }
+
+    // LoadIniStyle 读取的全部键
+    static const wchar_t* const keys[][2] = {
+        {L"window", L"x"}, {L"window", L"y"}, {L"window", L"w"}, {L"window", L"h"},
+        {L"window", L"topmost"}, {L"window", L"heal_interval_ms"}, {L"window", L"max_count"},
+        {L"style", L"bg"}, {L"style", L"fg"}, {L"style", L"font_size"}, {L"style", L"font_name"},
+        {L"window", L"show_single_tip"}, {L"style", L"layered"}, {L"style", L"alpha"},
+        {L"style", L"colorkey"}, {L"style", L"colorkey_rgb"}, {L"tip", L"auto_close_ms"},
+        {L"tip", L"w"}, {L"tip", L"min_h"}, {L"tip", L"max_lines"}, {L"tip", L"max_h"},
+        {L"tip", L"font_size"}, {L"tip", L"margin"}, {L"tip", L"click_through"},
+        {L"list", L"sort"}, {L"list", L"group"}, {L"idle", L"after_ms"}, {L"idle", L"trim_working_set"},
+        {L"zip", L"default"}, {L"zip", L"name"}, {L"zip", L"method"}, {L"zip", L"threads"},
+        {L"executor", L"workers"}, {L"history", L"depth"}, {L"http", L"autostart"}, {L"http", L"bind"}, {L"http", L"port"},
+        {L"debug", L"drop_trace"},
+    };
+    int sink = 0;
+    Measure("ini/load", name, sizeof(keys) / sizeof(keys[0]), Nothing, [&] {
+        std::wstring text;
+        relay::DecodeIniBytes(raw.data(), raw.size(), text);
+        relay::IniDoc ini;
+        ini.Parse(text.c_str(), text.size());
+        for (const auto& k : keys) sink += ini.Int(k[0], k[1], 0) + (ini.Str(k[0], k[1], L"")[0] != 0);
+    });
+    if (sink == 42) puts("");
+}
+
+// ---------------- idle ----------------
+// 时间全部注入：进入空闲、忙时推迟、只触发一次、唤醒后重新计时、中途关闭
+static bool CheckIdleTracker() {
+    bool ok = true;
+    auto expect = [&](bool cond) { ok = ok && cond; };
+
+    relay::IdleTracker off;
+    off.Touch(100);
+    expect(!off.Enabled() && off.MsUntilIdle(1000000) == UINT32_MAX && !off.Poll(1000000, false) && !off.Idle());
+
+    relay::IdleTracker t(1000);
+    expect(!t.Touch(5000));                       // 未空闲时交互不算唤醒
+    expect(t.MsUntilIdle(5000) == 1000 && t.MsUntilIdle(5999) == 1 && t.MsUntilIdle(6000) == 0);
+    expect(!t.Poll(5999, false) && !t.Idle());    // 差 1ms
+    expect(!t.Poll(6000, true) && !t.Idle());     // 到期但忙：推迟并从此刻重新计时
+    expect(t.MsUntilIdle(6000) == 1000);
+    expect(!t.Poll(6999, false));
+    expect(t.Poll(7000, false) && t.Idle());      // 恰好到期
+    expect(!t.Poll(8000, false) && t.Idle());     // 已空闲不重复触发
+    expect(t.MsUntilIdle(8000) == UINT32_MAX);
+    expect(t.Touch(9000) && !t.Idle());           // 唤醒
+    expect(!t.Touch(9001));                       // 再次交互不算唤醒
+    expect(t.MsUntilIdle(9001) == 1000);          // 以最后一次交互重新计时
+    expect(!t.Poll(10000, false) && t.Poll(10001, false));
+
+    t.Touch(20000);
+    t.SetQuietMs(0);                              // 运行中关闭
+    expect(!t.Poll(50000, false) && t.MsUntilIdle(50000) == UINT32_MAX);
+    t.SetQuietMs(500);                            // 再打开：仍从最后一次交互算起
+    expect(t.MsUntilIdle(20000) == 500 && t.Poll(20500, false));
+    return ok;
+}
+
+// 两个阈值各取两侧：富余下限（小列表时起作用）与富余百分比（大列表时起作用）
+static bool CheckCompactPolicy() {
+    relay::CompactPolicy p;   // 4096 字节、25%
+    bool ok = true;
+    ok = ok && !p.ShouldCompact(0, 0) && !p.ShouldCompact(100, 100) && !p.ShouldCompact(50, 100);
+    ok = ok && p.ShouldCompact(1, 0);                                   // 空列表有富余就全部释放
+    ok = ok && !p.ShouldCompact(1000 + 4095, 1000) && p.ShouldCompact(1000 + 4096, 1000);
+    ok = ok && !p.ShouldCompact(100000 + 25000, 100000) && p.ShouldCompact(100000 + 25001, 100000);
+
+    relay::CompactPolicy eager;
+    eager.minSlackBytes = 0;
+    eager.maxSlackPercent = 0;
+    ok = ok && eager.ShouldCompact(101, 100) && !eager.ShouldCompact(100, 100);
+
+    // 真实列表：收缩后内容不变，且不再被判为值得收缩
+    relay::PathList list;
+    wchar_t path[64];
+    for (int i = 0; i < 3000; ++i) {
+        swprintf(path, 64, L"C:\\Users\\dev\\Desktop\\IMG_%05d.jpg", i);
+        list.Add(path);
+    }
+    ok = ok && p.ShouldCompact(list.ReservedBytes(), list.UsedBytes());
+    list.Compact();
+    ok = ok && !p.ShouldCompact(list.ReservedBytes(), list.UsedBytes()) && list.Count() == 3000;
+    for (int i = 0; i < 3000 && ok; i += 7) {
+        swprintf(path, 64, L"C:\\Users\\dev\\Desktop\\IMG_%05d.jpg", i);
+        ok = wcscmp(list.Path(i), path) == 0 && wcscmp(list.Name(i), path + 21) == 0;
+    }
+    list.Clear();
+    ok = ok && p.ShouldCompact(list.ReservedBytes(), list.UsedBytes());
+    list.Compact();
+    ok = ok && list.ReservedBytes() == 0;
+    return ok;
+}
+
+static void BenchIdle() {
+    if (!Selected("idle/")) return;
+    if (!CheckIdleTracker() || !CheckCompactPolicy()) {
+        fprintf(stderr, "idle precheck failed\n");
+        return;
+    }
+    // 定时器每次触发的判定开销
+    relay::IdleTracker t(60000);
+    uint64_t now = 0;
+    unsigned sink = 0;
+    Measure("idle/poll", "-", 1000, Nothing, [&] {
+        for (int i = 0; i < 1000; ++i) {
+            now += 97;
+            if (i % 400 == 0) sink += t.Touch(now);
+            sink += t.Poll(now, false) + (t.MsUntilIdle(now) & 1);
+        }
+    });
+    if (sink == 42) puts("");
+}
+
+// ---------------- inflate ----------------
+// 只给 precheck 用的最小 RFC 1951 解码器（按 zlib 里 puff 的做法逐位走规范 Huffman 码），
+// 不与编码器共用任何表，用来对拍 relay_deflate.h 的输出
+class Inflater {
+public:
+    enum { BLOCK_STORED = 1, BLOCK_FIXED = 2, BLOCK_DYNAMIC = 4 };
+
+    // 解码 in[0..n)，追加到 out；out 里原有的内容就是预置字典。needFinal=false 时输入也可以
+    // 在某个块（sync flush）之后的字节边界结束。blocks 按位累计见过的块类型
+    bool Run(const uint8_t* in, size_t n, std::vector<uint8_t>& out, bool needFinal, unsigned& blocks) {
+        m_in = in;
+        m_bits = (uint64_t)n * 8;
+        m_pos = 0;
+        m_out = &out;
+        m_base = out.size();
+        for (bool last = false; !last;) {
+            if (!needFinal && m_pos == m_bits) return true;
+            last = Bits(1) == 1;
+            int type = Bits(2);
+            bool ok;
+            if (type == 0) { ok = Stored(); blocks |= BLOCK_STORED; }
+            else if (type == 1) { ok = Fixed(); blocks |= BLOCK_FIXED; }
+            else if (type == 2) { ok = Dynamic(); blocks |= BLOCK_DYNAMIC; }
+            else ok = false;
+            if (!ok || m_pos > m_bits) return false;
+        }
+        return m_bits - m_pos < 8;   // BFINAL 之后只剩对齐位
+    }
+
+private:
+    struct Huff {
+        uint16_t count[16];
+        uint16_t symbol[320];
+    };
+
+    const uint8_t* m_in = nullptr;
+    uint64_t m_bits = 0, m_pos = 0;
+    std::vector<uint8_t>* m_out = nullptr;
+    size_t m_base = 0;
+
+    // 越界时返回 0 并把 m_pos 推过 m_bits，由调用方统一判错
+    int Bits(int k) {
+        int v = 0;
+        for (int i = 0; i < k; ++i, ++m_pos) {
+            if (m_pos >= m_bits) { m_pos = m_bits + 1; return 0; }
+            v |= ((m_in[m_pos >> 3] >> (m_pos & 7)) & 1) << i;
+        }
+        return v;
+    }
+
+    // 允许不完整的码（只有一个距离码时编码器给它 1 位），拒绝超额的码
+    static bool Build(Huff& h, const uint8_t* lens, int n) {
+        memset(h.count, 0, sizeof(h.count));
+        for (int i = 0; i < n; ++i) h.count[lens[i]]++;
+        int left = 1;
+        for (int len = 1; len < 16; ++len) {
+            left = (left << 1) - h.count[len];
+            if (left < 0) return false;
+        }
+        uint16_t offs[16];
+        offs[1] = 0;
+        for (int len = 1; len < 15; ++len) offs[len + 1] = (uint16_t)(offs[len] + h.count[len]);
+        for (int i = 0; i < n; ++i) {
+            if (lens[i]) h.symbol[offs[lens[i]]++] = (uint16_t)i;
+        }
+        return true;
+    }
+
+    int Decode(const Huff& h) {
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len < 16; ++len) {
+            code |= Bits(1);
+            int count = h.count[len];
+            if (code - count < first) return h.symbol[index + (code - first)];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+            if (m_pos > m_bits) return -1;
+        }
+        return -1;
+    }
+
+    bool Stored() {
+        m_pos = (m_pos + 7) & ~(uint64_t)7;
+        if (m_pos + 32 > m_bits) return false;
+        size_t at = (size_t)(m_pos >> 3);
+        unsigned len = m_in[at] | m_in[at + 1] << 8;
+        unsigned nlen = m_in[at + 2] | m_in[at + 3] << 8;
+        if (len != (~nlen & 0xFFFF)) return false;
+        m_pos += 32;
+        if (m_pos + (uint64_t)len * 8 > m_bits) return false;
+        m_out->insert(m_out->end(), m_in + at + 4, m_in + at + 4 + len);
+        m_pos += (uint64_t)len * 8;
+        return true;
+    }
+
+    bool Codes(const Huff& lit, const Huff& dist) {
+        static const uint16_t LBASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                           35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static const uint8_t LEXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                           3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static const uint16_t DBASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                           257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                           8193, 12289, 16385, 24577};
+        static const uint8_t DEXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                           7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        std::vector<uint8_t>& out = *m_out;
+        for (;;) {
+            int sym = Decode(lit);
+            if (sym < 0) return false;
+            if (sym < 256) { out.push_back((uint8_t)sym); continue; }
+            if (sym == 256) return true;
+            sym -= 257;
+            if (sym >= 29) return false;
+            size_t len = LBASE[sym] + Bits(LEXTRA[sym]);
+            int dsym = Decode(dist);
+            if (dsym < 0 || dsym >= 30) return false;
+            size_t d = DBASE[dsym] + Bits(DEXTRA[dsym]);
+            if (m_pos > m_bits || d > out.size() || d > 32768) return false;
+            for (size_t i = 0; i < len; ++i) out.push_back(out[out.size() - d]);
+        }
+    }
+
+    bool Fixed() {
+        uint8_t lens[288];
+        for (int i = 0; i < 288; ++i) lens[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+        uint8_t dlens[30];
+        memset(dlens, 5, sizeof(dlens));
+        Huff lit, dist;
+        return Build(lit, lens, 288) && Build(dist, dlens, 30) && Codes(lit, dist);
+    }
+
+    bool Dynamic() {
+        static const uint8_t ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        int nlen = Bits(5) + 257, ndist = Bits(5) + 1, ncode = Bits(4) + 4;
+        if (nlen > 286 || ndist > 30) return false;
+        uint8_t lens[320] = {0};
+        for (int i = 0; i < ncode; ++i) lens[ORDER[i]] = (uint8_t)Bits(3);
+        Huff cl;
+        if (!Build(cl, lens, 19)) return false;
+        memset(lens, 0, sizeof(lens));
+        for (int i = 0; i < nlen + ndist;) {
+            int sym = Decode(cl);
+            if (sym < 0) return false;
+            if (sym < 16) { lens[i++] = (uint8_t)sym; continue; }
+            int repeat, value = 0;
+            if (sym == 16) {
+                if (i == 0) return false;
+                value = lens[i - 1];
+                repeat = 3 + Bits(2);
+            } else if (sym == 17) repeat = 3 + Bits(3);
+            else repeat = 11 + Bits(7);
+            if (i + repeat > nlen + ndist) return false;
+            while (repeat--) lens[i++] = (uint8_t)value;
+        }
+        if (lens[256] == 0) return false;
+        Huff lit, dist;
+        return Build(lit, lens, nlen) && Build(dist, lens + nlen, ndist) && Codes(lit, dist);
+    }
+};
+
+// ---------------- zip ----------------
+// 内存里的文件：类文本（可压缩）与随机字节（模拟 jpg/mp4 等已压缩格式）
+struct MemFile {
+    std::wstring name;
+    std::vector<uint8_t> data;
+};
+
+class MemSource : public relay::ZipSource {
+    const std::vector<uint8_t>& m_data;
+    size_t m_pos = 0;
+public:
+    explicit MemSource(const std::vector<uint8_t>& d) : m_data(d) {}
+    size_t Read(uint8_t* dst, size_t n) override {
+        n = std::min(n, m_data.size() - m_pos);
+        memcpy(dst, m_data.data() + m_pos, n);
+        m_pos += n;
+        return n;
+    }
+};
+
+class MemInput : public relay::ZipInput {
+public:
+    std::vector<MemFile> files;
+    std::unique_ptr<relay::ZipSource> Open(const relay::ZipEntry& e) override {
+        return std::unique_ptr<relay::ZipSource>(new MemSource(files[e.source].data));
+    }
+};
+
+static std::vector<uint8_t> TextLike(std::mt19937& rng, size_t n) {
+    static const char* const WORDS[] = {
+        "relay", "dock", "file", "path", "drop", "drag", "tip", "list", "sort", "group", "zip", "stream",
+        "window", "config", "the", "of", "and", "to", "in", "is", "for", "with", "on", "at", "0x", "return",
+        "static", "const", "int", "void", "if", "else", "while", "size", "count", "name", "order",
+    };
+    std::vector<uint8_t> out;
+    out.reserve(n + 16);
+    while (out.size() < n) {
+        const char* w = WORDS[rng() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+        out.insert(out.end(), w, w + strlen(w));
+        if (rng() % 7 == 0) { char num[12]; int k = snprintf(num, sizeof(num), "%u", (unsigned)(rng() % 100000)); out.insert(out.end(), num, num + k); }
+        out.push_back(rng() % 11 == 0 ? '\n' : ' ');
+    }
+    out.resize(n);
+    return out;
+}
+
+static std::vector<relay::ZipEntry> ZipEntries(const MemInput& in, relay::ZipMethod method) {
+    std::vector<relay::ZipEntry> entries;
+    for (size_t i = 0; i < in.files.size(); ++i) {
+        relay::ZipEntry e;
+        relay::AppendUtf8(in.files[i].name.c_str(), in.files[i].name.size(), e.name);
+        e.sizeHint = in.files[i].data.size();
+        e.store = relay::UseStore(method, in.files[i].name.c_str());
+        e.source = (uint32_t)i;
+        entries.push_back(e);
+    }
+    return entries;
+}
+
+// 按 IStream::Read 的方式 64K 一次读完整个归档；返回归档字节数
+// threads<=1 时在当前线程同步压缩，否则用 threads 个工作线程的执行器
+static uint64_t DrainZip(MemInput& in, relay::ZipMethod method, unsigned threads, FILE* out = nullptr,
+                         std::vector<uint8_t>* keep = nullptr) {
+    std::unique_ptr<relay::Executor> exec;
+    if (threads > 1) exec.reset(new relay::Executor(threads));
+    relay::ZipStream zip(ZipEntries(in, method), &in, exec.get());
+    static uint8_t buf[65536];
+    uint64_t total = 0;
+    size_t k;
+    while ((k = zip.Read(buf, sizeof(buf))) > 0) {
+        if (out) fwrite(buf, 1, k, out);
+        if (keep) keep->insert(keep->end(), buf, buf + k);
+        total += k;
+    }
+    return total;
+}
+
+// 4G 边界：Deflater::Bound 对不可压、可压、长匹配数据和各种分块都真的是上界；
+// 原始大小略低于 0xFFFF0000 但压缩后可能超过 32 位的 deflate 条目要按 ZIP64 开头（本地头 version 45）
+static bool CheckZipLimits(std::mt19937& rng) {
+    relay::Deflater z;
+    std::vector<uint8_t> out;
+    for (size_t n : {(size_t)0, (size_t)1, (size_t)100, (size_t)16383, (size_t)16384, (size_t)65535, (size_t)65536,
+                     (size_t)(1u << 20) + 7}) {
+        std::vector<uint8_t> random(n), runs(n);
+        for (uint8_t& b : random) b = (uint8_t)rng();
+        for (size_t i = 0; i < n; ++i) runs[i] = (uint8_t)(i / 300 % 3);   // 每个 token 覆盖 258 字节
+        std::vector<uint8_t> text = TextLike(rng, n);
+        for (const std::vector<uint8_t>* d : {&random, &runs, &text}) {
+            for (size_t chunk : {(size_t)4096, (size_t)65536, (size_t)1 << 21}) {
+                out.clear();
+                uint64_t calls = 0;
+                size_t off = 0;
+                do {
+                    size_t k = std::min(chunk, d->size() - off);
+                    size_t dict = std::min(off, (size_t)relay::Deflater::WINDOW);
+                    z.Compress(d->data() + off - dict, dict, d->data() + off, k, off + k == d->size(), out);
+                    off += k;
+                    ++calls;
+                } while (off < d->size());
+                if (out.size() > relay::Deflater::Bound(d->size(), calls)) return false;
+            }
+        }
+    }
+
+    const size_t chunk = relay::ZipStream::DEFAULT_CHUNK;
+    uint64_t limit = relay::ZipRawLimit(false, chunk);
+    if (relay::ZipDeflateBound(limit, chunk) > 0xFFFFFFFFull || relay::ZipDeflateBound(limit + 1, chunk) <= 0xFFFFFFFFull) {
+        return false;
+    }
+
+    // 本地头的 version needed（偏移 4）：45 表示按 ZIP64 开的条目；数据本身只有几个字节，只看开头的判定
+    MemInput in;
+    in.files.push_back(MemFile{L"a.bin", std::vector<uint8_t>(16, 7)});
+    auto version = [&](uint64_t sizeHint, bool store) {
+        relay::ZipEntry e;
+        e.name = "a.bin";
+        e.sizeHint = sizeHint;
+        e.store = store;
+        relay::ZipStream zip(std::vector<relay::ZipEntry>{e}, &in, nullptr);
+        uint8_t head[8] = {0};
+        zip.Read(head, sizeof(head));
+        return head[4] | head[5] << 8;
+    };
+    uint64_t edge = 0xFFFF0000ull;
+    uint64_t lastDeflate32 = 0;   // ZipDeflateBound 仍低于 edge 的最大原始大小
+    for (uint64_t lo = 0, hi = edge; lo <= hi;) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (relay::ZipDeflateBound(mid, chunk) < edge) { lastDeflate32 = mid; lo = mid + 1; }
+        else hi = mid - 1;
+    }
+    return edge - lastDeflate32 > 1000000 &&                 // 膨胀余量远大于旧判定的 64K
+           version(edge - 1, false) == 45 && version(edge - 1, true) == 20 && version(edge, true) == 45 &&
+           version(lastDeflate32, false) == 20 && version(lastDeflate32 + 1, false) == 45 &&
+           version(1 << 20, false) == 20;
+}
+
+// 编码器对拍：各种数据按不同块大小带预置字典分块压缩，每块单独解码（字典 = 前面最多 32K）
+// 与整条流解码都要还原原文；三种块类型都要出现过
+static bool CheckDeflateRoundTrip(std::mt19937& rng) {
+    relay::Deflater z;
+    Inflater inf;
+    unsigned blocks = 0;
+    std::vector<uint8_t> period(relay::Deflater::WINDOW);
+    for (uint8_t& b : period) b = (uint8_t)rng();
+    for (size_t n : {(size_t)0, (size_t)1, (size_t)3, (size_t)100, (size_t)16384, (size_t)65537, (size_t)(1u << 20) + 7}) {
+        std::vector<uint8_t> random(n), runs(n), repeat(n);
+        for (uint8_t& b : random) b = (uint8_t)rng();
+        for (size_t i = 0; i < n; ++i) runs[i] = (uint8_t)(i / 300 % 3);
+        for (size_t i = 0; i < n; ++i) repeat[i] = period[i % period.size()];   // 匹配都在 32768 的最远距离
+        std::vector<uint8_t> text = TextLike(rng, n);
+        for (const std::vector<uint8_t>* d : {&random, &runs, &repeat, &text}) {
+            for (size_t chunk : {(size_t)4096, (size_t)40000, (size_t)1 << 21}) {
+                std::vector<uint8_t> stream, part, got;
+                size_t off = 0;
+                do {
+                    size_t k = std::min(chunk, d->size() - off);
+                    size_t dict = std::min(off, (size_t)relay::Deflater::WINDOW);
+                    bool final = off + k == d->size();
+                    part.clear();
+                    z.Compress(d->data() + off - dict, dict, d->data() + off, k, final, part);
+                    got.assign(d->begin() + (off - dict), d->begin() + off);
+                    if (!inf.Run(part.data(), part.size(), got, final, blocks) || got.size() != dict + k ||
+                        !std::equal(got.begin() + dict, got.end(), d->begin() + off)) {
+                        return false;
+                    }
+                    stream.insert(stream.end(), part.begin(), part.end());
+                    off += k;
+                } while (off < d->size());
+                got.clear();
+                if (!inf.Run(stream.data(), stream.size(), got, true, blocks) || got != *d) return false;
+            }
+        }
+    }
+    return blocks == (Inflater::BLOCK_STORED | Inflater::BLOCK_FIXED | Inflater::BLOCK_DYNAMIC);
+}
+
+static uint32_t Get16(const uint8_t* p) { return p[0] | p[1] << 8; }
+static uint32_t Get32(const uint8_t* p) { return Get16(p) | Get16(p + 2) << 16; }
+
+// 整个归档走一遍中央目录：每个条目解压后与原文件、记录的 CRC / 大小一致
+static bool CheckZipRoundTrip(MemInput& in, relay::ZipMethod method, unsigned threads) {
+    std::vector<uint8_t> zip;
+    DrainZip(in, method, threads, nullptr, &zip);
+    if (zip.size() < 22 || Get32(&zip[zip.size() - 22]) != 0x06054b50) return false;
+    const uint8_t* eocd = &zip[zip.size() - 22];
+    size_t count = Get16(eocd + 10), cd = Get32(eocd + 16);
+    if (count != in.files.size()) return false;
+    Inflater inf;
+    unsigned blocks = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (cd + 46 > zip.size() || Get32(&zip[cd]) != 0x02014b50) return false;
+        const uint8_t* c = &zip[cd];
+        uint32_t method = Get16(c + 10), crc = Get32(c + 16), csize = Get32(c + 20), usize = Get32(c + 24);
+        size_t local = Get32(c + 42);
+        cd += 46 + Get16(c + 28) + Get16(c + 30) + Get16(c + 32);
+        if (local + 30 > zip.size() || Get32(&zip[local]) != 0x04034b50) return false;
+        size_t data = local + 30 + Get16(&zip[local + 26]) + Get16(&zip[local + 28]);
+        if (data + csize > zip.size()) return false;
+
+        const std::vector<uint8_t>& want = in.files[i].data;
+        std::vector<uint8_t> got;
+        if (method == 0) got.assign(zip.begin() + data, zip.begin() + data + csize);
+        else if (method != 8 || !inf.Run(&zip[data], csize, got, true, blocks)) return false;
+        if (got != want || usize != want.size() || crc != relay::Crc32(0, want.data(), want.size())) return false;
+    }
+    return true;
+}
+
+static void BenchZip() {
+    MemInput in;
+    std::mt19937 rng(29);
+    size_t textBytes = 0, rawBytes = 0;
+    for (int i = 0; i < 48; ++i) {
+        // 大小从 1K 到 1M 不等，覆盖单块和多块条目
+        size_t n = (size_t)1024 << (i % 11);
+        wchar_t name[64];
+        swprintf(name, 64, L"docs/note-%02d.txt", i);
+        in.files.push_back(MemFile{name, TextLike(rng, n)});
+        textBytes += n;
+    }
+    for (int i = 0; i < 4; ++i) {
+        wchar_t name[64];
+        swprintf(name, 64, L"photos/IMG_%04d.jpg", i);
+        std::vector<uint8_t> d(1u << 20);
+        for (uint8_t& b : d) b = (uint8_t)rng();
+        in.files.push_back(MemFile{name, std::move(d)});
+    }
+    for (const MemFile& f : in.files) rawBytes += f.data.size();
+
+    if (Selected("zip/") && !CheckZipLimits(rng)) {
+        fprintf(stderr, "zip precheck failed: deflate bound or ZIP64 decision\n");
+        return;
+    }
+    if (Selected("zip/")) {
+        unsigned hwCheck = std::max(2u, std::thread::hardware_concurrency());
+        if (!CheckDeflateRoundTrip(rng) || !CheckZipRoundTrip(in, relay::ZIP_DEFLATE, 1) ||
+            !CheckZipRoundTrip(in, relay::ZIP_AUTO, hwCheck)) {
+            fprintf(stderr, "zip precheck failed: inflated output differs from the input\n");
+            return;
+        }
+    }
+
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts = {1};
+    if (hw > 1) threadCounts.push_back(hw);
+
+    uint64_t sink = 0;
+    for (unsigned t : threadCounts) {
+        Measure("zip/deflate/t" + std::to_string(t), "synthetic", rawBytes, Nothing,
+                [&] { sink += DrainZip(in, relay::ZIP_DEFLATE, t); });
+    }
+    Measure("zip/store", "synthetic", rawBytes, Nothing, [&] { sink += DrainZip(in, relay::ZIP_STORE, 1); });
+    Measure("zip/auto/t" + std::to_string(hw), "synthetic", rawBytes, Nothing,
+            [&] { sink += DrainZip(in, relay::ZIP_AUTO, hw); });
+
+    if (Selected("zip/size synthetic")) {
+        printf("{\"bench\":\"zip/size\",\"trace\":\"synthetic\",\"n\":%zu,\"raw_bytes\":%zu,\"text_bytes\":%zu,"
+               "\"deflate_bytes\":%llu,\"store_bytes\":%llu,\"auto_bytes\":%llu}\n",
+               in.files.size(), rawBytes, textBytes,
+               (unsigned long long)DrainZip(in, relay::ZIP_DEFLATE, hw),
+               (unsigned long long)DrainZip(in, relay::ZIP_STORE, 1),
+               (unsigned long long)DrainZip(in, relay::ZIP_AUTO, hw));
+        fflush(stdout);
+    }
+
+    if (g_opt.zipOut) {
+        FILE* f = fopen(g_opt.zipOut, "wb");
+        if (!f) { fprintf(stderr, "cannot write %s\n", g_opt.zipOut); return; }
+        DrainZip(in, relay::ZIP_AUTO, hw, f);
+        fclose(f);
+    }
+    if (sink == 42) puts("");
+}
+
+// ---------------- executor ----------------
+// 模拟界面线程：signal 置位 + 唤醒，等到后 DrainCompletions（对应 MsgWaitForMultipleObjectsEx + SetEvent）
+struct UiSignal {
+    std::mutex mu;
+    std::condition_variable cv;
+    bool set = false;
+
+    void Set() {
+        std::lock_guard<std::mutex> lock(mu);
+        set = true;
+        cv.notify_one();
+    }
+    void Wait(int ms) {
+        std::unique_lock<std::mutex> lock(mu);
+        cv.wait_for(lock, std::chrono::milliseconds(ms), [this] { return set; });
+        set = false;
+    }
+};
+
+// 混合优先级、嵌套提交、随机取消：未取消的任务恰好执行一次、完成回调恰好一次且在“界面线程”上
+static bool CheckExecutor(unsigned workers) {
+    relay::Executor ex(workers);
+    UiSignal ui;
+    ex.SetCompletionSignal([&] { ui.Set(); });
+    const int N = 20000;
+    std::vector<std::atomic<int>> ran(N * 2);
+    std::vector<int> done(N * 2, 0);
+    std::vector<relay::CancelSource> sources(32);
+    std::vector<int> sourceOf(N);
+    std::mt19937 rng(32 + workers);
+    std::thread::id uiThread = std::this_thread::get_id();
+    bool offThread = false;
+    for (int i = 0; i < N; ++i) {
+        int src = (int)(rng() % sources.size());
+        sourceOf[i] = src;
+        relay::TaskPriority prio = rng() % 3 ? relay::PRIORITY_BULK : relay::PRIORITY_INTERACTIVE;
+        ex.Submit(prio, [&, i] {
+            ran[i]++;
+            if (i % 10 == 0) {
+                int j = N + i;
+                ex.Submit(relay::PRIORITY_BULK, [&, j] { ran[j]++; }, [&, j] { done[j]++; });
+            }
+        }, [&, i] {
+            done[i]++;
+            offThread = offThread || std::this_thread::get_id() != uiThread;
+        }, sources[src].Token());
+        if (i % 1000 == 999) sources[rng() % sources.size()].Cancel();
+    }
+    for (int idle = 0; idle < 3;) {
+        ui.Wait(20);
+        size_t got = ex.DrainCompletions();
+        idle = (got == 0 && ex.PendingTasks() == 0) ? idle + 1 : 0;
+    }
+    ex.Shutdown();
+    for (int i = 0; i < N * 2; ++i) {
+        if (ran[i] > 1 || done[i] > 1 || (done[i] && !ran[i])) return false;
+        if (i < N && !sources[sourceOf[i]].Cancelled() && (!ran[i] || !done[i])) return false;
+        if (i >= N && i % 10 == 0 && ran[i - N] && !done[i]) return false;
+    }
+    return !offThread;
+}
+
+static void SpinFor(double us) {
+    auto end = Clock::now() + std::chrono::nanoseconds((int64_t)(us * 1000));
+    while (Clock::now() < end) {}
+}
+
+static void BenchExec() {
+    if (!Selected("exec/")) return;
+    for (unsigned w : {1u, 4u}) {
+        if (!CheckExecutor(w)) {
+            fprintf(stderr, "exec precheck failed (%u workers)\n", w);
+            return;
+        }
+    }
+
+    unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+    unsigned workers = std::max(2u, hw);
+    std::string trace = "w" + std::to_string(workers);
+
+    // 提交 -> 执行 -> 完成回调回到界面线程的整圈
+    {
+        relay::Executor ex(workers);
+        UiSignal ui;
+        ex.SetCompletionSignal([&] { ui.Set(); });
+        const size_t N = 10000;
+        size_t completed = 0;
+        relay::ExecStats before = ex.Stats();
+        Measure("exec/roundtrip", trace, N, Nothing, [&] {
+            size_t target = completed + N;
+            for (size_t i = 0; i < N; ++i) {
+                ex.Submit(relay::PRIORITY_INTERACTIVE, [] {}, [&] { ++completed; });
+            }
+            while (completed < target) {
+                ui.Wait(10);
+                ex.DrainCompletions();
+            }
+        });
+        relay::ExecStats after = ex.Stats();
+        if (Selected("exec/batching " + trace)) {
+            uint64_t batches = after.batches - before.batches;
+            printf("{\"bench\":\"exec/batching\",\"trace\":\"%s\",\"completions\":%llu,\"batches\":%llu,"
+                   "\"per_batch\":%.1f}\n", trace.c_str(), (unsigned long long)(after.completions - before.completions),
+                   (unsigned long long)batches, batches ? (double)(after.completions - before.completions) / batches : 0.0);
+            fflush(stdout);
+        }
+    }
+
+    // 一个任务在工作线程上派生大量子任务：其余线程靠偷取分担
+    {
+        relay::Executor ex(workers);
+        const size_t N = 20000;
+        std::atomic<size_t> left{0};
+        relay::ExecStats before = ex.Stats();
+        Measure("exec/fanout", trace, N, Nothing, [&] {
+            left = N;
+            ex.Submit(relay::PRIORITY_BULK, [&] {
+                for (size_t i = 0; i < N; ++i) {
+                    ex.Submit(relay::PRIORITY_BULK, [&] { SpinFor(0.5); left.fetch_sub(1); });
+                }
+            });
+            while (left.load() > 0) std::this_thread::yield();
+        });
+        relay::ExecStats after = ex.Stats();
+        if (Selected("exec/steal " + trace)) {
+            printf("{\"bench\":\"exec/steal\",\"trace\":\"%s\",\"executed\":%llu,\"stolen\":%llu}\n", trace.c_str(),
+                   (unsigned long long)(after.executed - before.executed),
+                   (unsigned long long)(after.stolen - before.stolen));
+            fflush(stdout);
+        }
+    }
+
+    // 批量任务占满时，交互任务从提交到开始执行的延迟
+    if (Selected("exec/latency " + trace)) {
+        relay::Executor ex(workers);
+        std::atomic<bool> flood{true};
+        std::atomic<int> bulkLive{0};
+        std::function<void()> bulk = [&] {
+            SpinFor(500);
+            if (flood.load()) ex.Submit(relay::PRIORITY_BULK, bulk);
+            else bulkLive.fetch_sub(1);
+        };
+        for (unsigned i = 0; i < workers * 4; ++i) {
+            bulkLive.fetch_add(1);
+            ex.Submit(relay::PRIORITY_BULK, bulk);
+        }
+        std::vector<double> lat;
+        for (int i = 0; i < 300; ++i) {
+            std::atomic<bool> started{false};
+            auto t0 = Clock::now();
+            double ns = 0;
+            ex.Submit(relay::PRIORITY_INTERACTIVE, [&] {
+                ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+                started = true;
+            });
+            while (!started.load()) std::this_thread::yield();
+            lat.push_back(ns);
+            SpinFor(200);
+        }
+        flood = false;
+        while (bulkLive.load() > 0) std::this_thread::yield();
+        std::sort(lat.begin(), lat.end());
+        printf("{\"bench\":\"exec/latency\",\"trace\":\"%s\",\"bulk_task_us\":500,\"samples\":%zu,"
+               "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}\n",
+               trace.c_str(), lat.size(), Percentile(lat, 0.5) / 1e3, Percentile(lat, 0.9) / 1e3,
+               Percentile(lat, 0.99) / 1e3, lat.back() / 1e3);
+        fflush(stdout);
+    }
+}
+
+// ---------------- history ----------------
+// 随机操作对照 std::vector；每隔一段留一个旧版本，最后检查旧版本没被后来的修改波及
+static bool CheckPVector() {
+    std::mt19937 rng(31);
+    relay::PVector<uint32_t> v;
+    std::vector<uint32_t> model;
+    std::vector<std::pair<relay::PVector<uint32_t>, std::vector<uint32_t>>> saved;
+    for (int op = 0; op < 400000; ++op) {
+        unsigned r = rng() % 100;
+        if (r < 55) {
+            uint32_t x = rng();
+            v.PushBack(x);
+            model.push_back(x);
+        } else if (r < 75 && !model.empty()) {
+            v.PopBack();
+            model.pop_back();
+        } else if (r < 95 && !model.empty()) {
+            size_t i = rng() % model.size();
+            uint32_t x = rng();
+            v.Set(i, x);
+            model[i] = x;
+        } else if (r < 96) {
+            size_t n = model.empty() ? 0 : rng() % (model.size() + 1);
+            v.Truncate(n);
+            model.resize(n);
+        } else if (r < 99) {
+            if (saved.size() >= 64) saved.erase(saved.begin() + rng() % saved.size());
+            saved.emplace_back(v, model);
+        } else if (!saved.empty()) {
+            const auto& s = saved[rng() % saved.size()];
+            v = s.first;
+            model = s.second;
+        }
+    }
+    saved.emplace_back(v, model);
+    for (const auto& s : saved) {
+        if (s.first.Size() != s.second.size()) return false;
+        size_t i = 0;
+        bool ok = true;
+        s.first.ForEach([&](uint32_t x) { ok = ok && x == s.second[i++]; });
+        if (!ok) return false;
+        for (size_t k = 0; k < s.second.size(); k += 97) {
+            if (s.first[k] != s.second[k]) return false;
+        }
+    }
+    return true;
+}
+
+static relay::ListState HistoryState(size_t n, size_t salt) {
+    relay::ListState s;
+    wchar_t path[64];
+    for (size_t i = 0; i < n; ++i) {
+        int len = swprintf(path, 64, L"C:\\Users\\relay\\Documents\\batch%zu\\file%06zu.txt", salt, i);
+        s.PushBack(relay::MakeListItem(path, (size_t)len, i * 1024, 132000000000000000ull + i));
+    }
+    return s;
+}
+
+// 各版本共享后实际的节点字节（去重）与条目个数
+static void HistoryFootprint(const relay::ListHistory& h, size_t& nodeBytes, size_t& items) {
+    std::unordered_set<const void*> nodes, seen;
+    nodeBytes = 0;
+    h.ForEachState([&](const relay::ListState& s) {
+        s.ForEachNode([&](const void* p, size_t bytes) {
+            if (nodes.insert(p).second) nodeBytes += bytes;
+        });
+        s.ForEach([&](const relay::ListItemRef& it) { seen.insert(it.get()); });
+    });
+    items = seen.size();
+}
+
+static void BenchHistory() {
+    if (!Selected("history/")) return;
+    if (!CheckPVector()) {
+        fprintf(stderr, "history precheck failed: PVector differs from std::vector\n");
+        return;
+    }
+
+    const size_t N = 100000;
+    const std::string trace = "100k";
+    relay::ListState base = HistoryState(N, 0);
+    relay::ListItemRef extra = relay::MakeListItem(L"C:\\extra.txt", 12, 1, 1);
+    uint64_t sink = 0;
+
+    Measure("history/build", trace, N, Nothing, [&] { sink += HistoryState(N, 1).Size(); });
+
+    // 深历史：每次迭代都在上一版之上再压一步
+    relay::ListHistory deep(1000);
+    deep.Push(relay::HISTORY_OVERWRITE, base);
+    Measure("history/append1", trace, 1, Nothing, [&] {
+        relay::ListState s = deep.Current();
+        s.PushBack(extra);
+        deep.Push(relay::HISTORY_APPEND, std::move(s));
+    });
+    Measure("history/remove1", trace, 1, Nothing, [&] {
+        const relay::ListState& cur = deep.Current();
+        size_t victim = cur.Size() - 1 - (sink % 64);
+        deep.Push(relay::HISTORY_REMOVE, relay::RemoveFromState(cur, [&](size_t i) { return i != victim; }));
+        sink += victim;
+    });
+    Measure("history/clear", trace, 1, Nothing, [&] {
+        relay::ListHistory h(50);
+        h.Push(relay::HISTORY_OVERWRITE, base);
+        h.Push(relay::HISTORY_CLEAR, relay::ListState());
+        sink += h.UndoCount();
+    });
+    Measure("history/undo-redo", trace, 2, Nothing, [&] {
+        sink += deep.Undo();
+        sink += deep.Redo();
+    });
+
+    // 撤销后按版本重建 PathList（main.cpp 的 ApplyListState）
+    relay::PathList list;
+    Measure("history/restore", trace, N, Nothing, [&] {
+        list.Clear();
+        base.ForEach([&](const relay::ListItemRef& it) {
+            int idx = list.Add(it->path.c_str(), it->path.size());
+            if (idx >= 0) list.SetStat(idx, it->size, it->mtime);
+        });
+        sink += list.Count();
+    });
+
+    if (Selected("history/footprint " + trace)) {
+        for (size_t depth : {(size_t)50, (size_t)1000}) {
+            relay::ListHistory h(depth);
+            h.Push(relay::HISTORY_OVERWRITE, base);
+            std::mt19937 rng(32);
+            for (size_t step = 0; step < depth; ++step) {
+                relay::ListState s = h.Current();
+                if (rng() % 4) {
+                    s.PushBack(extra);
+                    h.Push(relay::HISTORY_APPEND, std::move(s));
+                } else {
+                    size_t victim = s.Size() - 1 - rng() % 64;
+                    h.Push(relay::HISTORY_REMOVE, relay::RemoveFromState(s, [&](size_t i) { return i != victim; }));
+                }
+            }
+            size_t nodeBytes = 0, items = 0;
+            HistoryFootprint(h, nodeBytes, items);
+            size_t states = h.UndoCount() + 1;
+            printf("{\"bench\":\"history/footprint\",\"trace\":\"%s\",\"n\":%zu,\"depth\":%zu,\"states\":%zu,"
+                   "\"shared_node_bytes\":%zu,\"unique_items\":%zu,\"full_copy_bytes\":%zu}\n",
+                   trace.c_str(), N, depth, states, nodeBytes, items, states * N * sizeof(relay::ListItemRef));
+        }
+        fflush(stdout);
+    }
+    if (sink == 42) puts("");
+}
+
+// ---------------- startup ----------------
+// FindSwitch 的参照：先整条切成参数，再逐个比
+static bool RefFindSwitch(const std::string& cmd, const std::string& name, std::string* value) {
+    std::vector<std::string> args;
+    std::string cur;
+    bool quoted = false, inArg = false;
+    for (char c : cmd) {
+        if (!quoted && (c == ' ' || c == '\t')) {
+            if (inArg) args.push_back(cur);
+            cur.clear();
+            inArg = false;
+            continue;
+        }
+        inArg = true;
+        if (c == '"') quoted = !quoted;
+        else cur += c;
+    }
+    if (inArg) args.push_back(cur);
+    for (const std::string& a : args) {
+        if (name.empty()) return false;
+        if (a == name) { value->clear(); return true; }
+        if (a.size() > name.size() && a.compare(0, name.size(), name) == 0 && a[name.size()] == '=') {
+            *value = a.substr(name.size() + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool CheckStartup() {
+    const char* name = "--trace-startup";
+    struct Case { const char* cmd; bool found; const char* value; };
+    static const Case cases[] = {
+        {"app.exe --trace-startup", true, ""},
+        {"\"C:\\Program Files\\Relay\\app.exe\" --trace-startup=\"C:\\a b\\s.log\"", true, "C:\\a b\\s.log"},
+        {"app.exe --trace-startupx", false, ""},
+        {"app.exe \"--trace-startup\"", true, ""},
+        {"app.exe -- trace-startup", false, ""},
+        {"", false, ""},
+        {"app.exe\t--trace-startup=x y", true, "x"},
+        {"\"app --trace-startup\"", false, ""},
+        {"app.exe --trace-startup=", true, ""},
+    };
+    for (const Case& c : cases) {
+        std::string v = "?";
+        if (relay::FindSwitch(c.cmd, name, &v) != c.found) return false;
+        if (c.found && v != c.value) return false;
+    }
+    std::wstring wv;
+    if (!relay::FindSwitch(L"app.exe --trace-startup=\"D:\\日志\\s.log\"", L"--trace-startup", &wv) ||
+        wv != L"D:\\日志\\s.log") {
+        return false;
+    }
+
+    // 随机命令行对拍参照实现
+    std::mt19937 rng(33);
+    static const char alphabet[] = " \t\"-=tracestup.xy";
+    for (int iter = 0; iter < 200000; ++iter) {
+        std::string cmd;
+        size_t len = rng() % 40;
+        for (size_t i = 0; i < len; ++i) {
+            if (rng() % 8 == 0) cmd += rng() % 2 ? " --trace-startup" : "=";
+            else cmd += alphabet[rng() % (sizeof(alphabet) - 1)];
+        }
+        std::string a = "?", b = "?";
+        bool got = relay::FindSwitch(cmd.c_str(), name, &a);
+        if (got != RefFindSwitch(cmd, name, &b) || (got && a != b)) {
+            fprintf(stderr, "startup switch mismatch: [%s]\n", cmd.c_str());
+            return false;
+        }
+    }
+
+    // 打点、溢出、往返
+    relay::StartupTrace t;
+    t.Mark("before", 5);
+    if (t.Count() != 0) return false;
+    t.Begin(1000);
+    t.SetPreMainUs(3120);
+    static const char* const names[] = {"instance", "ini", "class", "window", "first_paint", "show", "ole", "ready"};
+    uint64_t at = 1000;
+    for (const char* n : names) t.Mark(n, at += 737);
+    t.MarkOnce("first_paint", at + 1);
+    for (size_t i = t.Count(); i < relay::StartupTrace::MAX_PHASES + 3; ++i) t.Mark("extra", at += 1);
+    if (t.Count() != relay::StartupTrace::MAX_PHASES || t.Dropped() != 3) return false;
+    std::string line = t.Format();
+    relay::StartupRecord r;
+    if (!relay::ParseStartupLine(line.data(), line.size(), r)) return false;
+    if (r.phases.size() != t.Count() || fabs(r.preMainMs - 3.12) > 1e-9 || fabs(r.firstPaintMs - 5 * 0.737) > 1e-9 ||
+        fabs(r.readyMs - 8 * 0.737) > 1e-9) {
+        return false;
+    }
+    for (size_t i = 0; i < t.Count(); ++i) {
+        if (r.phases[i].first != t.Name(i) || fabs(r.phases[i].second - t.Us(i) / 1000.0) > 1e-9) return false;
+    }
+
+    // 截断、改坏、随机字节：只要求不越界、不崩溃，阶段数不超过原记录
+    for (size_t cut = 0; cut <= line.size(); ++cut) {
+        std::vector<char> buf(line.begin(), line.begin() + cut);   // 不带结尾 0，越界读能被 ASan 抓到
+        relay::ParseStartupLine(buf.data(), buf.size(), r);
+        if (r.phases.size() > t.Count()) return false;
+    }
+    for (int iter = 0; iter < 100000; ++iter) {
+        std::vector<char> buf(line.begin(), line.end());
+        int flips = 1 + (int)(rng() % 4);
+        for (int k = 0; k < flips; ++k) buf[rng() % buf.size()] = (char)(rng() % 3 ? "[]\",\\-.0"[rng() % 8] : rng());
+        relay::ParseStartupLine(buf.data(), buf.size(), r);
+        if (r.phases.size() > t.Count()) return false;
+        std::vector<char> junk(rng() % 64);
+        for (char& c : junk) c = (char)rng();
+        if (!junk.empty()) junk[0] = '{';
+        relay::ParseStartupLine(junk.data(), junk.size(), r);
+    }
+    return true;
+}
+
+// --startup-log：每个文件一行汇总
+static void StartupReport(const char* file) {
+    FILE* f = fopen(file, "rb");
+    if (!f) { fprintf(stderr, "cannot open startup log %s\n", file); return; }
+    std::vector<double> preMain, firstPaint, ready;
+    std::vector<std::string> order;
+    std::vector<std::vector<double>> spans;   // 与 order 对应：各阶段本身的耗时
+    char lineBuf[8192];
+    size_t bad = 0;
+    while (fgets(lineBuf, sizeof(lineBuf), f)) {
+        size_t n = strlen(lineBuf);
+        while (n && (lineBuf[n - 1] == '\n' || lineBuf[n - 1] == '\r')) --n;
+        if (n == 0) continue;
+        relay::StartupRecord r;
+        if (!relay::ParseStartupLine(lineBuf, n, r)) { ++bad; continue; }
+        if (r.preMainMs >= 0) preMain.push_back(r.preMainMs);
+        if (r.firstPaintMs >= 0) firstPaint.push_back(r.firstPaintMs);
+        if (r.readyMs >= 0) ready.push_back(r.readyMs);
+        double prev = 0;
+        for (const auto& ph : r.phases) {
+            size_t k = std::find(order.begin(), order.end(), ph.first) - order.begin();
+            if (k == order.size()) { order.push_back(ph.first); spans.emplace_back(); }
+            spans[k].push_back(ph.second - prev);
+            prev = ph.second;
+        }
+    }
+    fclose(f);
+
+    auto p50 = [](std::vector<double> v) { std::sort(v.begin(), v.end()); return Percentile(v, 0.50); };
+    auto p90 = [](std::vector<double> v) { std::sort(v.begin(), v.end()); return Percentile(v, 0.90); };
+    printf("{\"bench\":\"startup/report\",\"trace\":\"%s\",\"runs\":%zu,\"bad\":%zu,"
+           "\"pre_main_p50_ms\":%.3f,\"first_paint_p50_ms\":%.3f,\"first_paint_p90_ms\":%.3f,"
+           "\"ready_p50_ms\":%.3f,\"ready_p90_ms\":%.3f,\"phase_p50_ms\":{",
+           file, firstPaint.size(), bad, p50(preMain), p50(firstPaint), p90(firstPaint), p50(ready), p90(ready));
+    for (size_t k = 0; k < order.size(); ++k) printf("%s\"%s\":%.3f", k ? "," : "", order[k].c_str(), p50(spans[k]));
+    printf("}}\n");
+    fflush(stdout);
+}
+
+static void BenchStartup() {
+    if (!Selected("startup/")) return;
+    if (!CheckStartup()) {
+        fprintf(stderr, "startup precheck failed\n");
+        return;
+    }
+
+    // 一次冷启动的全部打点（含首帧 MarkOnce）与收尾的 Format
+    static const char* const names[] = {"instance", "ini", "class", "window", "show", "ole", "executor", "http", "ready"};
+    relay::StartupTrace t;
+    Measure("startup/mark", "cold", sizeof(names) / sizeof(names[0]) + 1, Nothing, [&] {
+        uint64_t now = 0;
+        t.Begin(now);
+        for (size_t i = 0; i < 4; ++i) t.Mark(names[i], now += 100);
+        t.MarkOnce("first_paint", now += 100);
+        for (size_t i = 4; i < sizeof(names) / sizeof(names[0]); ++i) t.Mark(names[i], now += 100);
+    });
+    size_t bytes = 0;
+    Measure("startup/format", "cold", t.Count(), Nothing, [&] { bytes += t.Format().size(); });
+
+    // 带长路径与若干参数的命令行里找开关（每次启动一次）
+    std::wstring cmd = L"\"C:\\Program Files\\File Relay Dock\\FileRelayDock.exe\"";
+    for (int i = 0; i < 8; ++i) cmd += L" --opt" + std::to_wstring(i) + L"=\"some value " + std::to_wstring(i) + L"\"";
+    cmd += L" --trace-startup=\"C:\\Users\\someone\\AppData\\Local\\Temp\\startup trace.log\"";
+    std::wstring value;
+    Measure("startup/switch", "cold", 1, Nothing, [&] { relay::FindSwitch(cmd.c_str(), L"--trace-startup", &value); });
+
+    for (const char* file : g_opt.startupLogs) StartupReport(file);
+}
+
+// ---------------- drop parsing ----------------
+// 任意码元类型的 DROPFILES 块（Unit=uint16_t 即 Windows 上的真实布局）
+template <class Unit>
+static std::vector<uint8_t> DropBlock(const std::vector<std::basic_string<Unit>>& paths, bool wide, uint32_t pFiles = 20) {
+    std::vector<uint8_t> block(pFiles);
+    relay::DropFilesHeader hdr{};
+    hdr.pFiles = pFiles;
+    hdr.fWide = wide ? 1 : 0;
+    memcpy(block.data(), &hdr, sizeof(hdr));
+    for (const auto& p : paths) {
+        size_t at = block.size();
+        block.resize(at + (p.size() + 1) * sizeof(Unit));
+        memcpy(&block[at], p.data(), p.size() * sizeof(Unit));
+    }
+    block.resize(block.size() + sizeof(Unit));   // 双 0 结尾
+    return block;
+}
+
+template <class Unit>
+static std::basic_string<Unit> RandomDropPath(std::mt19937& rng, size_t maxLen) {
+    std::basic_string<Unit> s;
+    size_t len = 1 + rng() % maxLen;
+    s += (Unit)('C' + rng() % 3);
+    s += (Unit)':';
+    while (s.size() < len) {
+        unsigned r = rng() % 16;
+        s += (Unit)(r == 0 ? '\\' : r == 1 ? 0x4E2D : r == 2 ? ' ' : 'a' + rng() % 26);
+    }
+    if (sizeof(Unit) == 1) for (Unit& c : s) if ((unsigned)c > 0x7F) c = 'x';
+    return s;
+}
+
+template <class Unit>
+static std::vector<std::basic_string<Unit>> ParseDropBlock(const std::vector<uint8_t>& block, size_t unitBytes, bool* ok) {
+    std::vector<std::basic_string<Unit>> out;
+    relay::DropFilesView v;
+    *ok = relay::ParseDropFilesHeader(block.data(), block.size(), v, unitBytes);
+    if (!*ok) return out;
+    const uint8_t* lo = block.data();
+    const uint8_t* hi = block.data() + block.size();
+    relay::ForEachDropPath<Unit>(v.list, v.bytes, [&](const Unit* p, size_t n) {
+        if ((const uint8_t*)p < lo || (const uint8_t*)(p + n + 1) > hi || p[n] != 0) { *ok = false; return false; }
+        out.emplace_back(p, n);
+        return true;
+    });
+    return out;
+}
+
+// 往返 + 截断：截断后得到的必须是原列表的前缀
+template <class Unit>
+static bool CheckDropRoundTrip(std::mt19937& rng, bool wide, size_t maxLen, int rounds) {
+    for (int r = 0; r < rounds; ++r) {
+        std::vector<std::basic_string<Unit>> paths(rng() % 12);
+        for (auto& p : paths) p = RandomDropPath<Unit>(rng, maxLen);
+        std::vector<uint8_t> block = DropBlock(paths, wide);
+        bool ok = false;
+        if (ParseDropBlock<Unit>(block, sizeof(Unit), &ok) != paths || !ok) return false;
+        for (size_t cut = 0; cut < block.size(); cut += 1 + rng() % (7 + block.size() / 256)) {
+            std::vector<uint8_t> part(block.begin(), block.begin() + cut);
+            auto got = ParseDropBlock<Unit>(part, sizeof(Unit), &ok);
+            if (got.size() > paths.size() || !std::equal(got.begin(), got.end(), paths.begin())) return false;
+        }
+    }
+    return true;
+}
+
+// CIDA：cidl, aoffset[cidl + 1], 父 PIDL, 子 PIDL...
+static std::vector<uint8_t> RandomPidl(std::mt19937& rng, int items) {
+    std::vector<uint8_t> p;
+    for (int i = 0; i < items; ++i) {
+        uint16_t cb = (uint16_t)(2 + rng() % 40);
+        size_t at = p.size();
+        p.resize(at + cb);
+        memcpy(&p[at], &cb, 2);
+        for (size_t k = 2; k < cb; ++k) p[at + k] = (uint8_t)rng();
+    }
+    p.push_back(0);
+    p.push_back(0);
+    return p;
+}
+
+static std::vector<uint8_t> CidaBlock(const std::vector<uint8_t>& parent, const std::vector<std::vector<uint8_t>>& kids) {
+    uint32_t cidl = (uint32_t)kids.size();
+    std::vector<uint8_t> block(4 + 4 * (cidl + 1));
+    memcpy(block.data(), &cidl, 4);
+    auto put = [&](uint32_t i, const std::vector<uint8_t>& pidl) {
+        uint32_t off = (uint32_t)block.size();
+        memcpy(&block[4 + 4 * i], &off, 4);
+        block.insert(block.end(), pidl.begin(), pidl.end());
+    };
+    put(0, parent);
+    for (uint32_t i = 0; i < cidl; ++i) put(i + 1, kids[i]);
+    return block;
+}
+
+static bool CheckShellIdList(std::mt19937& rng, int rounds) {
+    std::vector<uint8_t> combined;
+    for (int r = 0; r < rounds; ++r) {
+        std::vector<uint8_t> parent = RandomPidl(rng, (int)(rng() % 4));
+        std::vector<std::vector<uint8_t>> kids(1 + rng() % 8);
+        for (auto& k : kids) k = RandomPidl(rng, 1 + (int)(rng() % 3));
+        std::vector<uint8_t> block = CidaBlock(parent, kids);
+
+        size_t seen = 0;
+        bool ok = true;
+        relay::ForEachShellItem(block.data(), block.size(), [&](const uint8_t* p, size_t pb, const uint8_t* c, size_t cb) {
+            if (seen >= kids.size() || pb != parent.size() || memcmp(p, parent.data(), pb) ||
+                cb != kids[seen].size() || memcmp(c, kids[seen].data(), cb)) {
+                ok = false;
+                return false;
+            }
+            relay::CombinePidl(p, pb, c, cb, combined);
+            std::vector<uint8_t> want(parent.begin(), parent.end() - 2);
+            want.insert(want.end(), kids[seen].begin(), kids[seen].end());
+            if (combined != want || relay::PidlBytes(combined.data(), combined.size()) != combined.size()) ok = false;
+            ++seen;
+            return ok;
+        });
+        if (!ok || seen != kids.size()) return false;
+
+        // 截断：只能少不能多，且回调的指针都在缓冲内
+        for (size_t cut = 0; cut < block.size(); ++cut) {
+            std::vector<uint8_t> part(block.begin(), block.begin() + cut);
+            const uint8_t* lo = part.data();
+            const uint8_t* hi = part.data() + part.size();
+            size_t n = relay::ForEachShellItem(part.data(), part.size(), [&](const uint8_t* p, size_t pb, const uint8_t* c, size_t cb) {
+                if (p < lo || p + pb > hi || c < lo || c + cb > hi) ok = false;
+                return true;
+            });
+            if (!ok || n > kids.size()) return false;
+        }
+    }
+    return true;
+}
+
+static bool CheckExtendedLengthPath() {
+    struct Case { const wchar_t* in; size_t threshold; const wchar_t* out; };
+    static const Case cases[] = {
+        {L"C:\\a\\b.txt", 260, L"C:\\a\\b.txt"},
+        {L"C:\\a\\b.txt", 0, L"\\\\?\\C:\\a\\b.txt"},
+        {L"c:/a/b.txt", 0, L"\\\\?\\c:\\a\\b.txt"},
+        {L"\\\\server\\share\\x", 0, L"\\\\?\\UNC\\server\\share\\x"},
+        {L"\\\\?\\C:\\already", 0, L"\\\\?\\C:\\already"},
+        {L"\\\\.\\pipe\\x", 0, L"\\\\.\\pipe\\x"},
+        {L"relative\\path", 0, L"relative\\path"},
+        {L"C:", 0, L"C:"},
+    };
+    for (const Case& c : cases) {
+        std::wstring buf;
+        if (relay::ExtendedLengthPath(c.in, wcslen(c.in), buf, c.threshold) != std::wstring(c.out)) return false;
+    }
+    std::wstring longPath = L"D:\\" + std::wstring(300, L'x');
+    std::wstring buf;
+    const wchar_t* got = relay::ExtendedLengthPath(longPath.c_str(), longPath.size(), buf);
+    return got == buf.c_str() && buf == L"\\\\?\\" + longPath;
+}
+
+// 改坏的块与随机字节：只要求不越界（ASan）且回调的路径都在缓冲内
+static bool FuzzDropParsers(std::mt19937& rng, int rounds) {
+    for (int r = 0; r < rounds; ++r) {
+        std::vector<std::u16string> paths(rng() % 6);
+        for (auto& p : paths) p = RandomDropPath<char16_t>(rng, 300);
+        std::vector<uint8_t> block = DropBlock(paths, true);
+        int flips = 1 + (int)(rng() % 4);
+        for (int k = 0; k < flips; ++k) {
+            size_t at = rng() % block.size();
+            block[at] = rng() % 2 ? 0 : (uint8_t)rng();
+        }
+        if (rng() % 8 == 0) {
+            uint32_t pf = (uint32_t)(rng() % (block.size() + 8));
+            memcpy(block.data(), &pf, 4);
+        }
+        bool ok = true;
+        ParseDropBlock<char16_t>(block, 2, &ok);
+        relay::DropFilesView v;
+        if (relay::ParseDropFilesHeader(block.data(), block.size(), v, 2) && !v.wide) {
+            ParseDropBlock<char>(block, 2, &ok);
+        }
+        if (!ok && relay::ParseDropFilesHeader(block.data(), block.size(), v, 2)) return false;
+
+        std::vector<std::vector<uint8_t>> kids(1 + rng() % 4);
+        for (auto& k : kids) k = RandomPidl(rng, 1 + (int)(rng() % 3));
+        std::vector<uint8_t> cida = CidaBlock(RandomPidl(rng, 2), kids);
+        for (int k = 0; k < flips; ++k) cida[rng() % cida.size()] = (uint8_t)(rng() % 3 ? rng() : 0xFF);
+        const uint8_t* lo = cida.data();
+        const uint8_t* hi = cida.data() + cida.size();
+        ok = true;
+        relay::ForEachShellItem(cida.data(), cida.size(), [&](const uint8_t* p, size_t pb, const uint8_t* c, size_t cb) {
+            if (p < lo || p + pb > hi || c < lo || c + cb > hi) ok = false;
+            return true;
+        });
+        if (!ok) return false;
+
+        std::vector<uint8_t> junk(rng() % 96);
+        for (uint8_t& b : junk) b = (uint8_t)rng();
+        ParseDropBlock<char16_t>(junk, 2, &ok);
+        relay::ForEachShellItem(junk.data(), junk.size(), [](const uint8_t*, size_t, const uint8_t*, size_t) { return true; });
+    }
+    return true;
+}
+
+static void BenchDrop() {
+    if (!Selected("drop/")) return;
+    std::mt19937 rng(34);
+    if (!CheckDropRoundTrip<wchar_t>(rng, true, 600, 300) || !CheckDropRoundTrip<char16_t>(rng, true, 40000, 20) ||
+        !CheckDropRoundTrip<char>(rng, false, 300, 300) || !CheckShellIdList(rng, 300) || !CheckExtendedLengthPath() ||
+        !FuzzDropParsers(rng, 200000)) {
+        fprintf(stderr, "drop precheck failed\n");
+        return;
+    }
+
+    // 1 万项、平均约 100 字符的路径（Windows 上的 UTF-16 布局）
+    const size_t N = 10000;
+    std::vector<std::u16string> paths(N);
+    for (auto& p : paths) p = RandomDropPath<char16_t>(rng, 200);
+    std::vector<uint8_t> block = DropBlock(paths, true);
+    size_t sum = 0;
+    Measure("drop/hdrop", "10k", N, Nothing, [&] {
+        relay::DropFilesView v;
+        relay::ParseDropFilesHeader(block.data(), block.size(), v);
+        relay::ForEachDropPath<char16_t>(v.list, v.bytes, [&](const char16_t*, size_t n) { sum += n; return true; });
+    });
+
+    std::vector<std::vector<uint8_t>> kids(N);
+    for (auto& k : kids) k = RandomPidl(rng, 1);
+    std::vector<uint8_t> cida = CidaBlock(RandomPidl(rng, 4), kids);
+    std::vector<uint8_t> combined;
+    Measure("drop/idlist", "10k", N, Nothing, [&] {
+        relay::ForEachShellItem(cida.data(), cida.size(), [&](const uint8_t* p, size_t pb, const uint8_t* c, size_t cb) {
+            relay::CombinePidl(p, pb, c, cb, combined);
+            sum += combined.size();
+            return true;
+        });
+    });
+    if (sum == 1) printf("\n");   // 防止被优化掉
+}
+
+// ---------------- http ----------------
+static int HttpConnect(uint16_t port) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in a{};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &a.sin_addr);
+    if (connect(s, (sockaddr*)&a, sizeof(a)) != 0) { close(s); return -1; }
+    int one = 1;
+    setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return s;
+}
+
+static bool SendAll(int s, const std::string& req) {
+    size_t off = 0;
+    while (off < req.size()) {
+        ssize_t k = send(s, req.data() + off, req.size() - off, MSG_NOSIGNAL);
+        if (k <= 0) return false;
+        off += (size_t)k;
+    }
+    return true;
+}
+
+// 响应头结束位置与 Content-Length；头还没收全返回 false
+static bool ParseResponseHead(const std::string& buf, size_t& bodyOff, uint64_t& length, int& status) {
+    size_t e = buf.find("\r\n\r\n");
+    if (e == std::string::npos) return false;
+    bodyOff = e + 4;
+    status = buf.size() > 12 ? atoi(buf.c_str() + 9) : 0;
+    length = 0;
+    size_t cl = buf.find("Content-Length: ");
+    if (cl != std::string::npos && cl < e) length = strtoull(buf.c_str() + cl + 16, nullptr, 10);
+    return true;
+}
+
+// 一次性请求（Connection: close），读到对端关闭；body 为 nullptr 时丢弃正文只计数
+static int HttpFetch(uint16_t port, const std::string& target, const char* extra, std::string* head,
+                     std::string* body, uint64_t* bodyBytes = nullptr) {
+    int s = HttpConnect(port);
+    if (s < 0) return -1;
+    std::string req = "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n";
+    if (extra) req += extra;
+    req += "\r\n";
+    if (!SendAll(s, req)) { close(s); return -1; }
+
+    std::string buf;
+    static char chunk[1 << 16];
+    size_t bodyOff = 0;
+    uint64_t length = 0, got = 0;
+    int status = -1;
+    bool haveHead = false;
+    ssize_t k;
+    while ((k = recv(s, chunk, sizeof(chunk), 0)) > 0) {
+        if (haveHead && !body) { got += (uint64_t)k; continue; }
+        buf.append(chunk, (size_t)k);
+        if (!haveHead && ParseResponseHead(buf, bodyOff, length, status)) {
+            haveHead = true;
+            if (!body) { got = buf.size() - bodyOff; buf.resize(bodyOff); }
+        }
+    }
+    close(s);
+    if (!haveHead) return -1;
+    if (head) *head = buf.substr(0, bodyOff);
+    if (body) { *body = buf.substr(bodyOff); got = body->size(); }
+    if (bodyBytes) *bodyBytes = got;
+    return got == length ? status : -2;
+}
+
+// 一个连接数档位：每个连接发一个请求、收完整响应再发下一个，共 total 个请求
+static void HttpLoad(uint16_t port, const std::string& target, int conns, int total) {
+    struct Client {
+        int s;
+        std::string in;
+        Clock::time_point sent;
+    };
+    std::vector<Client> cs;
+    for (int i = 0; i < conns; ++i) {
+        int s = HttpConnect(port);
+        if (s < 0) break;
+        fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+        cs.push_back(Client{s, std::string(), Clock::now()});
+    }
+    std::string req = "GET " + target + " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    std::vector<double> lat;
+    lat.reserve((size_t)total);
+    int issued = 0, errors = 0;
+    auto t0 = Clock::now();
+    for (Client& c : cs) {
+        if (issued >= total) break;
+        c.sent = Clock::now();
+        if (SendAll(c.s, req)) ++issued; else ++errors;
+    }
+
+    std::vector<pollfd> fds(cs.size());
+    for (size_t i = 0; i < cs.size(); ++i) fds[i] = pollfd{cs[i].s, POLLIN, 0};
+    static char chunk[1 << 16];
+    while ((int)lat.size() + errors < issued) {
+        if (poll(fds.data(), fds.size(), 5000) <= 0) { errors += issued - (int)lat.size() - errors; break; }
+        for (size_t i = 0; i < cs.size(); ++i) {
+            if (!fds[i].revents) continue;
+            Client& c = cs[i];
+            ssize_t k = recv(c.s, chunk, sizeof(chunk), 0);
+            if (k <= 0) { fds[i].fd = -1; ++errors; continue; }
+            c.in.append(chunk, (size_t)k);
+            size_t bodyOff;
+            uint64_t length;
+            int status;
+            if (!ParseResponseHead(c.in, bodyOff, length, status) || c.in.size() < bodyOff + length) continue;
+            if (status != 200) ++errors;
+            lat.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - c.sent).count());
+            c.in.erase(0, bodyOff + length);
+            if (issued < total) {
+                c.sent = Clock::now();
+                if (SendAll(c.s, req)) ++issued; else ++errors;
+            }
+        }
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+    for (Client& c : cs) close(c.s);
+
+    std::sort(lat.begin(), lat.end());
+    printf("{\"bench\":\"http/small/c%d\",\"trace\":\"loopback\",\"n\":%zu,\"requests\":%zu,\"errors\":%d,"
+           "\"req_per_sec\":%.0f,\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}\n",
+           conns, cs.size(), lat.size(), errors, lat.size() / secs, Percentile(lat, 0.5) / 1e3,
+           Percentile(lat, 0.9) / 1e3, Percentile(lat, 0.99) / 1e3, lat.empty() ? 0.0 : lat.back() / 1e3);
+    fflush(stdout);
+}
+
+// 一个连接上一口气发 n 个流水线请求（404 与小文件交替），另一线程同时读：
+// 响应个数、顺序、状态码与正文长度都要对得上
+static bool HttpPipelined(uint16_t port, const std::string& fileTarget, size_t fileBytes, int n) {
+    int s = HttpConnect(port);
+    if (s < 0) return false;
+    std::string reqs;
+    for (int i = 0; i < n; ++i) {
+        reqs += "GET ";
+        reqs += i % 2 ? fileTarget : std::string("/nope");
+        reqs += " HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    }
+    std::thread sender([&] { SendAll(s, reqs); });
+
+    std::string buf;
+    static char chunk[1 << 16];
+    int got = 0;
+    bool ok = true;
+    timeval tv{10, 0};
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    while (ok && got < n) {
+        size_t bodyOff;
+        uint64_t length;
+        int status;
+        if (ParseResponseHead(buf, bodyOff, length, status) && buf.size() >= bodyOff + length) {
+            ok = got % 2 ? (status == 200 && length == fileBytes) : status == 404;
+            buf.erase(0, bodyOff + length);
+            ++got;
+            continue;
+        }
+        ssize_t k = recv(s, chunk, sizeof(chunk), 0);
+        if (k <= 0) break;
+        buf.append(chunk, (size_t)k);
+    }
+    shutdown(s, SHUT_RDWR);
+    sender.join();
+    close(s);
+    return ok && got == n && buf.empty();
+}
+
+static bool WriteFileBytes(const std::string& path, const std::vector<uint8_t>& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    return fclose(f) == 0 && ok;
+}
+
+static void BenchHttp() {
+    if (!Selected("http/")) return;
+
+    char dir[] = "/tmp/relay_http_XXXXXX";
+    if (!mkdtemp(dir)) { fprintf(stderr, "http: mkdtemp failed\n"); return; }
+    std::mt19937 rng(30);
+    std::vector<uint8_t> large(64u << 20), small(4096);
+    for (uint8_t& b : large) b = (uint8_t)rng();
+    for (uint8_t& b : small) b = (uint8_t)rng();
+    std::string largePath = std::string(dir) + "/large.bin", smallPath = std::string(dir) + "/small.txt";
+    if (!WriteFileBytes(largePath, large) || !WriteFileBytes(smallPath, small)) {
+        fprintf(stderr, "http: cannot write test files under %s\n", dir);
+        return;
+    }
+
+    std::shared_ptr<relay::HttpShare> share = std::make_shared<relay::HttpShare>();
+    share->files.push_back(relay::HttpFile{largePath, "large.bin", large.size(), 0, false});
+    share->files.push_back(relay::HttpFile{smallPath, "small 文本.txt", small.size(), 0, false});
+
+    relay::HttpServer zero, copy;
+    relay::HttpServer::Options copyOpt;
+    copyOpt.zeroCopy = false;
+    if (!zero.Start("127.0.0.1", 0) || !copy.Start("127.0.0.1", 0, copyOpt)) {
+        fprintf(stderr, "http: cannot start server\n");
+        return;
+    }
+    zero.Publish(share);
+    copy.Publish(share);
+
+    // 正确性预检：失败就不报数字
+    std::string base = "/" + zero.Token() + "/";
+    std::string head, body;
+    int fails = 0;
+    auto check = [&](bool ok, const char* what) {
+        if (!ok) { fprintf(stderr, "http precheck failed: %s\n", what); ++fails; }
+    };
+    check(HttpFetch(zero.Port(), base, nullptr, nullptr, &body) == 200 &&
+          body.find("/f/1/small%20%E6%96%87%E6%9C%AC.txt") != std::string::npos, "index");
+    check(HttpFetch(zero.Port(), base + "f/1/x", nullptr, nullptr, &body) == 200 &&
+          body == std::string(small.begin(), small.end()), "small file");
+    check(HttpFetch(copy.Port(), "/" + copy.Token() + "/f/0/x", nullptr, nullptr, &body) == 200 &&
+          body == std::string(large.begin(), large.end()), "large file (copy)");
+    check(HttpFetch(zero.Port(), base + "f/0/x", nullptr, nullptr, &body) == 200 &&
+          body == std::string(large.begin(), large.end()), "large file (sendfile)");
+    check(HttpFetch(zero.Port(), base + "f/0/x", "Range: bytes=1000-1999\r\n", &head, &body) == 206 &&
+          body == std::string(large.begin() + 1000, large.begin() + 2000) &&
+          head.find("Content-Range: bytes 1000-1999/67108864") != std::string::npos, "range");
+    check(HttpFetch(zero.Port(), base + "f/1/x", "Range: bytes=-100\r\n", nullptr, &body) == 206 &&
+          body == std::string(small.end() - 100, small.end()), "suffix range");
+    check(HttpFetch(zero.Port(), base + "f/1/x", "Range: bytes=5000-\r\n", nullptr, &body) == 416, "416");
+    check(HttpFetch(zero.Port(), "/" + copy.Token() + "/", nullptr, nullptr, &body) == 404, "bad token");
+    check(HttpFetch(zero.Port(), base + "f/9/x", nullptr, nullptr, &body) == 404, "bad index");
+    check(HttpPipelined(zero.Port(), base + "f/1/x", small.size(), 20000), "pipelined keep-alive");
+
+    // 关掉再开：旧快照不再服务，关闭前的旧版本发布也不会复活
+    {
+        relay::HttpServer restart;
+        auto version = [&](uint64_t v) {
+            std::shared_ptr<relay::HttpShare> s = std::make_shared<relay::HttpShare>(*share);
+            s->version = v;
+            return s;
+        };
+        std::shared_ptr<relay::HttpShare> v5 = version(5), v3 = version(3), v6 = version(6);
+        bool ok = restart.Start("127.0.0.1", 0);
+        restart.Publish(v5);
+        ok = ok && HttpFetch(restart.Port(), "/" + restart.Token() + "/", nullptr, nullptr, &body) == 200;
+        restart.Stop();
+        ok = ok && restart.Start("127.0.0.1", 0);
+        ok = ok && HttpFetch(restart.Port(), "/" + restart.Token() + "/", nullptr, nullptr, &body) == 404;
+        restart.Publish(v3);
+        ok = ok && HttpFetch(restart.Port(), "/" + restart.Token() + "/", nullptr, nullptr, &body) == 404;
+        restart.Publish(v6);
+        ok = ok && HttpFetch(restart.Port(), "/" + restart.Token() + "/", nullptr, nullptr, &body) == 200;
+        restart.Stop();
+        check(ok, "stop clears the published list");
+    }
+
+    if (!fails) {
+        uint64_t sink = 0;
+        Measure("http/large/sendfile", "loopback", large.size(), Nothing, [&] {
+            uint64_t got = 0;
+            HttpFetch(zero.Port(), base + "f/0/x", nullptr, nullptr, nullptr, &got);
+            sink += got;
+        });
+        Measure("http/large/copy", "loopback", large.size(), Nothing, [&] {
+            uint64_t got = 0;
+            HttpFetch(copy.Port(), "/" + copy.Token() + "/f/0/x", nullptr, nullptr, nullptr, &got);
+            sink += got;
+        });
+        for (int conns : {1, 16, 64, 256, 1024}) {
+            std::string name = "http/small/c" + std::to_string(conns);
+            if (Selected(name + " loopback")) HttpLoad(zero.Port(), base + "f/1/x", conns, std::max(20000, conns * 20));
+        }
+        if (sink == 42) puts("");
+    }
+
+    zero.Stop();
+    copy.Stop();
+    unlink(largePath.c_str());
+    unlink(smallPath.c_str());
+    rmdir(dir);
+}
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        const char* next = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (a == "--filter" && next) { g_opt.filter = next; ++i; }
+        else if (a == "--trace" && next) { g_opt.traces.push_back(next); ++i; }
+        else if (a == "--ini" && next) { g_opt.ini = next; ++i; }
+        else if (a == "--max-count" && next) { g_opt.maxCount = std::max(1, atoi(next)); ++i; }
+        else if (a == "--iters" && next) { g_opt.iters = std::max(1, atoi(next)); ++i; }
+        else if (a == "--zip-out" && next) { g_opt.zipOut = next; ++i; }
+        else if (a == "--startup-log" && next) { g_opt.startupLogs.push_back(next); ++i; }
+        else {
+            fprintf(stderr, "usage: %s [--filter s] [--trace file]... [--ini file] [--max-count n] [--iters n] [--zip-out file]"
+                            " [--startup-log file]...\n", argv[0]);
+            return 2;
+        }
+    }
+
+    BenchIni();
+    BenchTipLayout();
+    BenchIdle();
+    BenchZip();
+    BenchExec();
+    BenchHistory();
+    BenchStartup();
+    BenchDrop();
+    BenchHttp();
+
+    if (!g_opt.traces.empty()) {
+        for (const char* file : g_opt.traces) {
+            Trace t;
+            if (!LoadTrace(file, t)) { fprintf(stderr, "cannot load trace %s\n", file); return 1; }
+            BenchTrace(t);
+        }
+        return 0;
+    }
+
+    for (size_t files : {(size_t)10, (size_t)1000, (size_t)100000}) {
+        for (bool longPath : {false, true}) BenchTrace(SyntheticTrace(files, longPath));
+    }
+    return 0;
+}
@@ -2,40 +2,122 @@
 // 功能：
 // - 任务栏上方悬浮小窗，显示已保存文件数量
 // - 拖入文件：默认覆盖；按住 Ctrl 拖入：追加（最多 max_count）
+//   OLE 拖放目标：悬停时按 Ctrl 显示“覆盖/追加”提示；直接解析 CF_HDROP / Shell IDList，路径不受 MAX_PATH 限制
 // - 从小窗拖出：OLE DoDragDrop，CF_HDROP 多文件
 // - Win+D/截图遮罩等导致消失：自愈定时器 heal_interval_ms 拉回显示并置顶
 // - 右键：弹出美观 tip（#f9f9f9，字体大小可配），位置在“底部任务栏上方居中”
 //   tip 高度随文件数量自适应，超过 max_lines（默认30）不再增长，最后一行显示剩余数量
 // - Ctrl + 右键：退出
+// - Shift + 右键：切换排序方式（拖入顺序/名称/扩展名/大小/修改时间/文件夹），并写回 config.ini
+// - 排序/分组通过 config.ini [list] 配置；拖出顺序跟随排序，分组只影响 tip 显示
+// - 空闲模式：[idle] after_ms 无交互后释放 tip 的字体/画刷/文本缓冲、压缩列表存储、裁剪工作集，
+//   下次交互时按需重建
+// - Alt + 拖出：整个列表作为一个 ZIP 拖出（边压缩边给目标读取，不落盘）；[zip] default=1 时反过来
+// - Alt + 右键：显示内存诊断（私有字节、工作集、列表占用）
+// - 撤销/重做：滚轮向上撤销、向下重做（覆盖拖入、追加、移除、清空都可撤销），步数由 [history] depth 配置
+// - Ctrl + 中键：清空列表；Shift + 中键：移除已不存在的文件
+// - 中键：开/关内置 HTTP 共享（索引页 + 下载，支持断点续传），地址带随机 token，开启时复制到剪贴板；
+//   [http] bind=0.0.0.0 时局域网可访问
+// - 后台执行器：[executor] workers 个工作线程；大列表排序、ZIP 压缩、文件存在性探测、共享列表属性探测、
+//   轨迹写盘、工作集裁剪都不在界面线程上做，结果攒批回到界面线程（消息循环用 MsgWaitForMultipleObjectsEx 同时等）
+// - 冷启动：只读 ini、注册主窗口类、建窗口并画出首帧；OLE、后台线程、HTTP 自启动、补写默认 ini
+//   都在首帧之后做，tip 窗口类第一次弹 tip 时才注册
+// - --trace-startup[=文件]：记录各启动阶段耗时，追加一行 JSON 到文件（默认 exe 目录 startup_trace.log）
+// - [debug] drop_trace=路径：把每次拖入追加记录到文件，可用 bench 回放
 // - x/y 支持负数：距右侧(-x)、距底部(-y)
 // - 位置/颜色/字体/透明(可选)/tip参数 通过 config.ini
 //
 // 编译（MinGW-w64）:
-// g++ -std=c++17 -Os -s -mwindows main.cpp -o FileRelayDock.exe -lole32 -lshell32 -luuid
+// g++ -std=c++17 -Os -s -mwindows main.cpp -o FileRelayDock.exe -lole32 -lshell32 -luuid -lpsapi -lws2_32 -lmswsock -lbcrypt
 
 #define UNICODE
 #define _UNICODE
+#define NOMINMAX
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0601   // WSAPoll
+#endif
 
+#include <winsock2.h>
 #include <windows.h>
 #include <windowsx.h>
 #include <shellapi.h>
 #include <shlobj.h>
 #include <objidl.h>
 #include <strsafe.h>
+#include <psapi.h>
+
+#include "relay_core.h"
+#include "relay_drop.h"
+#include "relay_exec.h"
+#include "relay_history.h"
+#include "relay_httpd.h"
+#include "relay_idle.h"
+#include "relay_startup.h"
+#include "relay_list.h"
+#include "relay_zip.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
 
 // ---------------- constants ----------------
-static const int HARD_MAX = 100;
+// max_count 的上限；列表相关的缓冲都按实际条数分配
+static const int HARD_MAX = 100000;
 #define TIMER_HEAL      1
 #define TIMER_TIP_CLOSE 2
+#define TIMER_IDLE      3
+
+// 首帧画完后投递给自己：做不影响首帧的初始化
+#define WM_APP_DEFERRED_INIT (WM_APP + 1)
 
 // ---------------- global state ----------------
-static wchar_t g_paths[HARD_MAX][MAX_PATH];
-static wchar_t g_names[HARD_MAX][MAX_PATH];
-static int g_count = 0;
+// 中转列表：路径连续存放，空闲时压缩
+static relay::PathList g_list;
+
+// 排序后的显示/拖出顺序（g_list 下标）
+static relay::SortView g_view;
+
+// 列表的历史版本（结构共享）；g_list 始终等于 g_history.Current()
+static relay::ListHistory g_history;
+static int g_wheelAccum = 0;
+
+static relay::IdleTracker g_idle;
+static relay::HttpServer g_http;
+static uint64_t g_httpShareVersion = 0;
+static relay::CompactPolicy g_compactPolicy;
+
+// 后台执行器；完成回调由工作线程 SetEvent(g_execEvent) 通知消息循环
+static relay::Executor g_exec;
+static HANDLE g_execEvent = NULL;
+
+// 列表一变（拖入、撤销、清空……）就作废还没回来的后台结果
+static relay::CancelSource g_listJobs;
+
+// 拖入悬停提示：0=无，1=覆盖，2=Ctrl 追加
+static int g_dropHint = 0;
+static bool g_dragOutActive = false;       // DoDragDrop 进行中：拖回自己不收
+static IDropTarget* g_dropTarget = NULL;   // 首帧后 RegisterDragDrop；失败时仍走 WM_DROPFILES
+
+// 冷启动：首帧之后才做的事
+static bool g_oleReady = false;
+static bool g_tipClassReady = false;
+static bool g_iniMissing = false;          // 首帧后再补写默认 ini
+
+// --trace-startup
+static relay::StartupTrace g_startup;
+static std::wstring g_startupLogPath;
+
+// 拖入轨迹攒在这里由后台按序写盘；同一时刻只有一个写任务
+static std::mutex g_traceMu;
+static std::string g_tracePending;
+static bool g_traceWriting = false;
 
 static HFONT  g_mainFont = NULL;
 static HBRUSH g_mainBgBrush = NULL;
 
+// tip 专用资源：首次显示 tip 时创建，空闲时释放
 static HFONT  g_tipFont = NULL;
 static HBRUSH g_tipBgBrush = NULL;
 
@@ -46,7 +128,8 @@ static wchar_t g_iniPath[MAX_PATH] = L"";
 
 // right-click tip window
 static HWND g_tipWnd = NULL;
-static wchar_t g_tipText[16384];
+static const size_t TIP_TEXT_CCH = 16384;
+static wchar_t* g_tipText = NULL;   // 按需分配，空闲时释放
 
 // window classes
 static const wchar_t MAIN_CLASS[] = L"FileRelayDockWnd";
@@ -83,15 +166,95 @@ struct AppStyle {
     int tipFontSize = 9;            // configurable
     int tipMargin = 8;               // distance from taskbar edge
     bool tipClickThrough = false;    // if true, tip won't capture mouse (HTTRANSPARENT)
+
+    // list order
+    relay::SortMode sortMode = relay::SORT_DROP;
+    relay::GroupMode groupMode = relay::GROUP_NONE;
+
+    // idle mode
+    int idleAfterMs = 60000;         // 无交互多久后进入空闲；0=off
+    bool idleTrimWorkingSet = true;  // 进入空闲时裁剪工作集
+
+    // zip drag-out
+    bool zipDefault = false;                 // true：默认拖出 ZIP，Alt 拖出原文件
+    wchar_t zipName[MAX_PATH] = L"FileRelay.zip";
+    relay::ZipMethod zipMethod = relay::ZIP_AUTO;
+    int zipThreads = 0;                      // 同时在压的块数；0=后台线程数
+
+    // background executor
+    int execWorkers = 0;                     // 0=CPU 核数（最多 4）
+
+    // undo/redo
+    int historyDepth = 50;                   // 最多可撤销步数；0=off
+
+    // http share
+    bool httpAutostart = false;
+    char httpBind[64] = "127.0.0.1";         // 0.0.0.0 = 局域网
+    int httpPort = 8765;                     // 0 = 系统分配
+
+    wchar_t dropTracePath[MAX_PATH] = L"";   // 非空时记录拖入轨迹
 } g_style;
 
+static const wchar_t* const SORT_KEYS[relay::SORT_MODE_COUNT] = {
+    L"drop", L"name", L"ext", L"size", L"mtime", L"folder"
+};
+static const wchar_t* const SORT_LABELS[relay::SORT_MODE_COUNT] = {
+    L"拖入顺序", L"名称", L"扩展名", L"大小", L"修改时间", L"文件夹"
+};
+static const wchar_t* const GROUP_KEYS[] = { L"none", L"folder", L"ext" };
+static const wchar_t* const ZIP_METHOD_KEYS[] = { L"auto", L"deflate", L"store" };
+static const wchar_t* const HISTORY_LABELS[relay::HISTORY_OP_COUNT] = {
+    L"", L"覆盖拖入", L"追加拖入", L"移除", L"清空"
+};
+
 // ---------------- ini helpers ----------------
-static int IniInt(const wchar_t* section, const wchar_t* key, int def, const wchar_t* ini) {
-    return (int)GetPrivateProfileIntW(section, key, def, ini);
+static int IniInt(const wchar_t* section, const wchar_t* key, int def, const relay::IniDoc& ini) {
+    return ini.Int(section, key, def);
 }
 static void IniStr(const wchar_t* section, const wchar_t* key, const wchar_t* def,
-                   wchar_t* out, DWORD outcch, const wchar_t* ini) {
-    GetPrivateProfileStringW(section, key, def, out, outcch, ini);
+                   wchar_t* out, DWORD outcch, const relay::IniDoc& ini) {
+    StringCchCopyW(out, outcch, ini.Str(section, key, def));
+}
+
+// config.ini 的大小上限；超过时提示并全部取默认值，而不是截断在某个键的中间
+static const LONGLONG INI_MAX_BYTES = 1 << 20;
+
+// 整个 ini 只读一次；读不到时 doc 为空，所有键取默认值
+static void ReadIniDoc(const wchar_t* iniPath, relay::IniDoc& doc) {
+    HANDLE h = CreateFileW(iniPath, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                           OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (h == INVALID_HANDLE_VALUE) { doc.Parse(L"", 0); return; }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(h, &size)) size.QuadPart = 0;
+    if (size.QuadPart > INI_MAX_BYTES) {
+        CloseHandle(h);
+        doc.Parse(L"", 0);
+        wchar_t msg[MAX_PATH + 64];
+        StringCchPrintfW(msg, _countof(msg), L"%s 超过 %d KB，已忽略并使用默认设置。",
+                         iniPath, (int)(INI_MAX_BYTES >> 10));
+        MessageBoxW(NULL, msg, L"提示", MB_OK | MB_ICONWARNING);
+        return;
+    }
+
+    // ReadFile 可能分几次返回，读到 EOF 为止
+    std::vector<BYTE> raw((size_t)size.QuadPart);
+    DWORD got = 0;
+    while (got < raw.size()) {
+        DWORD n = 0;
+        if (!ReadFile(h, raw.data() + got, (DWORD)raw.size() - got, &n, NULL) || n == 0) break;
+        got += n;
+    }
+    CloseHandle(h);
+
+    std::wstring text;
+    if (!relay::DecodeIniBytes(raw.data(), got, text)) {
+        // 不是 UTF-8：按本地代码页（与 GetPrivateProfile* 一致）
+        int n = MultiByteToWideChar(CP_ACP, 0, (const char*)raw.data(), (int)got, NULL, 0);
+        text.resize(n > 0 ? n : 0);
+        if (n > 0) MultiByteToWideChar(CP_ACP, 0, (const char*)raw.data(), (int)got, &text[0], n);
+    }
+    doc.Parse(text.c_str(), text.size());
 }
 static COLORREF ParseColor(const wchar_t* s, COLORREF def) {
     if (!s || !*s) return def;
@@ -105,6 +268,25 @@ static COLORREF ParseColor(const wchar_t* s, COLORREF def) {
     return def;
 }
 
+static relay::SortMode ParseSortMode(const wchar_t* s) {
+    for (int i = 0; i < relay::SORT_MODE_COUNT; ++i) {
+        if (_wcsicmp(s, SORT_KEYS[i]) == 0) return (relay::SortMode)i;
+    }
+    return relay::SORT_DROP;
+}
+static relay::GroupMode ParseGroupMode(const wchar_t* s) {
+    for (int i = 0; i < (int)_countof(GROUP_KEYS); ++i) {
+        if (_wcsicmp(s, GROUP_KEYS[i]) == 0) return (relay::GroupMode)i;
+    }
+    return relay::GROUP_NONE;
+}
+static relay::ZipMethod ParseZipMethod(const wchar_t* s) {
+    for (int i = 0; i < (int)_countof(ZIP_METHOD_KEYS); ++i) {
+        if (_wcsicmp(s, ZIP_METHOD_KEYS[i]) == 0) return (relay::ZipMethod)i;
+    }
+    return relay::ZIP_AUTO;
+}
+
 static void ResolveXY(int& x, int& y, int w, int h) {
     const int sw = GetSystemMetrics(SM_CXSCREEN);
     const int sh = GetSystemMetrics(SM_CYSCREEN);
@@ -118,32 +300,43 @@ static void ResolveXY(int& x, int& y, int w, int h) {
     if (y > sh - h) y = sh - h;
 }
 
-static void RebuildGdiObjects() {
-    if (g_mainFont) { DeleteObject(g_mainFont); g_mainFont = NULL; }
-    if (g_tipFont)  { DeleteObject(g_tipFont);  g_tipFont  = NULL; }
-    if (g_mainBgBrush) { DeleteObject(g_mainBgBrush); g_mainBgBrush = NULL; }
-    if (g_tipBgBrush)  { DeleteObject(g_tipBgBrush);  g_tipBgBrush  = NULL; }
-
+static int ScreenLogPixelsY() {
     HDC hdc = GetDC(NULL);
     int logPix = GetDeviceCaps(hdc, LOGPIXELSY);
     ReleaseDC(NULL, hdc);
+    return logPix;
+}
+
+static void ReleaseTipGdiObjects() {
+    if (g_tipFont)  { DeleteObject(g_tipFont);  g_tipFont  = NULL; }
+    if (g_tipBgBrush)  { DeleteObject(g_tipBgBrush);  g_tipBgBrush  = NULL; }
+}
+
+// tip 很少显示：字体/画刷在第一次用到时才创建
+static void EnsureTipGdiObjects() {
+    if (!g_tipFont) {
+        LOGFONTW tf{};
+        tf.lfHeight = -MulDiv(g_style.tipFontSize, ScreenLogPixelsY(), 72);
+        tf.lfWeight = FW_NORMAL;
+        StringCchCopyW(tf.lfFaceName, LF_FACESIZE, L"Segoe UI");
+        g_tipFont = CreateFontIndirectW(&tf);
+    }
+    if (!g_tipBgBrush) g_tipBgBrush = CreateSolidBrush(RGB(0xF9, 0xF9, 0xF9)); // #f9f9f9
+}
+
+static void RebuildGdiObjects() {
+    if (g_mainFont) { DeleteObject(g_mainFont); g_mainFont = NULL; }
+    if (g_mainBgBrush) { DeleteObject(g_mainBgBrush); g_mainBgBrush = NULL; }
+    ReleaseTipGdiObjects();
 
     // main font
     LOGFONTW lf{};
-    lf.lfHeight = -MulDiv(g_style.fontSize, logPix, 72);
+    lf.lfHeight = -MulDiv(g_style.fontSize, ScreenLogPixelsY(), 72);
     lf.lfWeight = FW_NORMAL;
     StringCchCopyW(lf.lfFaceName, LF_FACESIZE, g_style.fontName);
     g_mainFont = CreateFontIndirectW(&lf);
 
-    // tip font
-    LOGFONTW tf{};
-    tf.lfHeight = -MulDiv(g_style.tipFontSize, logPix, 72);
-    tf.lfWeight = FW_NORMAL;
-    StringCchCopyW(tf.lfFaceName, LF_FACESIZE, L"Segoe UI");
-    g_tipFont = CreateFontIndirectW(&tf);
-
     g_mainBgBrush = CreateSolidBrush(g_style.bg);
-    g_tipBgBrush  = CreateSolidBrush(RGB(0xF9, 0xF9, 0xF9)); // #f9f9f9
 }
 
 static bool FileExists(const wchar_t* path) {
@@ -179,6 +372,7 @@ static void WriteDefaultIni(const wchar_t* iniPath) {
     writeW(L"; x/y 支持负数：x=-20 表示离右侧20px，y=-60 表示离底部60px\r\n");
     writeW(L"; 拖入：默认覆盖；按住 Ctrl 拖入=追加\r\n");
     writeW(L"; 右键显示tip；按住 Ctrl + 右键退出程序 \r\n");
+    writeW(L"; 按住 Shift + 右键切换排序方式\r\n");
     writeW(L"\r\n");
 
     StringCchPrintfW(buf, 2048,
@@ -240,73 +434,338 @@ static void WriteDefaultIni(const wchar_t* iniPath) {
     );
     writeW(buf);
 
+    StringCchPrintfW(buf, 2048,
+        L"[list]\r\n"
+        L"; sort: drop/name/ext/size/mtime/folder（name 为自然序：file2 在 file10 之前）\r\n"
+        L"sort=%s\r\n"
+        L"; group: none/folder/ext（只影响 tip 显示）\r\n"
+        L"group=%s\r\n"
+        L"\r\n",
+        SORT_KEYS[g_style.sortMode],
+        GROUP_KEYS[g_style.groupMode]
+    );
+    writeW(buf);
+
+    StringCchPrintfW(buf, 2048,
+        L"[idle]\r\n"
+        L"; 无交互 after_ms 毫秒后释放 tip 资源、压缩列表、裁剪工作集；0=关闭\r\n"
+        L"after_ms=%d\r\n"
+        L"trim_working_set=%d\r\n"
+        L"\r\n",
+        g_style.idleAfterMs,
+        g_style.idleTrimWorkingSet ? 1 : 0
+    );
+    writeW(buf);
+
+    StringCchPrintfW(buf, 2048,
+        L"[zip]\r\n"
+        L"; Alt + 拖出 = 整个列表作为一个 ZIP；default=1 时默认拖出 ZIP，Alt 拖出原文件\r\n"
+        L"default=%d\r\n"
+        L"name=%s\r\n"
+        L"; method: auto（已压缩格式原样存入）/deflate/store\r\n"
+        L"method=%s\r\n"
+        L"; 同时压缩的块数；0=后台线程数\r\n"
+        L"threads=%d\r\n"
+        L"\r\n",
+        g_style.zipDefault ? 1 : 0,
+        g_style.zipName,
+        ZIP_METHOD_KEYS[g_style.zipMethod],
+        g_style.zipThreads
+    );
+    writeW(buf);
+
+    StringCchPrintfW(buf, 2048,
+        L"[executor]\r\n"
+        L"; 后台线程数；0=CPU 核数（最多 4）\r\n"
+        L"workers=%d\r\n"
+        L"\r\n",
+        g_style.execWorkers
+    );
+    writeW(buf);
+
+    StringCchPrintfW(buf, 2048,
+        L"[history]\r\n"
+        L"; 滚轮撤销/重做的最多步数；0=关闭\r\n"
+        L"depth=%d\r\n"
+        L"\r\n",
+        g_style.historyDepth
+    );
+    writeW(buf);
+
+    StringCchPrintfW(buf, 2048,
+        L"[http]\r\n"
+        L"; 中键开/关 HTTP 共享；bind=127.0.0.1 仅本机，0.0.0.0 局域网\r\n"
+        L"autostart=%d\r\n"
+        L"bind=%hs\r\n"
+        L"; 0=系统分配\r\n"
+        L"port=%d\r\n"
+        L"\r\n",
+        g_style.httpAutostart ? 1 : 0,
+        g_style.httpBind,
+        g_style.httpPort
+    );
+    writeW(buf);
+
     CloseHandle(h);
 }
 
 static void LoadIniStyle(const wchar_t* iniPath) {
-    g_style.x = IniInt(L"window", L"x", -430, iniPath);
-    g_style.y = IniInt(L"window", L"y", -1, iniPath);
-    g_style.w = IniInt(L"window", L"w", 60, iniPath);
-    g_style.h = IniInt(L"window", L"h", 43, iniPath);
-    g_style.topmost = IniInt(L"window", L"topmost", 1, iniPath) != 0;
+    relay::IniDoc ini;
+    ReadIniDoc(iniPath, ini);
 
-    g_style.healIntervalMs = IniInt(L"window", L"heal_interval_ms", 1000, iniPath);
+    g_style.x = IniInt(L"window", L"x", -430, ini);
+    g_style.y = IniInt(L"window", L"y", -1, ini);
+    g_style.w = IniInt(L"window", L"w", 60, ini);
+    g_style.h = IniInt(L"window", L"h", 43, ini);
+    g_style.topmost = IniInt(L"window", L"topmost", 1, ini) != 0;
+
+    g_style.healIntervalMs = IniInt(L"window", L"heal_interval_ms", 1000, ini);
     if (g_style.healIntervalMs < 0) g_style.healIntervalMs = 0;
 
-    g_style.maxCount = IniInt(L"window", L"max_count", 100, iniPath);
+    g_style.maxCount = IniInt(L"window", L"max_count", 100, ini);
     if (g_style.maxCount < 1) g_style.maxCount = 1;
     if (g_style.maxCount > HARD_MAX) g_style.maxCount = HARD_MAX;
 
     wchar_t buf[128];
-    IniStr(L"style", L"bg", L"0xffffff", buf, 128, iniPath);
+    IniStr(L"style", L"bg", L"0xffffff", buf, 128, ini);
     g_style.bg = ParseColor(buf, RGB(0x20, 0x20, 0x20));
-    IniStr(L"style", L"fg", L"0x333", buf, 128, iniPath);
+    IniStr(L"style", L"fg", L"0x333", buf, 128, ini);
     g_style.fg = ParseColor(buf, RGB(0xFF, 0xFF, 0xFF));
 
-    g_style.fontSize = IniInt(L"style", L"font_size", 16, iniPath);
-    IniStr(L"style", L"font_name", L"Segoe UI", g_style.fontName, 64, iniPath);
+    g_style.fontSize = IniInt(L"style", L"font_size", 16, ini);
+    IniStr(L"style", L"font_name", L"Segoe UI", g_style.fontName, 64, ini);
 
-    g_style.showSingleTip = IniInt(L"window", L"show_single_tip", 0, iniPath) != 0;
+    g_style.showSingleTip = IniInt(L"window", L"show_single_tip", 0, ini) != 0;
 
     // main window transparency (optional)
-    g_style.layered = IniInt(L"style", L"layered", 0, iniPath) != 0;
-    int a = IniInt(L"style", L"alpha", 255, iniPath);
+    g_style.layered = IniInt(L"style", L"layered", 0, ini) != 0;
+    int a = IniInt(L"style", L"alpha", 255, ini);
     if (a < 0) a = 0; if (a > 255) a = 255;
     g_style.alpha = (BYTE)a;
 
-    g_style.useColorKey = IniInt(L"style", L"colorkey", 0, iniPath) != 0;
-    IniStr(L"style", L"colorkey_rgb", L"0x202020", buf, 128, iniPath);
+    g_style.useColorKey = IniInt(L"style", L"colorkey", 0, ini) != 0;
+    IniStr(L"style", L"colorkey_rgb", L"0x202020", buf, 128, ini);
     g_style.colorKey = ParseColor(buf, RGB(0x20, 0x20, 0x20));
 
     // tip config
-    g_style.tipAutoCloseMs = IniInt(L"tip", L"auto_close_ms", 2000, iniPath);
+    g_style.tipAutoCloseMs = IniInt(L"tip", L"auto_close_ms", 2000, ini);
     if (g_style.tipAutoCloseMs < 0) g_style.tipAutoCloseMs = 0;
 
-    g_style.tipWidth = IniInt(L"tip", L"w", 320, iniPath);
+    g_style.tipWidth = IniInt(L"tip", L"w", 320, ini);
     if (g_style.tipWidth < 180) g_style.tipWidth = 180;
 
-    g_style.tipMinH = IniInt(L"tip", L"min_h", 80, iniPath);
+    g_style.tipMinH = IniInt(L"tip", L"min_h", 80, ini);
     if (g_style.tipMinH < 60) g_style.tipMinH = 60;
 
-    g_style.tipMaxLines = IniInt(L"tip", L"max_lines", 30, iniPath);
+    g_style.tipMaxLines = IniInt(L"tip", L"max_lines", 30, ini);
     if (g_style.tipMaxLines < 1) g_style.tipMaxLines = 1;
     if (g_style.tipMaxLines > 200) g_style.tipMaxLines = 200;
 
-    g_style.tipMaxH = IniInt(L"tip", L"max_h", 0, iniPath);
+    g_style.tipMaxH = IniInt(L"tip", L"max_h", 0, ini);
     if (g_style.tipMaxH < 0) g_style.tipMaxH = 0;
 
-    g_style.tipFontSize = IniInt(L"tip", L"font_size", 9, iniPath);
+    g_style.tipFontSize = IniInt(L"tip", L"font_size", 9, ini);
     if (g_style.tipFontSize < 8)  g_style.tipFontSize = 8;
     if (g_style.tipFontSize > 28) g_style.tipFontSize = 28;
 
-    g_style.tipMargin = IniInt(L"tip", L"margin", 8, iniPath);
+    g_style.tipMargin = IniInt(L"tip", L"margin", 8, ini);
     if (g_style.tipMargin < 0) g_style.tipMargin = 0;
 
-    g_style.tipClickThrough = IniInt(L"tip", L"click_through", 0, iniPath) != 0;
+    g_style.tipClickThrough = IniInt(L"tip", L"click_through", 0, ini) != 0;
+
+    // list order
+    IniStr(L"list", L"sort", L"drop", buf, 128, ini);
+    g_style.sortMode = ParseSortMode(buf);
+    IniStr(L"list", L"group", L"none", buf, 128, ini);
+    g_style.groupMode = ParseGroupMode(buf);
+
+    // idle mode
+    g_style.idleAfterMs = IniInt(L"idle", L"after_ms", 60000, ini);
+    if (g_style.idleAfterMs < 0) g_style.idleAfterMs = 0;
+    if (g_style.idleAfterMs > 0 && g_style.idleAfterMs < 1000) g_style.idleAfterMs = 1000;
+    g_style.idleTrimWorkingSet = IniInt(L"idle", L"trim_working_set", 1, ini) != 0;
+
+    // zip drag-out
+    g_style.zipDefault = IniInt(L"zip", L"default", 0, ini) != 0;
+    IniStr(L"zip", L"name", L"FileRelay.zip", g_style.zipName, MAX_PATH, ini);
+    if (!g_style.zipName[0]) StringCchCopyW(g_style.zipName, MAX_PATH, L"FileRelay.zip");
+    IniStr(L"zip", L"method", L"auto", buf, 128, ini);
+    g_style.zipMethod = ParseZipMethod(buf);
+    g_style.zipThreads = IniInt(L"zip", L"threads", 0, ini);
+    if (g_style.zipThreads < 0) g_style.zipThreads = 0;
+    if (g_style.zipThreads > 64) g_style.zipThreads = 64;
+
+    // background executor
+    g_style.execWorkers = IniInt(L"executor", L"workers", 0, ini);
+    if (g_style.execWorkers < 0) g_style.execWorkers = 0;
+    if (g_style.execWorkers > 64) g_style.execWorkers = 64;
+
+    // undo/redo
+    g_style.historyDepth = IniInt(L"history", L"depth", 50, ini);
+    if (g_style.historyDepth < 0) g_style.historyDepth = 0;
+    if (g_style.historyDepth > 1000) g_style.historyDepth = 1000;
+
+    // http share
+    g_style.httpAutostart = IniInt(L"http", L"autostart", 0, ini) != 0;
+    IniStr(L"http", L"bind", L"127.0.0.1", buf, 128, ini);
+    if (!WideCharToMultiByte(CP_ACP, 0, buf, -1, g_style.httpBind, (int)sizeof(g_style.httpBind), NULL, NULL) ||
+        !g_style.httpBind[0]) {
+        StringCchCopyA(g_style.httpBind, _countof(g_style.httpBind), "127.0.0.1");
+    }
+    g_style.httpPort = IniInt(L"http", L"port", 8765, ini);
+    if (g_style.httpPort < 0 || g_style.httpPort > 65535) g_style.httpPort = 8765;
+
+    IniStr(L"debug", L"drop_trace", L"", g_style.dropTracePath, MAX_PATH, ini);
 
     RebuildGdiObjects();
 }
 
+// ---------------- relay list ----------------
+static void FillSortItems(const relay::PathList& list, std::vector<relay::SortItem>& items) {
+    items.resize(list.Count());
+    for (int i = 0; i < list.Count(); ++i) {
+        items[i].path = list.Path(i);
+        items[i].size = list.Size(i);
+        items[i].mtime = list.Mtime(i);
+    }
+}
+
+// 行指针：relay_core 的函数按指针数组访问列表（g_list 有增删时需重新获取）
+static void FillRows(std::vector<const wchar_t*>* paths, std::vector<const wchar_t*>* names) {
+    if (paths) paths->resize(g_list.Count());
+    if (names) names->resize(g_list.Count());
+    for (int i = 0; i < g_list.Count(); ++i) {
+        if (paths) (*paths)[i] = g_list.Path(i);
+        if (names) (*names)[i] = g_list.Name(i);
+    }
+}
+
+// 大小/修改时间只在拖入时取一次，排序时不再访问磁盘
+static void StatEntry(int i) {
+    WIN32_FILE_ATTRIBUTE_DATA fad;
+    std::wstring ext;
+    const wchar_t* path = g_list.Path(i);
+    if (GetFileAttributesExW(relay::ExtendedLengthPath(path, wcslen(path), ext), GetFileExInfoStandard, &fad)) {
+        g_list.SetStat(i, ((ULONGLONG)fad.nFileSizeHigh << 32) | fad.nFileSizeLow,
+                       ((ULONGLONG)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime);
+    } else {
+        g_list.SetStat(i, 0, 0);
+    }
+}
+
+// 工作线程：把攒下的轨迹按序追加到文件，直到写空
+static void FlushDropTrace() {
+    for (;;) {
+        std::string out;
+        {
+            std::lock_guard<std::mutex> lock(g_traceMu);
+            if (g_tracePending.empty()) {
+                g_traceWriting = false;
+                return;
+            }
+            out.swap(g_tracePending);
+        }
+        HANDLE h = CreateFileW(g_style.dropTracePath, FILE_APPEND_DATA, FILE_SHARE_READ, NULL,
+                               OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h == INVALID_HANDLE_VALUE) continue;
+        DWORD written = 0;
+        WriteFile(h, out.data(), (DWORD)out.size(), &written, NULL);
+        CloseHandle(h);
+    }
+}
+
+// 拖入轨迹（UTF-8，追加写）："D <n>" 覆盖 / "A <n>" Ctrl 追加，后跟 n 行完整路径
+// 用 bench/bench.cpp --trace 回放；paths 为拖入时攒下的路径行
+static void AppendDropTrace(bool append, UINT total, const std::string& paths) {
+    std::string out;
+    char head[32];
+    StringCchPrintfA(head, _countof(head), "%c %u\n", append ? 'A' : 'D', total);
+    out += head;
+    out += paths;
+
+    bool start;
+    {
+        std::lock_guard<std::mutex> lock(g_traceMu);
+        g_tracePending += out;
+        start = !g_traceWriting;
+        g_traceWriting = true;
+    }
+    if (start) g_exec.Submit(relay::PRIORITY_BULK, FlushDropTrace);
+}
+
+// 要排的条目不少于这个数时放到执行器上排，否则直接在界面线程排完
+static const uint32_t SORT_ASYNC_MIN = 4096;
+
+// 只换入最后一次提交的排序结果（切换排序方式不作废列表上的其他后台任务）
+static uint64_t g_sortSeq = 0;
+
+static void PublishHttpShare();   // 见 HTTP share 一节：新顺序要重新发布
+
+struct SortJob {
+    relay::PathList list;   // 排序期间 g_list 可能再变：后台只看这份拷贝
+    relay::SortView view;
+};
+
+// 后台排好后在完成回调里换入 g_view；期间视图先按拖入顺序顶上，g_view 始终与 g_list 等长。
+// 列表一变（CancelListJobs）结果作废，由改动列表的一方重新排
+static void SubmitSortJob(bool append) {
+    std::shared_ptr<SortJob> job = std::make_shared<SortJob>();
+    job->list = g_list;
+    if (append) job->view = std::move(g_view);
+    g_view = relay::SortView();
+    g_view.Reset(relay::SORT_DROP, nullptr, (uint32_t)g_list.Count());
+
+    const relay::SortMode mode = g_style.sortMode;
+    const uint64_t seq = ++g_sortSeq;
+    g_exec.Submit(relay::PRIORITY_INTERACTIVE,
+        [job, mode, append] {
+            std::vector<relay::SortItem> items;
+            FillSortItems(job->list, items);
+            if (append) job->view.Append(items.data(), (uint32_t)items.size(), &g_exec);
+            else job->view.Reset(mode, items.data(), (uint32_t)items.size(), &g_exec);
+        },
+        [job, seq] {
+            if (seq != g_sortSeq) return;
+            g_view = std::move(job->view);
+            PublishHttpShare();
+        },
+        g_listJobs.Token());
+}
+
+// 全量重排：覆盖拖入 / 切换排序方式
+static void ResortList() {
+    ++g_sortSeq;    // 还没回来的旧结果不再换入
+    if (g_style.sortMode != relay::SORT_DROP && (uint32_t)g_list.Count() >= SORT_ASYNC_MIN) {
+        SubmitSortJob(false);
+        return;
+    }
+    std::vector<relay::SortItem> items;
+    FillSortItems(g_list, items);
+    g_view.Reset(g_style.sortMode, items.data(), (uint32_t)items.size());
+}
+
+// Ctrl 追加：新条目归并进已排序视图，不整体重排
+static void MergeAppendedIntoList() {
+    if (g_view.Mode() != g_style.sortMode || g_view.Size() == 0) {
+        ResortList();
+        return;
+    }
+    ++g_sortSeq;
+    if (g_style.sortMode != relay::SORT_DROP && (uint32_t)g_list.Count() - g_view.Size() >= SORT_ASYNC_MIN) {
+        SubmitSortJob(true);
+        return;
+    }
+    std::vector<relay::SortItem> items;
+    FillSortItems(g_list, items);
+    g_view.Append(items.data(), (uint32_t)items.size());
+}
+
+static void CycleSortMode() {
+    g_style.sortMode = (relay::SortMode)((g_style.sortMode + 1) % relay::SORT_MODE_COUNT);
+    WritePrivateProfileStringW(L"list", L"sort", SORT_KEYS[g_style.sortMode], g_iniPath);
+    ResortList();
+}
+
 // ---------------- OLE drag-out ----------------
 class DropSource : public IDropSource {
     LONG m_ref;
@@ -336,37 +795,256 @@ public:
     STDMETHODIMP GiveFeedback(DWORD) override { return DRAGDROP_S_USEDEFAULTCURSORS; }
 };
 
+// ---------------- ZIP drag-out ----------------
+static CLIPFORMAT CfFileDescriptor() {
+    static CLIPFORMAT cf = (CLIPFORMAT)RegisterClipboardFormatW(CFSTR_FILEDESCRIPTORW);
+    return cf;
+}
+static CLIPFORMAT CfFileContents() {
+    static CLIPFORMAT cf = (CLIPFORMAT)RegisterClipboardFormatW(CFSTR_FILECONTENTS);
+    return cf;
+}
+
+static void FileTimeToDos(const FILETIME& ft, uint16_t& dosDate, uint16_t& dosTime) {
+    FILETIME local;
+    SYSTEMTIME st;
+    if (FileTimeToLocalFileTime(&ft, &local) && FileTimeToSystemTime(&local, &st)) {
+        relay::DosDateTime(st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, dosDate, dosTime);
+    }
+}
+
+class ZipFileSource : public relay::ZipSource {
+    HANDLE m_h;
+public:
+    explicit ZipFileSource(HANDLE h) : m_h(h) {}
+    ~ZipFileSource() override { CloseHandle(m_h); }
+    size_t Read(uint8_t* dst, size_t n) override {
+        DWORD got = 0;
+        if (n > 0x40000000) n = 0x40000000;
+        if (!ReadFile(m_h, dst, (DWORD)n, &got, NULL)) return 0;
+        return got;
+    }
+};
+
+// 拖出列表 -> ZIP 条目；文件夹递归展开（不跟随联接点/符号链接，避免成环）
+class ZipFileInput : public relay::ZipInput {
+    std::vector<std::wstring> m_paths;   // ZipEntry::source -> 完整路径
+    std::vector<relay::ZipEntry> m_entries;
+    std::unordered_set<std::string> m_topNames;
+    relay::ZipMethod m_method;
+
+    void AddEntry(const std::wstring& path, const std::string& name, bool isDir,
+                  uint64_t size, const FILETIME& mtime) {
+        relay::ZipEntry e;
+        e.name = name;
+        if (isDir) e.name.push_back('/');
+        e.isDir = isDir;
+        e.sizeHint = size;
+        e.store = !isDir && relay::UseStore(m_method, path.c_str());
+        e.source = (uint32_t)m_paths.size();
+        FileTimeToDos(mtime, e.dosDate, e.dosTime);
+        m_paths.push_back(path);
+        m_entries.push_back(std::move(e));
+    }
+
+    void AddTree(const std::wstring& dir, const std::string& prefix) {
+        std::wstring pattern = dir + L"\\*";
+        WIN32_FIND_DATAW fd;
+        HANDLE h = FindFirstFileExW(pattern.c_str(), FindExInfoBasic, &fd, FindExSearchNameMatch,
+                                    NULL, FIND_FIRST_EX_LARGE_FETCH);
+        if (h == INVALID_HANDLE_VALUE) return;
+        do {
+            if (wcscmp(fd.cFileName, L".") == 0 || wcscmp(fd.cFileName, L"..") == 0) continue;
+            std::wstring path = dir + L"\\" + fd.cFileName;
+            std::string name = prefix;
+            relay::AppendUtf8(fd.cFileName, wcslen(fd.cFileName), name);
+            bool isDir = (fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            if (isDir && (fd.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT)) continue;
+            uint64_t size = ((uint64_t)fd.nFileSizeHigh << 32) | fd.nFileSizeLow;
+            AddEntry(path, name, isDir, size, fd.ftLastWriteTime);
+            if (isDir) AddTree(path, name + "/");
+        } while (FindNextFileW(h, &fd));
+        FindClose(h);
+    }
+
+    // 顶层重名（不同文件夹里的同名文件）时加 " (2)"、" (3)"...
+    std::string UniqueTopName(const wchar_t* name) {
+        size_t extLen = 0;
+        const wchar_t* ext = relay::ExtPart(name, &extLen);
+        size_t stemLen = extLen ? (size_t)(ext - name) - 1 : wcslen(name);
+        for (int n = 1;; ++n) {
+            std::string out;
+            relay::AppendUtf8(name, stemLen, out);
+            if (n > 1) {
+                char num[16];
+                snprintf(num, sizeof(num), " (%d)", n);
+                out += num;
+            }
+            if (extLen) { out.push_back('.'); relay::AppendUtf8(ext, extLen, out); }
+            std::string key = out;
+            for (char& c : key) if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+            if (m_topNames.insert(key).second) return out;
+        }
+    }
+
+public:
+    explicit ZipFileInput(relay::ZipMethod method) : m_method(method) {}
+
+    // list：双 0 结尾的拖出列表
+    void Collect(const wchar_t* list) {
+        for (const wchar_t* p = list; p && *p; p += wcslen(p) + 1) {
+            // 目录下的子路径可能超过 MAX_PATH：一律用 \\?\ 形式遍历和打开
+            std::wstring ext;
+            std::wstring path = relay::ExtendedLengthPath(p, wcslen(p), ext, 0);
+            WIN32_FILE_ATTRIBUTE_DATA fad;
+            if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &fad)) continue;
+            std::string name = UniqueTopName(relay::NamePart(p));
+            bool isDir = (fad.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            uint64_t size = ((uint64_t)fad.nFileSizeHigh << 32) | fad.nFileSizeLow;
+            while (isDir && path.size() > 3 && relay::IsPathSep(path.back())) path.pop_back();
+            AddEntry(path, name, isDir, size, fad.ftLastWriteTime);
+            if (isDir) AddTree(path, name + "/");
+        }
+    }
+
+    std::vector<relay::ZipEntry> TakeEntries() { return std::move(m_entries); }
+
+    std::unique_ptr<relay::ZipSource> Open(const relay::ZipEntry& e) override {
+        HANDLE h = CreateFileW(m_paths[e.source].c_str(), GENERIC_READ,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                               OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (h == INVALID_HANDLE_VALUE) return nullptr;
+        return std::unique_ptr<relay::ZipSource>(new ZipFileSource(h));
+    }
+};
+
+// 拖出列表的枚举（可能递归走网络路径）：流一创建就交给执行器，Read 只等它做完
+struct ZipCollectJob {
+    std::vector<wchar_t> list;
+    ZipFileInput input;
+    std::mutex mu;
+    std::condition_variable cv;
+    bool ready = false;
+
+    ZipCollectJob(const wchar_t* l, SIZE_T chars, relay::ZipMethod method) : list(l, l + chars), input(method) {}
+};
+
+// CFSTR_FILECONTENTS 的流。聚合自由线程封送器：Read 在调用它的线程（目标的复制线程 / RPC 线程）
+// 上执行，等压缩时不占界面线程
+class ZipReadStream : public IStream {
+    LONG m_ref;
+    std::wstring m_name;
+    std::shared_ptr<ZipCollectJob> m_job;
+    relay::CancelSource m_cancel;
+    unsigned m_threads;
+    IUnknown* m_ftm;
+    std::mutex m_readMu;    // 自由线程：Read / Seek 可能来自不同线程
+    std::unique_ptr<relay::ZipStream> m_zip;
+    ULONGLONG m_pos;
+public:
+    ZipReadStream(const wchar_t* list, SIZE_T listChars, const wchar_t* name)
+        : m_ref(1), m_name(name), m_job(std::make_shared<ZipCollectJob>(list, listChars, g_style.zipMethod)),
+          m_threads((unsigned)g_style.zipThreads), m_ftm(nullptr), m_pos(0) {
+        if (FAILED(CoCreateFreeThreadedMarshaler((IStream*)this, &m_ftm))) m_ftm = nullptr;
+
+        std::shared_ptr<ZipCollectJob> job = m_job;
+        g_exec.Submit(relay::PRIORITY_BULK, [job] {
+            job->input.Collect(job->list.data());
+            std::lock_guard<std::mutex> lock(job->mu);
+            job->ready = true;
+            job->cv.notify_all();
+        }, relay::Executor::Fn(), m_cancel.Token());
+    }
+
+    ~ZipReadStream() {
+        m_cancel.Cancel();
+        if (m_ftm) m_ftm->Release();
+    }
+
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override {
+        if (!ppv) return E_POINTER;
+        *ppv = nullptr;
+        if (riid == IID_IUnknown || riid == IID_ISequentialStream || riid == IID_IStream) {
+            *ppv = (IStream*)this;
+            AddRef();
+            return S_OK;
+        }
+        if (riid == IID_IMarshal && m_ftm) return m_ftm->QueryInterface(riid, ppv);
+        return E_NOINTERFACE;
+    }
+    STDMETHODIMP_(ULONG) AddRef() override { return InterlockedIncrement(&m_ref); }
+    STDMETHODIMP_(ULONG) Release() override {
+        ULONG r = InterlockedDecrement(&m_ref);
+        if (!r) delete this;
+        return r;
+    }
+
+    STDMETHODIMP Read(void* pv, ULONG cb, ULONG* pcbRead) override {
+        if (!pv) return STG_E_INVALIDPOINTER;
+        std::lock_guard<std::mutex> lock(m_readMu);
+        if (!m_zip) {
+            {
+                std::unique_lock<std::mutex> wait(m_job->mu);
+                m_job->cv.wait(wait, [this] { return m_job->ready; });
+            }
+            m_zip.reset(new relay::ZipStream(m_job->input.TakeEntries(), &m_job->input, &g_exec, m_threads));
+        }
+        size_t got = m_zip->Read((uint8_t*)pv, cb);
+        m_pos += got;
+        if (pcbRead) *pcbRead = (ULONG)got;
+        return got < cb ? S_FALSE : S_OK;
+    }
+    STDMETHODIMP Write(const void*, ULONG, ULONG*) override { return STG_E_ACCESSDENIED; }
+
+    // 只能顺序读：允许查询当前位置
+    STDMETHODIMP Seek(LARGE_INTEGER move, DWORD origin, ULARGE_INTEGER* newPos) override {
+        std::lock_guard<std::mutex> lock(m_readMu);
+        bool ok = (origin == STREAM_SEEK_CUR && move.QuadPart == 0) ||
+                  (origin == STREAM_SEEK_SET && (ULONGLONG)move.QuadPart == m_pos);
+        if (!ok) return STG_E_INVALIDFUNCTION;
+        if (newPos) newPos->QuadPart = m_pos;
+        return S_OK;
+    }
+    STDMETHODIMP SetSize(ULARGE_INTEGER) override { return E_NOTIMPL; }
+    STDMETHODIMP CopyTo(IStream*, ULARGE_INTEGER, ULARGE_INTEGER*, ULARGE_INTEGER*) override { return E_NOTIMPL; }
+    STDMETHODIMP Commit(DWORD) override { return S_OK; }
+    STDMETHODIMP Revert() override { return E_NOTIMPL; }
+    STDMETHODIMP LockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) override { return STG_E_INVALIDFUNCTION; }
+    STDMETHODIMP UnlockRegion(ULARGE_INTEGER, ULARGE_INTEGER, DWORD) override { return STG_E_INVALIDFUNCTION; }
+    STDMETHODIMP Stat(STATSTG* st, DWORD flags) override {
+        if (!st) return STG_E_INVALIDPOINTER;
+        ZeroMemory(st, sizeof(*st));
+        st->type = STGTY_STREAM;
+        st->grfMode = STGM_READ;
+        if (!(flags & STATFLAG_NONAME)) {
+            size_t bytes = (m_name.size() + 1) * sizeof(wchar_t);
+            st->pwcsName = (LPWSTR)CoTaskMemAlloc(bytes);
+            if (!st->pwcsName) return E_OUTOFMEMORY;
+            memcpy(st->pwcsName, m_name.c_str(), bytes);
+        }
+        return S_OK;
+    }
+    STDMETHODIMP Clone(IStream**) override { return E_NOTIMPL; }
+};
+
 class DataObject : public IDataObject {
     LONG m_ref;
     wchar_t* m_list;
     SIZE_T m_listChars;
+    bool m_zip;
 public:
-    DataObject(const wchar_t paths[][MAX_PATH], int count)
-        : m_ref(1), m_list(nullptr), m_listChars(0) {
+    // order: 拖出顺序（paths 下标），长度为 count
+    // asZip：以一个虚拟文件（FILEDESCRIPTOR + FILECONTENTS 流）提供整个列表的 ZIP，不提供 CF_HDROP
+    DataObject(const wchar_t* const* paths, const uint32_t* order, int count, bool asZip)
+        : m_ref(1), m_list(nullptr), m_listChars(0), m_zip(asZip) {
 
         if (count < 1) return;
 
-        SIZE_T chars = 1;
-        for (int i = 0; i < count; ++i) {
-            SIZE_T len = wcslen(paths[i]);
-            if (len == 0) continue;
-            chars += len + 1;
-        }
-        if (chars < 2) chars = 2;
-
+        SIZE_T chars = relay::FileListChars(paths, order, count);
         m_list = (wchar_t*)CoTaskMemAlloc(chars * sizeof(wchar_t));
         if (!m_list) { m_listChars = 0; return; }
 
-        wchar_t* p = m_list;
-        for (int i = 0; i < count; ++i) {
-            if (paths[i][0] == 0) continue;
-            SIZE_T len = wcslen(paths[i]);
-            memcpy(p, paths[i], len * sizeof(wchar_t));
-            p += len;
-            *p++ = L'\0';
-        }
-        *p++ = L'\0';
-        m_listChars = (SIZE_T)(p - m_list);
+        m_listChars = relay::WriteFileList(paths, order, count, m_list);
     }
 
     ~DataObject() {
@@ -392,21 +1070,19 @@ public:
 
     STDMETHODIMP GetData(FORMATETC* pFormat, STGMEDIUM* pMedium) override {
         if (!pFormat || !pMedium) return E_POINTER;
+        if (m_zip) return GetZipData(pFormat, pMedium);
         if (pFormat->cfFormat != CF_HDROP) return DV_E_FORMATETC;
         if (!(pFormat->tymed & TYMED_HGLOBAL)) return DV_E_TYMED;
         if (!m_list || m_listChars < 2) return DV_E_FORMATETC;
 
-        SIZE_T bytes = sizeof(DROPFILES) + m_listChars * sizeof(wchar_t);
+        SIZE_T bytes = relay::DropFilesBytes(m_listChars);
         HGLOBAL hMem = GlobalAlloc(GHND | GMEM_SHARE, bytes);
         if (!hMem) return STG_E_MEDIUMFULL;
 
         BYTE* p = (BYTE*)GlobalLock(hMem);
         if (!p) { GlobalFree(hMem); return STG_E_MEDIUMFULL; }
 
-        DROPFILES* df = (DROPFILES*)p;
-        df->pFiles = sizeof(DROPFILES);
-        df->fWide = TRUE;
-        memcpy(p + sizeof(DROPFILES), m_list, m_listChars * sizeof(wchar_t));
+        relay::WriteDropFiles(p, m_list, m_listChars);
 
         GlobalUnlock(hMem);
 
@@ -416,32 +1092,131 @@ public:
         return S_OK;
     }
 
+    HRESULT GetZipData(FORMATETC* pFormat, STGMEDIUM* pMedium) {
+        if (!m_list || m_listChars < 2) return DV_E_FORMATETC;
+
+        if (pFormat->cfFormat == CfFileDescriptor()) {
+            if (!(pFormat->tymed & TYMED_HGLOBAL)) return DV_E_TYMED;
+            HGLOBAL hMem = GlobalAlloc(GHND | GMEM_SHARE, sizeof(FILEGROUPDESCRIPTORW));
+            if (!hMem) return STG_E_MEDIUMFULL;
+            FILEGROUPDESCRIPTORW* fgd = (FILEGROUPDESCRIPTORW*)GlobalLock(hMem);
+            if (!fgd) { GlobalFree(hMem); return STG_E_MEDIUMFULL; }
+
+            // 大小要压完才知道：不给 FD_FILESIZE，目标读到流结束为止
+            fgd->cItems = 1;
+            fgd->fgd[0].dwFlags = FD_WRITESTIME | FD_PROGRESSUI;
+            GetSystemTimeAsFileTime(&fgd->fgd[0].ftLastWriteTime);
+            StringCchCopyW(fgd->fgd[0].cFileName, MAX_PATH, g_style.zipName);
+            GlobalUnlock(hMem);
+
+            pMedium->tymed = TYMED_HGLOBAL;
+            pMedium->hGlobal = hMem;
+            pMedium->pUnkForRelease = nullptr;
+            return S_OK;
+        }
+
+        if (pFormat->cfFormat == CfFileContents()) {
+            if (!(pFormat->tymed & TYMED_ISTREAM)) return DV_E_TYMED;
+            if (pFormat->lindex > 0) return DV_E_LINDEX;
+            pMedium->tymed = TYMED_ISTREAM;
+            pMedium->pstm = new ZipReadStream(m_list, m_listChars, g_style.zipName);
+            pMedium->pUnkForRelease = nullptr;
+            return S_OK;
+        }
+        return DV_E_FORMATETC;
+    }
+
     STDMETHODIMP GetDataHere(FORMATETC*, STGMEDIUM*) override { return E_NOTIMPL; }
     STDMETHODIMP QueryGetData(FORMATETC* pFormat) override {
         if (!pFormat) return E_POINTER;
+        if (m_zip) {
+            if (pFormat->cfFormat == CfFileDescriptor() && (pFormat->tymed & TYMED_HGLOBAL)) return S_OK;
+            if (pFormat->cfFormat == CfFileContents() && (pFormat->tymed & TYMED_ISTREAM)) return S_OK;
+            return DV_E_FORMATETC;
+        }
         if (pFormat->cfFormat == CF_HDROP && (pFormat->tymed & TYMED_HGLOBAL)) return S_OK;
         return DV_E_FORMATETC;
     }
     STDMETHODIMP GetCanonicalFormatEtc(FORMATETC*, FORMATETC*) override { return E_NOTIMPL; }
     STDMETHODIMP SetData(FORMATETC*, STGMEDIUM*, BOOL) override { return E_NOTIMPL; }
-    STDMETHODIMP EnumFormatEtc(DWORD, IEnumFORMATETC**) override { return E_NOTIMPL; }
+    STDMETHODIMP EnumFormatEtc(DWORD dir, IEnumFORMATETC** ppEnum) override {
+        if (!ppEnum) return E_POINTER;
+        *ppEnum = nullptr;
+        if (dir != DATADIR_GET) return E_NOTIMPL;
+        FORMATETC fmts[2] = {};
+        UINT n = 0;
+        if (m_zip) {
+            fmts[n++] = FORMATETC{CfFileDescriptor(), nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL};
+            fmts[n++] = FORMATETC{CfFileContents(), nullptr, DVASPECT_CONTENT, 0, TYMED_ISTREAM};
+        } else {
+            fmts[n++] = FORMATETC{CF_HDROP, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL};
+        }
+        return SHCreateStdEnumFmtEtc(n, fmts, ppEnum);
+    }
     STDMETHODIMP DAdvise(FORMATETC*, DWORD, IAdviseSink*, DWORD*) override { return OLE_E_ADVISENOTSUPPORTED; }
     STDMETHODIMP DUnadvise(DWORD) override { return OLE_E_ADVISENOTSUPPORTED; }
     STDMETHODIMP EnumDAdvise(IEnumSTATDATA**) override { return OLE_E_ADVISENOTSUPPORTED; }
 };
 
-static void StartDragIfHasFiles(HWND hwnd) {
-    (void)hwnd;
-    if (g_count <= 0) return;
+static void StartDragIfHasFiles(bool altDown) {
+    if (g_list.Count() <= 0) return;
+
+    std::vector<const wchar_t*> rows;
+    FillRows(&rows, NULL);
 
-    IDataObject* data = new DataObject(g_paths, g_count);
+    bool asZip = g_style.zipDefault != altDown;
+    IDataObject* data = new DataObject(rows.data(), g_view.Order(), g_list.Count(), asZip);
     IDropSource* src = new DropSource();
     DWORD effect = 0;
-    DoDragDrop(data, src, DROPEFFECT_COPY | DROPEFFECT_MOVE, &effect);
+    g_dragOutActive = true;
+    DoDragDrop(data, src, asZip ? DROPEFFECT_COPY : (DROPEFFECT_COPY | DROPEFFECT_MOVE), &effect);
+    g_dragOutActive = false;
     src->Release();
     data->Release();
 }
 
+// ---------------- startup trace ----------------
+static uint64_t StartupNowUs() {
+    static LARGE_INTEGER freq = {};
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    return (uint64_t)(now.QuadPart / freq.QuadPart) * 1000000ull +
+           (uint64_t)(now.QuadPart % freq.QuadPart) * 1000000ull / (uint64_t)freq.QuadPart;
+}
+
+// 进程创建到现在（加载器、DLL 初始化、CRT 启动都算在 WinMain 之前）
+// 系统时间精度为时钟中断（约 1~16 ms）；Precise 版本要 Win8，这里保持 Win7 可用
+static uint64_t ProcessAgeUs() {
+    FILETIME created, exited, kernel, user, now;
+    if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0;
+    GetSystemTimeAsFileTime(&now);
+    uint64_t c = ((uint64_t)created.dwHighDateTime << 32) | created.dwLowDateTime;
+    uint64_t n = ((uint64_t)now.dwHighDateTime << 32) | now.dwLowDateTime;
+    return n > c ? (n - c) / 10 : 0;
+}
+
+static void StartupMark(const char* phase) {
+    if (g_startup.Enabled()) g_startup.Mark(phase, StartupNowUs());
+}
+
+// 整条记录追加到日志（后台写），同时给调试器一份
+static void FlushStartupTrace() {
+    if (!g_startup.Enabled()) return;
+    std::string line = g_startup.Format();
+    line += "\n";
+    OutputDebugStringA(line.c_str());
+    std::wstring path = g_startupLogPath;
+    g_exec.Submit(relay::PRIORITY_BULK, [path, line] {
+        HANDLE h = CreateFileW(path.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, NULL,
+                               OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (h == INVALID_HANDLE_VALUE) return;
+        DWORD written = 0;
+        WriteFile(h, line.data(), (DWORD)line.size(), &written, NULL);
+        CloseHandle(h);
+    });
+}
+
 // ---------------- main drawing ----------------
 static void PaintMain(HWND hwnd) {
     PAINTSTRUCT ps;
@@ -454,12 +1229,16 @@ static void PaintMain(HWND hwnd) {
     SetTextColor(hdc, g_style.fg);
     HFONT old = (HFONT)SelectObject(hdc, g_mainFont);
 
+    // 拖入悬停：覆盖显示 ↓，Ctrl 追加显示 +数量
     wchar_t text[64];
-    StringCchPrintfW(text, 64, L"%d", g_count);
+    if (g_dropHint == 1) StringCchCopyW(text, 64, L"\u2193");
+    else if (g_dropHint == 2) StringCchPrintfW(text, 64, L"+%d", g_list.Count());
+    else StringCchPrintfW(text, 64, L"%d", g_list.Count());
     DrawTextW(hdc, text, -1, &rc, DT_CENTER | DT_VCENTER | DT_SINGLELINE);
 
     SelectObject(hdc, old);
     EndPaint(hwnd, &ps);
+    if (g_startup.Enabled()) g_startup.MarkOnce("first_paint", StartupNowUs());
 }
 
 static void ApplyLayeredAttributes(HWND hwnd) {
@@ -487,97 +1266,69 @@ static void ComputeTipPosCenteredAboveBottomTaskbar(int tipW, int tipH, int& out
     const int sw = GetSystemMetrics(SM_CXSCREEN);
     const int sh = GetSystemMetrics(SM_CYSCREEN);
 
-    outX = (sw - tipW) / 2;
-    outY = sh - tipH - g_style.tipMargin;
-
     RECT tb{};
-    if (GetTaskbarRect(tb)) {
-        int tbW = tb.right - tb.left;
-        int tbH = tb.bottom - tb.top;
-
-        // bottom taskbar (most common)
-        if (tbW >= tbH && tb.bottom >= sh - 2) {
-            outY = tb.top - tipH - g_style.tipMargin;
-        } else {
-            // not bottom: fall back to "bottom of screen" behavior
-            outY = sh - tipH - g_style.tipMargin;
-        }
-    }
+    relay::Rect taskbar{};
+    bool hasTaskbar = GetTaskbarRect(tb);
+    if (hasTaskbar) taskbar = relay::Rect{(int)tb.left, (int)tb.top, (int)tb.right, (int)tb.bottom};
 
-    if (outX < 0) outX = 0;
-    if (outY < 0) outY = 0;
-    if (outX > sw - tipW) outX = sw - tipW;
-    if (outY > sh - tipH) outY = sh - tipH;
+    relay::PlaceTipAboveTaskbar(sw, sh, hasTaskbar ? &taskbar : NULL, tipW, tipH, g_style.tipMargin, outX, outY);
 }
 
 // ---------------- Tip window ----------------
-static int BuildTipTextAndGetShownLines() {
-    g_tipText[0] = 0;
-
-    if (g_count <= 0) {
-        StringCchCopyW(g_tipText, _countof(g_tipText), L"(空)");
-        return 1;
-    }
-
-    int maxLines = g_style.tipMaxLines;
-    if (maxLines < 1) maxLines = 1;
-
-    bool needMoreLine = (g_count > maxLines);
-    int showNames = needMoreLine ? (maxLines - 1) : maxLines;
-    if (showNames < 0) showNames = 0;
-
-    int written = 0;
-    for (int i = 0; i < g_count && written < showNames; ++i) {
-        const wchar_t* s = g_names[i][0] ? g_names[i] : g_paths[i];
-        if (!s || !*s) continue;
-
-        if (g_tipText[0] != 0) StringCchCatW(g_tipText, _countof(g_tipText), L"\r\n");
-        StringCchCatW(g_tipText, _countof(g_tipText), s);
-        written++;
-    }
-
-    int lines = written;
-    if (needMoreLine && maxLines >= 1) {
-        int remaining = g_count - written;
-        if (g_tipText[0] != 0) StringCchCatW(g_tipText, _countof(g_tipText), L"\r\n");
-
-        wchar_t more[64];
-        StringCchPrintfW(more, _countof(more), L"...还有 %d 个文件", remaining);
-        StringCchCatW(g_tipText, _countof(g_tipText), more);
-        lines += 1;
+static bool EnsureTipText() {
+    if (!g_tipText) {
+        g_tipText = (wchar_t*)HeapAlloc(GetProcessHeap(), 0, TIP_TEXT_CCH * sizeof(wchar_t));
+        if (g_tipText) g_tipText[0] = 0;
     }
-
-    if (lines <= 0) lines = 1;
-    return lines;
+    return g_tipText != NULL;
 }
 
-// Estimate line height from font size (simple & compact; good enough for Segoe UI)
-static int EstimateLineHeightPx() {
-    int h = (int)(g_style.tipFontSize * 1.7); // 1.45
-    if (h < 14) h = 14;
-    return h;
+static void ReleaseTipText() {
+    if (g_tipText) { HeapFree(GetProcessHeap(), 0, g_tipText); g_tipText = NULL; }
 }
 
-static void ShowAutoCloseTip(HWND owner) {
-    int shownLines = BuildTipTextAndGetShownLines();
-    int lineH = EstimateLineHeightPx();
-
-    const int padTop = 10, padBottom = 10;
-    const int border = 2;
-
-    int desiredH = padTop + padBottom + border + shownLines * lineH;
+static int BuildTipTextAndGetShownLines(bool withSortLine) {
+    wchar_t head[64];
+    if (withSortLine) StringCchPrintfW(head, _countof(head), L"排序：%s", SORT_LABELS[g_style.sortMode]);
+
+    std::vector<relay::SortItem> items;
+    std::vector<const wchar_t*> paths, names;
+    FillSortItems(g_list, items);
+    FillRows(&paths, &names);
+
+    std::vector<uint32_t> order;
+    g_view.GroupedOrder(items.data(), g_style.groupMode, order);
+
+    relay::TipInput in{};
+    in.paths = paths.data();
+    in.names = names.data();
+    in.order = order.data();
+    in.count = g_list.Count();
+    in.groupMode = g_style.groupMode;
+    in.maxLines = g_style.tipMaxLines;
+    in.headLine = withSortLine ? head : NULL;
+    return relay::BuildTipText(in, g_tipText, TIP_TEXT_CCH);
+}
 
-    int maxH = g_style.tipMaxH;
-    if (maxH == 0) {
-        int maxLines = g_style.tipMaxLines;
-        if (maxLines < 1) maxLines = 1;
-        maxH = padTop + padBottom + border + maxLines * lineH;
-    }
+LRESULT CALLBACK TipWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
-    int h = desiredH;
-    if (h < g_style.tipMinH) h = g_style.tipMinH;
-    if (h > maxH) h = maxH;
+// tip 窗口类在第一次弹 tip 时才注册，不占冷启动
+static void EnsureTipClass() {
+    if (g_tipClassReady) return;
+    WNDCLASSW twc{};
+    twc.lpfnWndProc = TipWndProc;
+    twc.hInstance = GetModuleHandleW(NULL);
+    twc.lpszClassName = TIP_CLASS;
+    twc.hCursor = LoadCursor(NULL, IDC_ARROW);
+    twc.hbrBackground = NULL;
+    g_tipClassReady = RegisterClassW(&twc) != 0;
+}
 
+// g_tipText 已填好后调用
+static void ShowTipWindow(HWND owner, int shownLines) {
+    EnsureTipClass();
+    EnsureTipGdiObjects();
+    int h = relay::TipHeight(shownLines, g_style.tipFontSize, g_style.tipMinH, g_style.tipMaxH, g_style.tipMaxLines);
     int w = g_style.tipWidth;
 
     if (g_tipWnd && IsWindow(g_tipWnd)) {
@@ -599,6 +1350,277 @@ static void ShowAutoCloseTip(HWND owner) {
     UpdateWindow(g_tipWnd);
 }
 
+static void ShowAutoCloseTip(HWND owner, bool withSortLine) {
+    if (!EnsureTipText()) return;
+    ShowTipWindow(owner, BuildTipTextAndGetShownLines(withSortLine));
+}
+
+// Alt + 右键：内存诊断
+static void ShowMemoryTip(HWND owner) {
+    if (!EnsureTipText()) return;
+
+    PROCESS_MEMORY_COUNTERS_EX pmc{};
+    pmc.cb = sizeof(pmc);
+    GetProcessMemoryInfo(GetCurrentProcess(), (PROCESS_MEMORY_COUNTERS*)&pmc, sizeof(pmc));
+    relay::HttpStats http = g_http.Stats();
+    relay::ExecStats exec = g_exec.Stats();
+
+    StringCchPrintfW(g_tipText, TIP_TEXT_CCH,
+        L"内存\n"
+        L"私有字节：%u KB\n"
+        L"工作集：%u KB（峰值 %u KB）\n"
+        L"列表：%d 项，已用 %u B / 已分配 %u B\n"
+        L"空闲模式：%s\n"
+        L"历史：可撤销 %u 步 / 可重做 %u 步（上限 %d）\n"
+        L"后台：%u 线程，已执行 %u，已取消 %u，回调 %u 批\n"
+        L"HTTP：%s，%u 个连接，%u 个请求，已发送 %u KB",
+        (unsigned)(pmc.PrivateUsage / 1024),
+        (unsigned)(pmc.WorkingSetSize / 1024),
+        (unsigned)(pmc.PeakWorkingSetSize / 1024),
+        g_list.Count(),
+        (unsigned)g_list.UsedBytes(),
+        (unsigned)g_list.ReservedBytes(),
+        g_style.idleAfterMs <= 0 ? L"关闭" : (g_idle.Idle() ? L"空闲中" : L"活动"),
+        (unsigned)g_history.UndoCount(), (unsigned)g_history.RedoCount(), g_style.historyDepth,
+        g_exec.Workers(), (unsigned)exec.executed, (unsigned)exec.cancelled, (unsigned)exec.batches,
+        g_http.Running() ? L"开启" : L"关闭",
+        http.active,
+        (unsigned)http.requests,
+        (unsigned)(http.bytesSent / 1024));
+    ShowTipWindow(owner, 8);
+}
+
+// ---------------- HTTP share ----------------
+// 服务线程只读发布出去的快照；列表变化后重新发布一份
+// 路径等在界面线程上拷一份，是否目录的探测（可能碰到慢的网络盘）放到后台再发布
+static void PublishHttpShare() {
+    if (!g_http.Running()) return;
+    std::shared_ptr<relay::HttpShare> share = std::make_shared<relay::HttpShare>();
+    share->version = ++g_httpShareVersion;
+    const uint32_t* order = g_view.Order();
+    uint32_t n = (uint32_t)g_view.Size();
+    share->files.reserve(n);
+    for (uint32_t k = 0; k < n; ++k) {
+        int i = (int)order[k];
+        relay::HttpFile f;
+        const wchar_t* path = g_list.Path(i);
+        std::wstring ext;
+        f.path = relay::ExtendedLengthPath(path, wcslen(path), ext);
+        const wchar_t* name = g_list.Name(i);
+        relay::AppendUtf8(name, wcslen(name), f.name);
+        f.size = g_list.Size(i);
+        uint64_t ft = g_list.Mtime(i);
+        f.mtime = ft > 116444736000000000ull ? (ft - 116444736000000000ull) / 10000000ull : 0;
+        share->files.push_back(std::move(f));
+    }
+    g_exec.Submit(relay::PRIORITY_INTERACTIVE, [share] {
+        for (relay::HttpFile& f : share->files) {
+            DWORD attr = GetFileAttributesW(f.path.c_str());
+            f.isDir = attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY);
+        }
+        g_http.Publish(share);
+    });
+}
+
+static bool CopyTextToClipboard(HWND hwnd, const wchar_t* text) {
+    if (!OpenClipboard(hwnd)) return false;
+    EmptyClipboard();
+    size_t bytes = (wcslen(text) + 1) * sizeof(wchar_t);
+    HGLOBAL h = GlobalAlloc(GMEM_MOVEABLE, bytes);
+    bool ok = false;
+    if (h) {
+        memcpy(GlobalLock(h), text, bytes);
+        GlobalUnlock(h);
+        ok = SetClipboardData(CF_UNICODETEXT, h) != NULL;
+        if (!ok) GlobalFree(h);
+    }
+    CloseClipboard();
+    return ok;
+}
+
+static bool StartHttpShare() {
+    if (g_http.Running()) return true;
+    if (!g_http.Start(g_style.httpBind, (uint16_t)g_style.httpPort)) return false;
+    PublishHttpShare();
+    return true;
+}
+
+// 中键：开/关共享；开启时把地址复制到剪贴板并提示
+static void ToggleHttpShare(HWND owner) {
+    if (!EnsureTipText()) return;
+    if (g_http.Running()) {
+        g_http.Stop();
+        StringCchCopyW(g_tipText, TIP_TEXT_CCH, L"HTTP 共享已关闭");
+        ShowTipWindow(owner, 1);
+        return;
+    }
+    if (!StartHttpShare()) {
+        StringCchPrintfW(g_tipText, TIP_TEXT_CCH, L"HTTP 共享开启失败\n%hs:%d 可能已被占用",
+                         g_style.httpBind, g_style.httpPort);
+        ShowTipWindow(owner, 2);
+        return;
+    }
+
+    // 绑定全部网卡时给出局域网地址
+    std::string host = g_style.httpBind;
+    if (host == "0.0.0.0") {
+        host = relay::PrimaryLanAddress();
+        if (host.empty()) host = "127.0.0.1";
+    }
+    wchar_t url[160];
+    StringCchPrintfW(url, _countof(url), L"http://%hs:%u/%hs/", host.c_str(), (unsigned)g_http.Port(),
+                     g_http.Token().c_str());
+    bool copied = CopyTextToClipboard(owner, url);
+    StringCchPrintfW(g_tipText, TIP_TEXT_CCH, L"HTTP 共享已开启%s\n%s\n中键关闭",
+                     copied ? L"（地址已复制）" : L"", url);
+    ShowTipWindow(owner, 3);
+}
+
+// ---------------- list history ----------------
+static relay::ListItemRef ListItemAt(int i) {
+    const wchar_t* p = g_list.Path(i);
+    return relay::MakeListItem(p, wcslen(p), g_list.Size(i), g_list.Mtime(i));
+}
+
+// 拖入之后记录一步：覆盖是整张新表，追加只挂上 [oldCount, Count) 的新条目
+static void RecordDrop(bool append, int oldCount) {
+    if (append && g_list.Count() == oldCount) return;
+    relay::ListState s = append ? g_history.Current() : relay::ListState();
+    for (int i = append ? oldCount : 0; i < g_list.Count(); ++i) s.PushBack(ListItemAt(i));
+    g_history.Push(append ? relay::HISTORY_APPEND : relay::HISTORY_OVERWRITE, std::move(s));
+}
+
+static void CancelListJobs() {
+    g_listJobs.Cancel();
+    g_listJobs = relay::CancelSource();
+}
+
+// 按历史版本重建 g_list（条目自带大小/时间，不再取文件属性）
+static void ApplyListState(const relay::ListState& state) {
+    CancelListJobs();
+    g_list.Clear();
+    state.ForEach([](const relay::ListItemRef& item) {
+        int idx = g_list.Add(item->path.c_str(), item->path.size());
+        if (idx >= 0) g_list.SetStat(idx, item->size, item->mtime);
+    });
+    ResortList();
+    PublishHttpShare();
+}
+
+static void ShowHistoryTip(HWND owner, const wchar_t* headline) {
+    if (!EnsureTipText()) return;
+    StringCchPrintfW(g_tipText, TIP_TEXT_CCH, L"%s\n列表 %d 项，可撤销 %u 步 / 可重做 %u 步",
+                     headline, g_list.Count(),
+                     (unsigned)g_history.UndoCount(), (unsigned)g_history.RedoCount());
+    ShowTipWindow(owner, 2);
+}
+
+static void ClearRelayList(HWND owner) {
+    if (g_list.Count() == 0) return;
+    g_history.Push(relay::HISTORY_CLEAR, relay::ListState());
+    ApplyListState(g_history.Current());
+    ShowHistoryTip(owner, L"已清空（滚轮向上可撤销）");
+}
+
+// 后台探测结果回到界面线程：keep[i] 对应探测时的 g_list[i]（期间列表若有变化，结果已被取消）
+static void ApplyMissingProbe(HWND owner, const std::vector<char>& keep) {
+    int removed = 0;
+    for (char k : keep) removed += k ? 0 : 1;
+    if (!EnsureTipText()) return;
+    if (removed == 0) {
+        StringCchCopyW(g_tipText, TIP_TEXT_CCH, L"列表里的文件都还在");
+        ShowTipWindow(owner, 1);
+        return;
+    }
+    g_history.Push(relay::HISTORY_REMOVE,
+                   relay::RemoveFromState(g_history.Current(), [&](size_t i) { return keep[i] != 0; }));
+    ApplyListState(g_history.Current());
+    InvalidateRect(owner, NULL, TRUE);
+    wchar_t line[64];
+    StringCchPrintfW(line, _countof(line), L"已移除 %d 个不存在的文件", removed);
+    ShowHistoryTip(owner, line);
+}
+
+// 移除已被删除/移走的文件；探测放到后台（网络路径可能要等好几秒）
+static void RemoveMissingEntries(HWND owner) {
+    std::shared_ptr<std::vector<std::wstring>> paths = std::make_shared<std::vector<std::wstring>>();
+    std::wstring ext;
+    for (int i = 0; i < g_list.Count(); ++i) {
+        const wchar_t* path = g_list.Path(i);
+        paths->push_back(relay::ExtendedLengthPath(path, wcslen(path), ext));
+    }
+    std::shared_ptr<std::vector<char>> keep = std::make_shared<std::vector<char>>(paths->size(), 1);
+    g_exec.Submit(relay::PRIORITY_INTERACTIVE,
+        [paths, keep] {
+            for (size_t i = 0; i < paths->size(); ++i) {
+                (*keep)[i] = GetFileAttributesW((*paths)[i].c_str()) != INVALID_FILE_ATTRIBUTES;
+            }
+        },
+        [owner, keep] { ApplyMissingProbe(owner, *keep); },
+        g_listJobs.Token());
+}
+
+// 滚轮：向上撤销，向下重做（高精度滚轮按 WHEEL_DELTA 累积）
+static void OnHistoryWheel(HWND owner, int delta) {
+    g_wheelAccum += delta;
+    relay::HistoryOp op = relay::HISTORY_NONE;
+    bool undo = g_wheelAccum > 0;
+    while (g_wheelAccum >= WHEEL_DELTA || g_wheelAccum <= -WHEEL_DELTA) {
+        relay::HistoryOp step = undo ? g_history.Undo() : g_history.Redo();
+        g_wheelAccum += undo ? -WHEEL_DELTA : WHEEL_DELTA;
+        if (step == relay::HISTORY_NONE) { g_wheelAccum = 0; break; }
+        op = step;
+    }
+    if (op == relay::HISTORY_NONE) {
+        if (!EnsureTipText()) return;
+        StringCchCopyW(g_tipText, TIP_TEXT_CCH, undo ? L"没有可撤销的操作" : L"没有可重做的操作");
+        ShowTipWindow(owner, 1);
+        return;
+    }
+    ApplyListState(g_history.Current());
+    wchar_t line[64];
+    StringCchPrintfW(line, _countof(line), L"%s：%s", undo ? L"撤销" : L"重做", HISTORY_LABELS[op]);
+    ShowHistoryTip(owner, line);
+}
+
+// ---------------- Idle mode ----------------
+// 常驻小窗大部分时间没人碰：安静一段时间后把只在交互时才用的东西都放掉
+static void ArmIdleTimer(HWND hwnd) {
+    uint32_t due = g_idle.MsUntilIdle(GetTickCount64());
+    if (due == UINT32_MAX) { KillTimer(hwnd, TIMER_IDLE); return; }
+    SetTimer(hwnd, TIMER_IDLE, due > USER_TIMER_MINIMUM ? due : USER_TIMER_MINIMUM, NULL);
+}
+
+static void NoteActivity(HWND hwnd) {
+    if (!g_idle.Enabled()) return;
+    g_idle.Touch(GetTickCount64());
+    ArmIdleTimer(hwnd);
+}
+
+static void EnterIdleMode() {
+    ReleaseTipGdiObjects();
+    ReleaseTipText();
+    if (g_compactPolicy.ShouldCompact(g_list.ReservedBytes(), g_list.UsedBytes())) g_list.Compact();
+    g_view.Compact();
+
+    // 堆整理与工作集裁剪可能要翻很多页，放后台
+    bool trim = g_style.idleTrimWorkingSet;
+    g_exec.Submit(relay::PRIORITY_BULK, [trim] {
+        HeapCompact(GetProcessHeap(), 0);
+        if (trim) SetProcessWorkingSetSize(GetCurrentProcess(), (SIZE_T)-1, (SIZE_T)-1);
+    });
+}
+
+static void OnIdleTimer(HWND hwnd) {
+    bool busy = (g_tipWnd && IsWindow(g_tipWnd)) || g_mouseDown;
+    if (g_idle.Poll(GetTickCount64(), busy)) {
+        KillTimer(hwnd, TIMER_IDLE);
+        EnterIdleMode();
+        return;
+    }
+    ArmIdleTimer(hwnd);
+}
+
 static void PaintTip(HWND hwnd) {
     PAINTSTRUCT ps;
     HDC hdc = BeginPaint(hwnd, &ps);
@@ -663,11 +1685,296 @@ LRESULT CALLBACK TipWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     return DefWindowProcW(hwnd, msg, wParam, lParam);
 }
 
+// ---------------- drop receiving ----------------
+// 一次拖入：IDropTarget::Drop 与 WM_DROPFILES 共用
+// 先解析到 paths，至少收进一条路径才 CommitDrop；坏块、空块、追加到已满的列表都不碰列表，也不进撤销历史
+struct DropSession {
+    bool append = false;
+    int room = 0;            // 还能收几条：max_count（追加时减去已有的）
+    UINT total = 0;          // 拖进来的全部路径（含超出 max_count 的）
+    relay::PathList paths;
+    std::string trace;       // 开了 drop_trace 时攒下的路径行
+};
+
+static void InitDropSession(DropSession& s, bool append) {
+    s.append = append;
+    s.room = g_style.maxCount - (append ? g_list.Count() : 0);
+    if (s.room < 0) s.room = 0;
+}
+
+// 返回 false 表示不必再往下解析
+static bool AddDroppedPath(DropSession& s, const wchar_t* path, size_t len) {
+    ++s.total;
+    if (g_style.dropTracePath[0]) {
+        relay::AppendUtf8(path, len, s.trace);
+        s.trace += '\n';
+    }
+    if (s.paths.Count() < s.room) s.paths.Add(path, len);
+    return g_style.dropTracePath[0] || s.paths.Count() < s.room;
+}
+
+static void CommitDrop(HWND hwnd, DropSession& s) {
+    if (g_style.dropTracePath[0]) AppendDropTrace(s.append, s.total, s.trace);
+    CancelListJobs();
+    const int oldCount = g_list.Count();
+    // default: overwrite; Ctrl: append
+    if (s.append) {
+        for (int i = 0; i < s.paths.Count(); ++i) g_list.Add(s.paths.Path(i));
+    } else {
+        g_list = std::move(s.paths);
+    }
+    for (int i = s.append ? oldCount : 0; i < g_list.Count(); ++i) StatEntry(i);
+
+    if (s.append) MergeAppendedIntoList();
+    else ResortList();
+    RecordDrop(s.append, oldCount);
+    PublishHttpShare();
+    InvalidateRect(hwnd, NULL, TRUE);
+}
+
+// 解析完之后：有路径才改列表；拖进来的路径一条都没收（追加到已满的列表）时只提示。返回是否收下
+static bool FinishDrop(HWND hwnd, DropSession& s) {
+    if (s.paths.Count() > 0) {
+        CommitDrop(hwnd, s);
+        return true;
+    }
+    if (s.total == 0) return false;
+    if (g_style.dropTracePath[0]) AppendDropTrace(s.append, s.total, s.trace);
+    if (EnsureTipText()) {
+        StringCchPrintfW(g_tipText, TIP_TEXT_CCH, L"列表已满（最多 %d 项），没有追加", g_style.maxCount);
+        ShowTipWindow(hwnd, 1);
+    }
+    return false;
+}
+
+// CF_HDROP 块：块内指针按长度直接收进会话，不经 DragQueryFileW
+static void IngestDropFiles(DropSession& s, const void* block, size_t bytes) {
+    relay::DropFilesView v;
+    if (!relay::ParseDropFilesHeader(block, bytes, v)) return;
+    if (v.wide) {
+        relay::ForEachDropPath<wchar_t>(v.list, v.bytes, [&](const wchar_t* p, size_t n) {
+            return AddDroppedPath(s, p, n);
+        });
+        return;
+    }
+    std::wstring w;
+    relay::ForEachDropPath<char>(v.list, v.bytes, [&](const char* p, size_t n) {
+        int cch = MultiByteToWideChar(CP_ACP, 0, p, (int)n, NULL, 0);
+        if (cch <= 0) return true;
+        w.resize(cch);
+        MultiByteToWideChar(CP_ACP, 0, p, (int)n, &w[0], cch);
+        return AddDroppedPath(s, w.data(), w.size());
+    });
+}
+
+// Shell IDList：只收有文件系统路径的项（库、搜索结果等）；纯虚拟项跳过
+static void IngestShellIdList(DropSession& s, const void* cida, size_t bytes) {
+    std::vector<uint8_t> pidl;
+    std::vector<wchar_t> path(32768);
+    relay::ForEachShellItem(cida, bytes, [&](const uint8_t* parent, size_t pb, const uint8_t* child, size_t cb) {
+        relay::CombinePidl(parent, pb, child, cb, pidl);
+        if (!SHGetPathFromIDListEx((PCIDLIST_ABSOLUTE)pidl.data(), path.data(), (DWORD)path.size(), GPFIDL_DEFAULT)) {
+            return true;
+        }
+        return AddDroppedPath(s, path.data(), wcslen(path.data()));
+    });
+}
+
+static CLIPFORMAT CfShellIdList() {
+    static CLIPFORMAT cf = (CLIPFORMAT)RegisterClipboardFormatW(CFSTR_SHELLIDLIST);
+    return cf;
+}
+static CLIPFORMAT CfDropDescription() {
+    static CLIPFORMAT cf = (CLIPFORMAT)RegisterClipboardFormatW(CFSTR_DROPDESCRIPTION);
+    return cf;
+}
+
+// 取一种 HGLOBAL 格式，锁住后交给 ingest 解析；取不到或一条路径都没收进来返回 false
+template <class Ingest>
+static bool IngestFormat(IDataObject* data, CLIPFORMAT cf, DropSession& s, Ingest ingest) {
+    FORMATETC fe{cf, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL};
+    STGMEDIUM m{};
+    if (FAILED(data->GetData(&fe, &m))) return false;
+    if (m.tymed == TYMED_HGLOBAL) {
+        if (const void* block = GlobalLock(m.hGlobal)) {
+            ingest(s, block, (size_t)GlobalSize(m.hGlobal));
+            GlobalUnlock(m.hGlobal);
+        }
+    }
+    ReleaseStgMedium(&m);
+    return s.paths.Count() > 0;
+}
+
+// 主窗口的 OLE 拖放目标：悬停反馈 + 直接解析拖入数据
+class DropTarget : public IDropTarget {
+    LONG m_ref;
+    HWND m_hwnd;
+    bool m_accept = false;
+    int m_hint = 0;
+    IDataObject* m_data = nullptr;           // DragEnter 到 DragLeave/Drop 之间持有，Ctrl 变化时改说明文字
+    IDropTargetHelper* m_helper = nullptr;   // 拖动图像与说明文字；第一次拖入时才创建
+
+    // 拖入的一定是“复制”：绝不回 MOVE，免得来源把原文件删掉
+    DWORD Effect(DWORD allowed) const {
+        return (m_accept && (allowed & DROPEFFECT_COPY)) ? DROPEFFECT_COPY : DROPEFFECT_NONE;
+    }
+
+    // 悬停时的说明文字（来源用了拖动图像时显示在光标旁）与小窗提示
+    void SetHint(DWORD keys) {
+        int hint = !m_accept ? 0 : ((keys & MK_CONTROL) ? 2 : 1);
+        if (hint == m_hint) return;
+        m_hint = hint;
+        g_dropHint = hint;
+        InvalidateRect(m_hwnd, NULL, TRUE);
+        if (!m_data || !m_helper) return;
+
+        HGLOBAL h = GlobalAlloc(GMEM_MOVEABLE | GMEM_ZEROINIT, sizeof(DROPDESCRIPTION));
+        if (!h) return;
+        DROPDESCRIPTION* dd = (DROPDESCRIPTION*)GlobalLock(h);
+        if (!dd) { GlobalFree(h); return; }
+        dd->type = hint ? DROPIMAGE_COPY : DROPIMAGE_INVALID;
+        if (hint == 1) StringCchCopyW(dd->szMessage, MAX_PATH, L"覆盖中转列表");
+        else if (hint == 2) StringCchCopyW(dd->szMessage, MAX_PATH, L"追加到中转列表");
+        GlobalUnlock(h);
+        FORMATETC fe{CfDropDescription(), nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL};
+        STGMEDIUM m{};
+        m.tymed = TYMED_HGLOBAL;
+        m.hGlobal = h;
+        if (FAILED(m_data->SetData(&fe, &m, TRUE))) GlobalFree(h);
+    }
+
+    void EndHover() {
+        m_hint = 0;
+        g_dropHint = 0;
+        if (m_data) { m_data->Release(); m_data = nullptr; }
+        InvalidateRect(m_hwnd, NULL, TRUE);
+    }
+
+public:
+    explicit DropTarget(HWND hwnd) : m_ref(1), m_hwnd(hwnd) {}
+    ~DropTarget() {
+        if (m_data) m_data->Release();
+        if (m_helper) m_helper->Release();
+    }
+
+    STDMETHODIMP QueryInterface(REFIID riid, void** ppv) override {
+        if (!ppv) return E_POINTER;
+        *ppv = nullptr;
+        if (riid == IID_IUnknown || riid == IID_IDropTarget) {
+            *ppv = (IDropTarget*)this;
+            AddRef();
+            return S_OK;
+        }
+        return E_NOINTERFACE;
+    }
+    STDMETHODIMP_(ULONG) AddRef() override { return InterlockedIncrement(&m_ref); }
+    STDMETHODIMP_(ULONG) Release() override {
+        ULONG r = InterlockedDecrement(&m_ref);
+        if (!r) delete this;
+        return r;
+    }
+
+    STDMETHODIMP DragEnter(IDataObject* data, DWORD keys, POINTL pt, DWORD* effect) override {
+        if (!effect) return E_INVALIDARG;
+        NoteActivity(m_hwnd);
+        FORMATETC hdrop{CF_HDROP, nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL};
+        FORMATETC idl{CfShellIdList(), nullptr, DVASPECT_CONTENT, -1, TYMED_HGLOBAL};
+        // 从自己拖出再拖回来不算拖入
+        m_accept = data && !g_dragOutActive &&
+                   (data->QueryGetData(&hdrop) == S_OK || data->QueryGetData(&idl) == S_OK);
+        *effect = Effect(*effect);
+        if (m_data) m_data->Release();
+        m_data = data;
+        if (m_data) m_data->AddRef();
+        if (!m_helper) {
+            CoCreateInstance(CLSID_DragDropHelper, NULL, CLSCTX_INPROC_SERVER, IID_IDropTargetHelper,
+                             (void**)&m_helper);
+        }
+        POINT p{pt.x, pt.y};
+        if (m_helper) m_helper->DragEnter(m_hwnd, data, &p, *effect);
+        m_hint = -1;
+        SetHint(keys);
+        return S_OK;
+    }
+    STDMETHODIMP DragOver(DWORD keys, POINTL pt, DWORD* effect) override {
+        if (!effect) return E_INVALIDARG;
+        *effect = Effect(*effect);
+        POINT p{pt.x, pt.y};
+        if (m_helper) m_helper->DragOver(&p, *effect);
+        SetHint(keys);
+        return S_OK;
+    }
+    STDMETHODIMP DragLeave() override {
+        if (m_helper) m_helper->DragLeave();
+        EndHover();
+        return S_OK;
+    }
+    STDMETHODIMP Drop(IDataObject* data, DWORD keys, POINTL pt, DWORD* effect) override {
+        if (!effect) return E_INVALIDARG;
+        *effect = Effect(*effect);
+        POINT p{pt.x, pt.y};
+        if (m_helper) m_helper->Drop(data, &p, *effect);
+        EndHover();
+        if (!data || *effect == DROPEFFECT_NONE) return S_OK;
+
+        NoteActivity(m_hwnd);
+        bool append = (keys & MK_CONTROL) != 0;
+        DropSession s;
+        InitDropSession(s, append);
+        // 有 CF_HDROP 时优先（一次解析），没有或解析不出路径时退回 Shell IDList；
+        // 解析出了路径只是列表已满时不再退回（同一批文件）
+        if (!IngestFormat(data, CF_HDROP, s, IngestDropFiles) && s.total == 0) {
+            IngestFormat(data, CfShellIdList(), s, IngestShellIdList);
+        }
+        if (!FinishDrop(m_hwnd, s)) *effect = DROPEFFECT_NONE;
+        return S_OK;
+    }
+};
+
 // ---------------- Main window proc ----------------
 static void UpdateMain(HWND hwnd) {
     InvalidateRect(hwnd, NULL, TRUE);
 }
 
+// 首帧之后：OLE（拖出、拖放目标要用）、后台线程、HTTP 自启动、补写默认 ini
+static void OnDeferredInit(HWND hwnd) {
+    g_oleReady = SUCCEEDED(OleInitialize(NULL));
+    StartupMark("ole");
+
+    if (g_oleReady) {
+        g_dropTarget = new DropTarget(hwnd);
+        if (FAILED(RegisterDragDrop(hwnd, g_dropTarget))) {
+            g_dropTarget->Release();
+            g_dropTarget = NULL;
+        }
+        StartupMark("drop_target");
+    }
+
+    unsigned workers = (unsigned)g_style.execWorkers;
+    if (workers == 0) {
+        workers = std::thread::hardware_concurrency();
+        if (workers == 0) workers = 1;
+        if (workers > 4) workers = 4;
+    }
+    g_execEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    g_exec.SetCompletionSignal([] { if (g_execEvent) SetEvent(g_execEvent); });
+    g_exec.Start(workers);
+    StartupMark("executor");
+
+    if (g_style.httpAutostart) {
+        StartHttpShare();
+        StartupMark("http");
+    }
+    if (g_iniMissing) {
+        WriteDefaultIni(g_iniPath);
+        g_iniMissing = false;
+        StartupMark("ini_write");
+    }
+
+    StartupMark("ready");
+    FlushStartupTrace();
+}
+
 LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
     switch (msg) {
     case WM_CREATE:
@@ -675,6 +1982,13 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
         if (g_style.healIntervalMs > 0) {
             SetTimer(hwnd, TIMER_HEAL, (UINT)g_style.healIntervalMs, NULL);
         }
+        g_idle.SetQuietMs((uint32_t)g_style.idleAfterMs);
+        g_history.SetDepth((size_t)g_style.historyDepth);
+        NoteActivity(hwnd);
+        return 0;
+
+    case WM_APP_DEFERRED_INIT:
+        OnDeferredInit(hwnd);
         return 0;
 
     case WM_TIMER:
@@ -687,43 +2001,66 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
                          SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE | SWP_SHOWWINDOW);
             return 0;
         }
+        if (wParam == TIMER_IDLE) {
+            OnIdleTimer(hwnd);
+            return 0;
+        }
         break;
 
+    // OLE 拖放目标注册之前（首帧前后）或注册失败时的退路
     case WM_DROPFILES: {
+        NoteActivity(hwnd);
         HDROP hDrop = (HDROP)wParam;
-        UINT total = DragQueryFileW(hDrop, 0xFFFFFFFF, NULL, 0);
-
         bool ctrlDown = (GetKeyState(VK_CONTROL) & 0x8000) != 0;
-
-        // default: overwrite; Ctrl: append
-        if (!ctrlDown) g_count = 0;
-
-        for (UINT i = 0; i < total && g_count < g_style.maxCount; ++i) {
-            wchar_t path[MAX_PATH];
-            UINT n = DragQueryFileW(hDrop, i, path, MAX_PATH);
-            if (n > 0) {
-                StringCchCopyW(g_paths[g_count], MAX_PATH, path);
-                const wchar_t* base = wcsrchr(path, L'\\');
-                StringCchCopyW(g_names[g_count], MAX_PATH, base ? (base + 1) : path);
-                g_count++;
-            }
+        DropSession s;
+        InitDropSession(s, ctrlDown);
+        if (const void* block = GlobalLock((HGLOBAL)hDrop)) {
+            IngestDropFiles(s, block, (size_t)GlobalSize((HGLOBAL)hDrop));
+            GlobalUnlock((HGLOBAL)hDrop);
         }
         DragFinish(hDrop);
-
-        UpdateMain(hwnd);
+        FinishDrop(hwnd, s);
         return 0;
     }
 
     case WM_RBUTTONDOWN:
+        NoteActivity(hwnd);
         // Ctrl + Right Click to exit
         if (GetKeyState(VK_CONTROL) & 0x8000) {
             DestroyWindow(hwnd);
             return 0;
         }
-        ShowAutoCloseTip(hwnd);
+        // Shift + Right Click to cycle sort mode
+        if (GetKeyState(VK_SHIFT) & 0x8000) {
+            CycleSortMode();
+            PublishHttpShare();
+            ShowAutoCloseTip(hwnd, true);
+            return 0;
+        }
+        // Alt + Right Click for memory diagnostics
+        if (GetKeyState(VK_MENU) & 0x8000) {
+            ShowMemoryTip(hwnd);
+            return 0;
+        }
+        ShowAutoCloseTip(hwnd, false);
+        return 0;
+
+    case WM_MBUTTONDOWN:
+        NoteActivity(hwnd);
+        if (wParam & MK_CONTROL) ClearRelayList(hwnd);
+        else if (wParam & MK_SHIFT) RemoveMissingEntries(hwnd);
+        else ToggleHttpShare(hwnd);
+        UpdateMain(hwnd);
+        return 0;
+
+    case WM_MOUSEWHEEL:
+        NoteActivity(hwnd);
+        OnHistoryWheel(hwnd, GET_WHEEL_DELTA_WPARAM(wParam));
+        UpdateMain(hwnd);
         return 0;
 
     case WM_LBUTTONDOWN:
+        NoteActivity(hwnd);
         g_mouseDown = true;
         g_mouseDownPt.x = GET_X_LPARAM(lParam);
         g_mouseDownPt.y = GET_Y_LPARAM(lParam);
@@ -739,7 +2076,7 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
             if ((dx * dx + dy * dy) > 25) {
                 g_mouseDown = false;
                 ReleaseCapture();
-                StartDragIfHasFiles(hwnd);
+                StartDragIfHasFiles((GetKeyState(VK_MENU) & 0x8000) != 0);
             }
         }
         return 0;
@@ -775,6 +2112,14 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
     case WM_DESTROY:
         if (g_style.healIntervalMs > 0) KillTimer(hwnd, TIMER_HEAL);
+        KillTimer(hwnd, TIMER_IDLE);
+        if (g_dropTarget) {
+            RevokeDragDrop(hwnd);
+            g_dropTarget->Release();
+            g_dropTarget = NULL;
+        }
+        g_http.Stop();
+        g_exec.Shutdown();
         PostQuitMessage(0);
         return 0;
     }
@@ -783,26 +2128,28 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
 // ---------------- entry ----------------
 int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
-    OleInitialize(NULL);
+    std::wstring traceArg;
+    bool traceStartup = relay::FindSwitch(GetCommandLineW(), L"--trace-startup", &traceArg);
+    if (traceStartup) {
+        g_startup.Begin(StartupNowUs());
+        g_startup.SetPreMainUs(ProcessAgeUs());
+    }
 
     // ini path: exe directory + config.ini
     GetModuleFileNameW(NULL, g_iniPath, MAX_PATH);
     wchar_t* slash = wcsrchr(g_iniPath, L'\\');
     if (slash) *(slash + 1) = 0;
+    if (traceStartup) g_startupLogPath = traceArg.empty() ? std::wstring(g_iniPath) + L"startup_trace.log" : traceArg;
     StringCchCatW(g_iniPath, MAX_PATH, L"config.ini");
 
-    if (!FileExists(g_iniPath)) {
-        // 先用当前默认 g_style 写出一份 ini
-        WriteDefaultIni(g_iniPath);
-    }
-    LoadIniStyle(g_iniPath);
-
     // ---- single instance ----
+    // 先于读 ini：重复启动的实例只为决定要不要提示才去读
     g_singleMutex = CreateMutexW(NULL, TRUE, L"Global\\FileRelayDock_SingleInstance");
     if (!g_singleMutex) {
         // 创建失败也别硬崩，继续跑（可选：直接退出）
     } else {
         if (GetLastError() == ERROR_ALREADY_EXISTS) {
+            LoadIniStyle(g_iniPath);
             if (g_style.showSingleTip) {
                 MessageBoxW(NULL, L"程序已经在运行。", L"提示", MB_OK | MB_ICONINFORMATION);
             }
@@ -810,10 +2157,20 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
             return 0;
         }
     }
+    StartupMark("instance");
+
+    // 没有 ini 时直接用内置默认值画首帧，默认 ini 到首帧之后再写
+    if (FileExists(g_iniPath)) {
+        LoadIniStyle(g_iniPath);
+    } else {
+        g_iniMissing = true;
+        RebuildGdiObjects();
+    }
+    StartupMark("ini");
 
     ResolveXY(g_style.x, g_style.y, g_style.w, g_style.h);
 
-    // register main class
+    // register main class（tip 窗口类见 EnsureTipClass）
     WNDCLASSW wc{};
     wc.lpfnWndProc = MainWndProc;
     wc.hInstance = hInst;
@@ -821,15 +2178,7 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
     wc.hCursor = LoadCursor(NULL, IDC_ARROW);
     wc.hbrBackground = NULL;
     RegisterClassW(&wc);
-
-    // register tip class
-    WNDCLASSW twc{};
-    twc.lpfnWndProc = TipWndProc;
-    twc.hInstance = hInst;
-    twc.lpszClassName = TIP_CLASS;
-    twc.hCursor = LoadCursor(NULL, IDC_ARROW);
-    twc.hbrBackground = NULL;
-    RegisterClassW(&twc);
+    StartupMark("class");
 
     DWORD ex = WS_EX_TOOLWINDOW;
     if (g_style.topmost) ex |= WS_EX_TOPMOST;
@@ -842,18 +2191,31 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
     );
 
     ApplyLayeredAttributes(hwnd);
+    StartupMark("window");
 
-    ShowWindow(hwnd, SW_SHOWNOACTIVATE);
+    // 位置/大小/置顶在创建时已定：一次 SetWindowPos 只负责显示，UpdateWindow 同步画出首帧
+    SetWindowPos(hwnd, g_style.topmost ? HWND_TOPMOST : HWND_NOTOPMOST, 0, 0, 0, 0,
+                 SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE | SWP_SHOWWINDOW);
     UpdateWindow(hwnd);
+    StartupMark("show");
 
-    SetWindowPos(hwnd, g_style.topmost ? HWND_TOPMOST : HWND_NOTOPMOST,
-                 g_style.x, g_style.y, g_style.w, g_style.h,
-                 SWP_NOACTIVATE | SWP_SHOWWINDOW);
+    PostMessageW(hwnd, WM_APP_DEFERRED_INIT, 0, 0);
 
+    // 消息与后台完成回调一起等：工作线程攒下第一条回调时 SetEvent，这里整批执行
+    // 事件在首帧之后的延迟初始化里才创建
     MSG msg;
-    while (GetMessageW(&msg, NULL, 0, 0)) {
-        TranslateMessage(&msg);
-        DispatchMessageW(&msg);
+    for (bool quit = false; !quit;) {
+        DWORD waitCount = g_execEvent ? 1 : 0;
+        DWORD r = MsgWaitForMultipleObjectsEx(waitCount, &g_execEvent, INFINITE, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        if (waitCount && r == WAIT_OBJECT_0) {
+            g_exec.DrainCompletions();
+            continue;
+        }
+        while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE)) {
+            if (msg.message == WM_QUIT) { quit = true; break; }
+            TranslateMessage(&msg);
+            DispatchMessageW(&msg);
+        }
     }
 
     // 单例互斥体释放（放这里）
@@ -864,10 +2226,11 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
     }
 
     if (g_mainFont) DeleteObject(g_mainFont);
-    if (g_tipFont)  DeleteObject(g_tipFont);
     if (g_mainBgBrush) DeleteObject(g_mainBgBrush);
-    if (g_tipBgBrush)  DeleteObject(g_tipBgBrush);
+    ReleaseTipGdiObjects();
+    ReleaseTipText();
 
-    OleUninitialize();
+    if (g_execEvent) CloseHandle(g_execEvent);
+    if (g_oleReady) OleUninitialize();
     return 0;
 }
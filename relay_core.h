@@ -0,0 +1,380 @@
+// relay_core.h
+// 功能：小窗热路径中与 Win32 无关的部分，main.cpp 与 bench/bench.cpp 共用同一份实现
+// - 拖出：双 0 结尾的文件列表拼装、DROPFILES 块序列化
+// - tip：文本拼装（含分组标题、"...还有 N 个"）、高度与位置计算
+// - ini：一次读入整个文件后解析，替代逐键 GetPrivateProfile*（每次调用都会重读文件）
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <string>
+#include <vector>
+
+#include "relay_sort.h"
+
+namespace relay {
+
+// ---------------- drag-out list ----------------
+// 双 0 结尾列表需要的字符数（含最后的结束符，至少为 2）
+inline size_t FileListChars(const wchar_t* const* paths, const uint32_t* order, int count) {
+    size_t chars = 1;
+    for (int i = 0; i < count; ++i) {
+        size_t len = wcslen(paths[order[i]]);
+        if (len == 0) continue;
+        chars += len + 1;
+    }
+    if (chars < 2) chars = 2;
+    return chars;
+}
+
+// 按 order 顺序写出 "a\0b\0\0"，返回实际写入的字符数（全是空路径时为 1，调用方视为无效）
+inline size_t WriteFileList(const wchar_t* const* paths, const uint32_t* order, int count, wchar_t* out) {
+    wchar_t* p = out;
+    for (int i = 0; i < count; ++i) {
+        const wchar_t* path = paths[order[i]];
+        if (path[0] == 0) continue;
+        size_t len = wcslen(path);
+        memcpy(p, path, len * sizeof(wchar_t));
+        p += len;
+        *p++ = L'\0';
+    }
+    *p++ = L'\0';
+    return (size_t)(p - out);
+}
+
+// 与 Win32 DROPFILES 布局相同（20 字节）
+struct DropFilesHeader {
+    uint32_t pFiles;
+    int32_t  ptX, ptY;
+    int32_t  fNC;
+    int32_t  fWide;
+};
+static_assert(sizeof(DropFilesHeader) == 20, "DROPFILES layout");
+
+inline size_t DropFilesBytes(size_t listChars) {
+    return sizeof(DropFilesHeader) + listChars * sizeof(wchar_t);
+}
+
+// dst 至少 DropFilesBytes(listChars) 字节
+inline void WriteDropFiles(void* dst, const wchar_t* list, size_t listChars) {
+    DropFilesHeader hdr{};
+    hdr.pFiles = sizeof(DropFilesHeader);
+    hdr.fWide = 1;
+    memcpy(dst, &hdr, sizeof(hdr));
+    memcpy((uint8_t*)dst + sizeof(hdr), list, listChars * sizeof(wchar_t));
+}
+
+// ---------------- tip text ----------------
+// 追加式写入，记录当前长度，避免逐行 StringCchCatW 的反复求长
+struct TextSink {
+    wchar_t* buf;
+    size_t cch;
+    size_t len;
+
+    TextSink(wchar_t* b, size_t n) : buf(b), cch(n), len(0) { if (n) buf[0] = 0; }
+
+    void Append(const wchar_t* s, size_t n) {
+        if (len + 1 >= cch) return;
+        if (n > cch - 1 - len) n = cch - 1 - len;
+        memcpy(buf + len, s, n * sizeof(wchar_t));
+        len += n;
+        buf[len] = 0;
+    }
+    void Line(const wchar_t* s, size_t n) {
+        if (len) Append(L"\r\n", 2);
+        Append(s, n);
+    }
+    void Line(const wchar_t* s) { Line(s, wcslen(s)); }
+};
+
+struct TipInput {
+    const wchar_t* const* paths;
+    const wchar_t* const* names;   // 文件名；空串时显示完整路径
+    const uint32_t* order;         // 显示顺序（已按分组稳定重排）
+    int count;
+    GroupMode groupMode;
+    int maxLines;
+    const wchar_t* headLine;       // 可选的首行（如 "排序：名称"）
+};
+
+// 返回显示的行数（>=1）
+inline int BuildTipText(const TipInput& in, wchar_t* out, size_t cch) {
+    TextSink sink(out, cch);
+    int lines = 0;
+
+    if (in.headLine) { sink.Line(in.headLine); lines++; }
+
+    if (in.count <= 0) {
+        sink.Line(L"(空)");
+        return lines + 1;
+    }
+
+    const bool grouped = (in.groupMode != GROUP_NONE);
+
+    // 分组标题也占一行
+    int total = in.count;
+    if (grouped) {
+        GroupRef prev{nullptr, 0};
+        for (int i = 0; i < in.count; ++i) {
+            GroupRef g = GroupOf(in.paths[in.order[i]], in.groupMode);
+            if (!prev.p || NaturalCompareN(prev.p, prev.n, g.p, g.n) != 0) total++;
+            prev = g;
+        }
+    }
+
+    int maxLines = in.maxLines - lines;
+    if (maxLines < 1) maxLines = 1;
+
+    bool needMoreLine = (total > maxLines);
+    int showLines = needMoreLine ? (maxLines - 1) : maxLines;
+    if (showLines < 0) showLines = 0;
+
+    int used = 0, written = 0;
+    GroupRef cur{nullptr, 0};
+    for (int i = 0; i < in.count && used < showLines; ++i) {
+        uint32_t idx = in.order[i];
+        const wchar_t* s = in.names[idx][0] ? in.names[idx] : in.paths[idx];
+        if (!s || !*s) continue;
+
+        if (grouped) {
+            GroupRef g = GroupOf(in.paths[idx], in.groupMode);
+            if (!cur.p || NaturalCompareN(cur.p, cur.n, g.p, g.n) != 0) {
+                if (used + 2 > showLines) break;   // 不留孤立的标题行
+                if (g.n == 0) {
+                    sink.Line(in.groupMode == GROUP_EXT ? L"[无扩展名]" : L"[无文件夹]");
+                } else {
+                    sink.Line(L"[", 1);
+                    sink.Append(g.p, g.n);
+                    sink.Append(L"]", 1);
+                }
+                lines++;
+                used++;
+                cur = g;
+            }
+        }
+
+        sink.Line(s);
+        lines++;
+        used++;
+        written++;
+    }
+
+    if (written < in.count) {
+        wchar_t more[64];
+        swprintf(more, 64, L"...还有 %d 个文件", in.count - written);
+        sink.Line(more);
+        lines++;
+    }
+
+    if (lines <= 0) lines = 1;
+    return lines;
+}
+
+// ---------------- tip layout ----------------
+struct Rect {
+    int left, top, right, bottom;
+};
+
+// Estimate line height from font size (simple & compact; good enough for Segoe UI)
+inline int EstimateLineHeightPx(int fontSize) {
+    int h = (int)(fontSize * 1.7); // 1.45
+    if (h < 14) h = 14;
+    return h;
+}
+
+// tip 高度随行数增长，夹在 [minH, maxH] 之间；maxH=0 时由 maxLines 推出
+inline int TipHeight(int shownLines, int fontSize, int minH, int maxH, int maxLines) {
+    const int padTop = 10, padBottom = 10;
+    const int border = 2;
+    int lineH = EstimateLineHeightPx(fontSize);
+
+    int desiredH = padTop + padBottom + border + shownLines * lineH;
+
+    if (maxH == 0) {
+        if (maxLines < 1) maxLines = 1;
+        maxH = padTop + padBottom + border + maxLines * lineH;
+    }
+
+    int h = desiredH;
+    if (h < minH) h = minH;
+    if (h > maxH) h = maxH;
+    return h;
+}
+
+// 水平居中；底部任务栏时放在任务栏上方，否则贴屏幕底部
+inline void PlaceTipAboveTaskbar(int sw, int sh, const Rect* taskbar, int tipW, int tipH, int margin,
+                                 int& outX, int& outY) {
+    outX = (sw - tipW) / 2;
+    outY = sh - tipH - margin;
+
+    if (taskbar) {
+        int tbW = taskbar->right - taskbar->left;
+        int tbH = taskbar->bottom - taskbar->top;
+
+        // bottom taskbar (most common)
+        if (tbW >= tbH && taskbar->bottom >= sh - 2) {
+            outY = taskbar->top - tipH - margin;
+        }
+    }
+
+    if (outX < 0) outX = 0;
+    if (outY < 0) outY = 0;
+    if (outX > sw - tipW) outX = sw - tipW;
+    if (outY > sh - tipH) outY = sh - tipH;
+}
+
+// ---------------- ini ----------------
+// UTF-16LE(BOM) / UTF-8(可带 BOM) -> wchar_t；非法 UTF-8 返回 false，由调用方按本地代码页处理
+inline bool DecodeIniBytes(const uint8_t* p, size_t n, std::wstring& out) {
+    out.clear();
+    if (n >= 2 && p[0] == 0xFF && p[1] == 0xFE) {
+        out.reserve(n / 2);
+        for (size_t i = 2; i + 1 < n; i += 2) {
+            uint32_t u = p[i] | (p[i + 1] << 8);
+            if (sizeof(wchar_t) == 4 && u >= 0xD800 && u < 0xDC00 && i + 3 < n) {
+                uint32_t lo = p[i + 2] | (p[i + 3] << 8);
+                if (lo >= 0xDC00 && lo < 0xE000) {
+                    u = 0x10000 + ((u - 0xD800) << 10) + (lo - 0xDC00);
+                    i += 2;
+                }
+            }
+            out.push_back((wchar_t)u);
+        }
+        return true;
+    }
+
+    if (n >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF) { p += 3; n -= 3; }
+    out.reserve(n);
+    for (size_t i = 0; i < n;) {
+        uint32_t c = p[i];
+        size_t extra = c < 0x80 ? 0 : (c >> 5) == 6 ? 1 : (c >> 4) == 14 ? 2 : (c >> 3) == 30 ? 3 : 9;
+        if (extra == 9 || i + extra > n - 1) return false;
+        if (extra) c &= (0x3F >> extra);
+        for (size_t k = 1; k <= extra; ++k) {
+            if ((p[i + k] & 0xC0) != 0x80) return false;
+            c = (c << 6) | (p[i + k] & 0x3F);
+        }
+        i += extra + 1;
+        if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+            c -= 0x10000;
+            out.push_back((wchar_t)(0xD800 + (c >> 10)));
+            out.push_back((wchar_t)(0xDC00 + (c & 0x3FF)));
+        } else {
+            out.push_back((wchar_t)c);
+        }
+    }
+    return true;
+}
+
+// 只读 ini：解析一次，之后按节/键查找（忽略大小写，行为对齐 GetPrivateProfile*）
+class IniDoc {
+public:
+    void Parse(const wchar_t* text, size_t n) {
+        m_text.assign(text, n);
+        m_entries.clear();
+
+        Span section{0, 0};
+        size_t pos = 0;
+        while (pos < m_text.size()) {
+            size_t eol = m_text.find_first_of(L"\r\n", pos);
+            if (eol == std::wstring::npos) eol = m_text.size();
+            Span line = Trim(pos, eol);
+            pos = eol + 1;
+
+            if (line.n == 0) continue;
+            wchar_t c0 = m_text[line.off];
+            if (c0 == L';' || c0 == L'#') continue;
+
+            if (c0 == L'[') {
+                size_t close = m_text.find(L']', line.off);
+                if (close == std::wstring::npos || close >= line.off + line.n) continue;
+                section = Trim(line.off + 1, close);
+                continue;
+            }
+
+            size_t eq = m_text.find(L'=', line.off);
+            if (eq == std::wstring::npos || eq >= line.off + line.n) continue;
+            Entry e;
+            e.section = section;
+            e.key = Trim(line.off, eq);
+            e.value = Trim(eq + 1, line.off + line.n);
+            // GetPrivateProfileString 会去掉成对的引号
+            if (e.value.n >= 2) {
+                wchar_t q = m_text[e.value.off];
+                if ((q == L'"' || q == L'\'') && m_text[e.value.off + e.value.n - 1] == q) {
+                    e.value.off++;
+                    e.value.n -= 2;
+                }
+            }
+            m_entries.push_back(e);
+        }
+
+        // 值原地加结束符，Str() 可直接返回指针
+        m_text.push_back(0);
+        for (const Entry& e : m_entries) m_text[e.value.off + e.value.n] = 0;
+    }
+
+    // 找不到返回 nullptr
+    const wchar_t* Find(const wchar_t* section, const wchar_t* key) const {
+        size_t sn = wcslen(section), kn = wcslen(key);
+        for (const Entry& e : m_entries) {
+            if (Eq(e.section, section, sn) && Eq(e.key, key, kn)) return m_text.c_str() + e.value.off;
+        }
+        return nullptr;
+    }
+
+    const wchar_t* Str(const wchar_t* section, const wchar_t* key, const wchar_t* def) const {
+        const wchar_t* v = Find(section, key);
+        return v ? v : def;
+    }
+
+    // 十进制（可带符号）或 0x 十六进制；不是数字时为 0，与 GetPrivateProfileInt 一致
+    int Int(const wchar_t* section, const wchar_t* key, int def) const {
+        const wchar_t* v = Find(section, key);
+        if (!v || !*v) return def;
+        bool neg = false;
+        if (*v == L'-' || *v == L'+') { neg = (*v == L'-'); ++v; }
+        long long r = 0;
+        if (v[0] == L'0' && (v[1] == L'x' || v[1] == L'X')) {
+            v += 2;
+            for (;; ++v) {
+                int d = (*v >= L'0' && *v <= L'9') ? *v - L'0'
+                      : (*v >= L'a' && *v <= L'f') ? *v - L'a' + 10
+                      : (*v >= L'A' && *v <= L'F') ? *v - L'A' + 10 : -1;
+                if (d < 0) break;
+                r = (r << 4 | d) & 0xFFFFFFFFll;
+            }
+        } else {
+            for (; *v >= L'0' && *v <= L'9'; ++v) r = (r * 10 + (*v - L'0')) & 0xFFFFFFFFll;
+        }
+        int out = (int)(uint32_t)r;
+        return neg ? -out : out;
+    }
+
+private:
+    struct Span { size_t off, n; };
+    struct Entry { Span section, key, value; };
+
+    Span Trim(size_t b, size_t e) const {
+        while (b < e && (m_text[b] == L' ' || m_text[b] == L'\t')) ++b;
+        while (e > b && (m_text[e - 1] == L' ' || m_text[e - 1] == L'\t')) --e;
+        return Span{b, e - b};
+    }
+
+    bool Eq(const Span& s, const wchar_t* str, size_t n) const {
+        if (s.n != n) return false;
+        for (size_t i = 0; i < n; ++i) {
+            if (FoldCharW(m_text[s.off + i]) != FoldCharW(str[i])) return false;
+        }
+        return true;
+    }
+
+    std::wstring m_text;
+    std::vector<Entry> m_entries;
+};
+
+} // namespace relay
@@ -0,0 +1,531 @@
+// relay_deflate.h
+// 功能：CRC-32 与 raw deflate 编码（RFC 1951，与 Win32 无关，不依赖 zlib）
+// - LZ77：3 字节哈希链 + 一步惰性匹配；可带 32K 预置字典（分块并行压缩时用上一块的尾部）
+// - 每个块在动态 Huffman / 固定 Huffman / 存储三者中取最短
+// - 非最后一块以空存储块结束（sync flush，字节对齐），各块输出直接拼接即为合法的 deflate 流
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace relay {
+
+// ---------------- crc32 ----------------
+// slice-by-8，多项式 0xEDB88320（zip/gzip 用的那个）
+struct Crc32Tables {
+    uint32_t t[8][256];
+    Crc32Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+        }
+    }
+};
+
+inline const Crc32Tables& Crc32Table() {
+    static const Crc32Tables tables;
+    return tables;
+}
+
+// crc 为上一段的结果（首段传 0）
+inline uint32_t Crc32(uint32_t crc, const uint8_t* p, size_t n) {
+    const Crc32Tables& T = Crc32Table();
+    crc = ~crc;
+    while (n >= 8) {
+        uint32_t a = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+        uint32_t b = (uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24);
+        a ^= crc;
+        crc = T.t[7][a & 0xFF] ^ T.t[6][(a >> 8) & 0xFF] ^ T.t[5][(a >> 16) & 0xFF] ^ T.t[4][a >> 24] ^
+              T.t[3][b & 0xFF] ^ T.t[2][(b >> 8) & 0xFF] ^ T.t[1][(b >> 16) & 0xFF] ^ T.t[0][b >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n--) crc = T.t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+// ---------------- deflate ----------------
+class Deflater {
+public:
+    static const size_t WINDOW = 32768;
+
+    // maxChain：每个位置最多比较的候选数（越大越慢、压缩率越高）
+    explicit Deflater(int maxChain = 32) : m_maxChain(maxChain < 1 ? 1 : maxChain) {}
+
+    // n 个字节分 calls 次 Compress 的输出长度上界（不可压数据会比原文略大）。最坏时每块都按存储写：
+    // 除每次调用的最后一块外，一块至少覆盖 BLOCK_TOKENS 个原始字节；存储子块每 65535 字节一个头
+    // （3 位 + 对齐 + LEN/NLEN，不超过 6 字节）；每次调用另有 sync flush 空块、空输入的 EOB 与末尾对齐
+    static uint64_t Bound(uint64_t n, uint64_t calls = 1) {
+        return n + 6 * (n / BLOCK_TOKENS + n / 65535 + 2 * calls) + 9 * calls;
+    }
+
+    // 压缩 in[0..n)，追加到 out；dict 为紧挨在 in 之前的原始数据（最多用最后 32K）
+    // final=false 时以 sync flush 结束，final=true 时最后一块带 BFINAL
+    void Compress(const uint8_t* dict, size_t dictLen, const uint8_t* in, size_t n, bool final,
+                  std::vector<uint8_t>& out) {
+        if (dictLen > WINDOW) { dict += dictLen - WINDOW; dictLen = WINDOW; }
+        m_buf.resize(dictLen + n);
+        if (dictLen) memcpy(m_buf.data(), dict, dictLen);
+        if (n) memcpy(m_buf.data() + dictLen, in, n);
+
+        m_out = &out;
+        m_bits = 0;
+        m_bitCount = 0;
+
+        if (n == 0) {
+            if (final) {
+                // 固定 Huffman 块，只有 EOB
+                PutBits(1, 1);
+                PutBits(1, 2);
+                PutBits(0, 7);
+            }
+        } else {
+            Parse(dictLen, dictLen + n, final);
+        }
+        if (!final) {
+            // sync flush：空存储块
+            PutBits(0, 3);
+            AlignByte();
+            PutBits(0x0000, 16);
+            PutBits(0xFFFF, 16);
+        }
+        AlignByte();
+        m_out = nullptr;
+    }
+
+private:
+    static const int MIN_MATCH = 3;
+    static const int MAX_MATCH = 258;
+    static const int NICE_MATCH = 128;
+    static const int HASH_BITS = 15;
+    static const size_t BLOCK_TOKENS = 16384;
+
+    struct Token {
+        uint16_t litLen;   // dist==0：字面字节；否则匹配长度
+        uint16_t dist;
+    };
+
+    // ---- bit output ----
+    void PutBits(uint32_t v, int n) {
+        m_bits |= (uint64_t)v << m_bitCount;
+        m_bitCount += n;
+        while (m_bitCount >= 8) {
+            m_out->push_back((uint8_t)m_bits);
+            m_bits >>= 8;
+            m_bitCount -= 8;
+        }
+    }
+    void AlignByte() {
+        if (m_bitCount > 0) {
+            m_out->push_back((uint8_t)m_bits);
+            m_bits = 0;
+            m_bitCount = 0;
+        }
+    }
+
+    // ---- tables ----
+    static const uint16_t* LenBase() {
+        static const uint16_t t[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                       35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        return t;
+    }
+    static const uint8_t* LenExtra() {
+        static const uint8_t t[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                      3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        return t;
+    }
+    static const uint16_t* DistBase() {
+        static const uint16_t t[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                       8193, 12289, 16385, 24577};
+        return t;
+    }
+    static const uint8_t* DistExtra() {
+        static const uint8_t t[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                      7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+        return t;
+    }
+
+    struct CodeTables {
+        uint8_t lenCode[MAX_MATCH + 1];   // 匹配长度 -> 0..28
+        uint8_t distLo[256];              // dist-1 < 256
+        uint8_t distHi[256];              // (dist-1) >> 7
+        CodeTables() {
+            for (int c = 0; c < 29; ++c) {
+                int hi = c == 28 ? MAX_MATCH : LenBase()[c] + (1 << LenExtra()[c]) - 1;
+                for (int l = LenBase()[c]; l <= hi && l <= MAX_MATCH; ++l) lenCode[l] = (uint8_t)c;
+            }
+            lenCode[MAX_MATCH] = 28;
+            for (int c = 0; c < 30; ++c) {
+                int lo = DistBase()[c] - 1, hi = lo + (1 << DistExtra()[c]);
+                for (int d = lo; d < hi; ++d) {
+                    if (d < 256) distLo[d] = (uint8_t)c;
+                    if ((d >> 7) < 256 && d >= 256) distHi[d >> 7] = (uint8_t)c;
+                }
+            }
+        }
+    };
+    static const CodeTables& Codes() {
+        static const CodeTables t;
+        return t;
+    }
+    static int DistCode(int dist) {
+        int d = dist - 1;
+        return d < 256 ? Codes().distLo[d] : Codes().distHi[d >> 7];
+    }
+
+    // ---- LZ77 ----
+    static uint32_t Hash3(const uint8_t* p) {
+        uint32_t v = (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16);
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    void Insert(size_t p) {
+        uint32_t h = Hash3(&m_buf[p]);
+        m_prev[p] = m_head[h];
+        m_head[h] = (int32_t)p;
+    }
+
+    // 在 p 处找最长匹配（链上只有 < p 的位置）
+    int Longest(size_t p, size_t end, int& distOut) const {
+        int maxLen = (int)std::min<size_t>(MAX_MATCH, end - p);
+        if (maxLen < MIN_MATCH) return 0;
+        const uint8_t* cur = &m_buf[p];
+        int best = MIN_MATCH - 1;
+        int chain = m_maxChain;
+        int32_t cand = m_head[Hash3(cur)];
+        while (cand >= 0 && chain-- > 0) {
+            size_t dist = p - (size_t)cand;
+            if (dist > WINDOW) break;
+            const uint8_t* c = &m_buf[(size_t)cand];
+            if (c[best] == cur[best] && c[0] == cur[0] && c[1] == cur[1]) {
+                int len = 2;
+                while (len < maxLen && c[len] == cur[len]) ++len;
+                if (len > best) {
+                    best = len;
+                    distOut = (int)dist;
+                    if (len >= maxLen || len >= NICE_MATCH) break;
+                }
+            }
+            cand = m_prev[(size_t)cand];
+        }
+        return best >= MIN_MATCH ? best : 0;
+    }
+
+    void Parse(size_t start, size_t end, bool final) {
+        m_head.assign((size_t)1 << HASH_BITS, -1);
+        m_prev.resize(end);
+        for (size_t p = 0; p + MIN_MATCH <= start; ++p) Insert(p);
+
+        m_tokens.clear();
+        m_blockStart = start;
+
+        size_t p = start;
+        bool havePrev = false;
+        int prevLen = 0, prevDist = 0;
+        while (p < end) {
+            int dist = 0;
+            int len = Longest(p, end, dist);
+            if (p + MIN_MATCH <= end) Insert(p);
+
+            if (havePrev) {
+                if (len > prevLen) {
+                    Literal(m_buf[p - 1]);
+                    prevLen = len;
+                    prevDist = dist;
+                    FlushIfFull(p, end);
+                } else {
+                    Match(prevLen, prevDist);
+                    size_t stop = p - 1 + (size_t)prevLen;
+                    for (size_t q = p + 1; q < stop; ++q) {
+                        if (q + MIN_MATCH <= end) Insert(q);
+                    }
+                    p = stop;
+                    havePrev = false;
+                    FlushIfFull(p, end);
+                    continue;
+                }
+            } else if (len >= MIN_MATCH) {
+                if (len >= NICE_MATCH) {
+                    Match(len, dist);
+                    size_t stop = p + (size_t)len;
+                    for (size_t q = p + 1; q < stop; ++q) {
+                        if (q + MIN_MATCH <= end) Insert(q);
+                    }
+                    p = stop;
+                    FlushIfFull(p, end);
+                    continue;
+                }
+                havePrev = true;
+                prevLen = len;
+                prevDist = dist;
+            } else {
+                Literal(m_buf[p]);
+                FlushIfFull(p + 1, end);
+            }
+            ++p;
+        }
+        if (havePrev) Match(prevLen, prevDist);
+        WriteBlock(m_blockStart, end, final);
+    }
+
+    void Literal(uint8_t c) { m_tokens.push_back(Token{c, 0}); }
+    void Match(int len, int dist) { m_tokens.push_back(Token{(uint16_t)len, (uint16_t)dist}); }
+
+    // 块满时输出；rawEnd 为已被 token 覆盖的原始数据末尾
+    void FlushIfFull(size_t rawEnd, size_t end) {
+        if (m_tokens.size() < BLOCK_TOKENS || rawEnd >= end) return;
+        WriteBlock(m_blockStart, rawEnd, false);
+        m_blockStart = rawEnd;
+    }
+
+    // ---- Huffman ----
+    // 按频率求码长，最长 maxBits；少于 2 个非零符号时补齐，保证码表完整
+    static void BuildLengths(uint32_t* freq, int n, int maxBits, uint8_t* lens) {
+        int used = 0;
+        for (int i = 0; i < n; ++i) used += freq[i] != 0;
+        for (int i = 0; used < 2 && i < n; ++i) {
+            if (!freq[i]) { freq[i] = 1; ++used; }
+        }
+
+        struct Node { uint32_t f; int left, right; };
+        Node nodes[2 * 320];
+        int leaves[320];
+        int nl = 0;
+        for (int i = 0; i < n; ++i) {
+            lens[i] = 0;
+            if (freq[i]) leaves[nl++] = i;
+        }
+        std::sort(leaves, leaves + nl, [&](int a, int b) { return freq[a] != freq[b] ? freq[a] < freq[b] : a < b; });
+        for (int i = 0; i < nl; ++i) nodes[i] = Node{freq[leaves[i]], -1, -1};
+
+        // 双队列法：叶子已按频率升序，内部节点按生成顺序天然升序
+        int leafPos = 0, innerPos = nl, innerEnd = nl;
+        auto takeMin = [&]() {
+            if (leafPos < nl && (innerPos >= innerEnd || nodes[leafPos].f <= nodes[innerPos].f)) return leafPos++;
+            return innerPos++;
+        };
+        for (int k = 0; k < nl - 1; ++k) {
+            int a = takeMin(), b = takeMin();
+            nodes[innerEnd++] = Node{nodes[a].f + nodes[b].f, a, b};
+        }
+
+        // 深度
+        int depth[2 * 320];
+        depth[innerEnd - 1] = 0;
+        for (int i = innerEnd - 1; i >= nl; --i) {
+            depth[nodes[i].left] = depth[i] + 1;
+            depth[nodes[i].right] = depth[i] + 1;
+        }
+
+        // 按深度计数，超长的压到 maxBits 后修正 Kraft 和
+        int count[33] = {0};
+        for (int i = 0; i < nl; ++i) count[std::min(depth[i], 32)]++;
+        for (int b = maxBits + 1; b <= 32; ++b) { count[maxBits] += count[b]; count[b] = 0; }
+        uint32_t total = 0;
+        for (int b = 1; b <= maxBits; ++b) total += (uint32_t)count[b] << (maxBits - b);
+        while (total != (1u << maxBits)) {
+            count[maxBits]--;
+            for (int b = maxBits - 1; b > 0; --b) {
+                if (count[b]) { count[b]--; count[b + 1] += 2; break; }
+            }
+            total--;
+        }
+
+        // 频率最低的叶子拿最长的码
+        int idx = 0;
+        for (int b = maxBits; b >= 1; --b) {
+            for (int k = 0; k < count[b]; ++k) lens[leaves[idx++]] = (uint8_t)b;
+        }
+    }
+
+    // 规范 Huffman 码（已按 deflate 的位序反转）
+    static void BuildCodes(const uint8_t* lens, int n, uint16_t* codes) {
+        int count[16] = {0};
+        for (int i = 0; i < n; ++i) count[lens[i]]++;
+        count[0] = 0;
+        int next[16];
+        int code = 0;
+        for (int b = 1; b < 16; ++b) {
+            code = (code + count[b - 1]) << 1;
+            next[b] = code;
+        }
+        for (int i = 0; i < n; ++i) {
+            int len = lens[i];
+            if (!len) { codes[i] = 0; continue; }
+            int c = next[len]++;
+            int r = 0;
+            for (int k = 0; k < len; ++k) { r = (r << 1) | (c & 1); c >>= 1; }
+            codes[i] = (uint16_t)r;
+        }
+    }
+
+    static void FixedLengths(uint8_t* lit, uint8_t* dist) {
+        for (int i = 0; i < 288; ++i) lit[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+        for (int i = 0; i < 30; ++i) dist[i] = 5;
+    }
+
+    uint64_t TokenBits(const uint32_t* litFreq, const uint32_t* distFreq, const uint8_t* litLen, const uint8_t* distLen) const {
+        uint64_t bits = 0;
+        for (int i = 0; i < 286; ++i) {
+            bits += (uint64_t)litFreq[i] * litLen[i];
+            if (i > 256) bits += (uint64_t)litFreq[i] * LenExtra()[i - 257];
+        }
+        for (int i = 0; i < 30; ++i) bits += (uint64_t)distFreq[i] * (distLen[i] + DistExtra()[i]);
+        return bits;
+    }
+
+    void WriteTokens(const uint16_t* litCode, const uint8_t* litLen, const uint16_t* distCode, const uint8_t* distLen) {
+        const CodeTables& T = Codes();
+        for (const Token& t : m_tokens) {
+            if (t.dist == 0) {
+                PutBits(litCode[t.litLen], litLen[t.litLen]);
+                continue;
+            }
+            int lc = T.lenCode[t.litLen];
+            PutBits(litCode[257 + lc], litLen[257 + lc]);
+            if (LenExtra()[lc]) PutBits(t.litLen - LenBase()[lc], LenExtra()[lc]);
+            int dc = DistCode(t.dist);
+            PutBits(distCode[dc], distLen[dc]);
+            if (DistExtra()[dc]) PutBits(t.dist - DistBase()[dc], DistExtra()[dc]);
+        }
+        PutBits(litCode[256], litLen[256]);
+    }
+
+    void WriteStored(size_t from, size_t to, bool final) {
+        do {
+            size_t n = std::min<size_t>(to - from, 65535);
+            bool last = final && from + n == to;
+            PutBits(last ? 1 : 0, 1);
+            PutBits(0, 2);
+            AlignByte();
+            PutBits((uint32_t)n, 16);
+            PutBits((uint32_t)(~n & 0xFFFF), 16);
+            m_out->insert(m_out->end(), m_buf.begin() + from, m_buf.begin() + from + n);
+            from += n;
+        } while (from < to);
+    }
+
+    void WriteBlock(size_t rawFrom, size_t rawTo, bool final) {
+        uint32_t litFreq[286] = {0}, distFreq[30] = {0};
+        const CodeTables& T = Codes();
+        for (const Token& t : m_tokens) {
+            if (t.dist == 0) {
+                litFreq[t.litLen]++;
+            } else {
+                litFreq[257 + T.lenCode[t.litLen]]++;
+                distFreq[DistCode(t.dist)]++;
+            }
+        }
+        litFreq[256] = 1;
+
+        // dynamic
+        uint32_t lf[286], df[30];
+        memcpy(lf, litFreq, sizeof(lf));
+        memcpy(df, distFreq, sizeof(df));
+        uint8_t litLen[288] = {0}, distLen[30] = {0};
+        BuildLengths(lf, 286, 15, litLen);
+        BuildLengths(df, 30, 15, distLen);
+
+        int hlit = 286;
+        while (hlit > 257 && litLen[hlit - 1] == 0) --hlit;
+        int hdist = 30;
+        while (hdist > 1 && distLen[hdist - 1] == 0) --hdist;
+
+        uint8_t all[286 + 30];
+        memcpy(all, litLen, (size_t)hlit);
+        memcpy(all + hlit, distLen, (size_t)hdist);
+        int total = hlit + hdist;
+
+        // 码长序列的游程编码：sym | extra<<8
+        uint16_t rle[286 + 30];
+        int nr = 0;
+        uint32_t clFreq[19] = {0};
+        for (int i = 0; i < total;) {
+            int v = all[i], run = 1;
+            while (i + run < total && all[i + run] == v) ++run;
+            int left = run;
+            if (v == 0) {
+                while (left >= 11) { int k = std::min(left, 138); rle[nr++] = (uint16_t)(18 | ((k - 11) << 8)); clFreq[18]++; left -= k; }
+                if (left >= 3) { rle[nr++] = (uint16_t)(17 | ((left - 3) << 8)); clFreq[17]++; left = 0; }
+            } else {
+                rle[nr++] = (uint16_t)v; clFreq[v]++; --left;
+                while (left >= 3) { int k = std::min(left, 6); rle[nr++] = (uint16_t)(16 | ((k - 3) << 8)); clFreq[16]++; left -= k; }
+            }
+            while (left-- > 0) { rle[nr++] = (uint16_t)v; clFreq[v]++; }
+            i += run;
+        }
+
+        static const uint8_t CL_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        uint32_t cf[19];
+        memcpy(cf, clFreq, sizeof(cf));
+        uint8_t clLen[19];
+        BuildLengths(cf, 19, 7, clLen);
+        int hclen = 19;
+        while (hclen > 4 && clLen[CL_ORDER[hclen - 1]] == 0) --hclen;
+
+        uint64_t dynBits = 3 + 5 + 5 + 4 + 3 * (uint64_t)hclen + TokenBits(litFreq, distFreq, litLen, distLen);
+        for (int i = 0; i < 19; ++i) dynBits += (uint64_t)clFreq[i] * clLen[i];
+        dynBits += (uint64_t)clFreq[16] * 2 + (uint64_t)clFreq[17] * 3 + (uint64_t)clFreq[18] * 7;
+
+        uint8_t fixLit[288], fixDist[30];
+        FixedLengths(fixLit, fixDist);
+        uint64_t fixBits = 3 + TokenBits(litFreq, distFreq, fixLit, fixDist);
+
+        size_t raw = rawTo - rawFrom;
+        uint64_t storedBits = ((raw + 65534) / 65535) * (3 + 7 + 32) + (uint64_t)raw * 8;
+
+        if (storedBits <= dynBits && storedBits <= fixBits) {
+            WriteStored(rawFrom, rawTo, final);
+        } else if (fixBits <= dynBits) {
+            uint16_t litCode[288], distCode[30];
+            BuildCodes(fixLit, 288, litCode);
+            BuildCodes(fixDist, 30, distCode);
+            PutBits(final ? 1 : 0, 1);
+            PutBits(1, 2);
+            WriteTokens(litCode, fixLit, distCode, fixDist);
+        } else {
+            uint16_t litCode[288], distCode[30], clCode[19];
+            BuildCodes(litLen, 286, litCode);
+            BuildCodes(distLen, 30, distCode);
+            BuildCodes(clLen, 19, clCode);
+            PutBits(final ? 1 : 0, 1);
+            PutBits(2, 2);
+            PutBits((uint32_t)(hlit - 257), 5);
+            PutBits((uint32_t)(hdist - 1), 5);
+            PutBits((uint32_t)(hclen - 4), 4);
+            for (int i = 0; i < hclen; ++i) PutBits(clLen[CL_ORDER[i]], 3);
+            for (int i = 0; i < nr; ++i) {
+                int sym = rle[i] & 0xFF, extra = rle[i] >> 8;
+                PutBits(clCode[sym], clLen[sym]);
+                if (sym == 16) PutBits((uint32_t)extra, 2);
+                else if (sym == 17) PutBits((uint32_t)extra, 3);
+                else if (sym == 18) PutBits((uint32_t)extra, 7);
+            }
+            WriteTokens(litCode, litLen, distCode, distLen);
+        }
+        m_tokens.clear();
+    }
+
+    int m_maxChain;
+    std::vector<uint8_t> m_buf;       // 字典 + 输入
+    std::vector<int32_t> m_head;
+    std::vector<int32_t> m_prev;
+    std::vector<Token> m_tokens;
+    size_t m_blockStart = 0;
+
+    std::vector<uint8_t>* m_out = nullptr;
+    uint64_t m_bits = 0;
+    int m_bitCount = 0;
+};
+
+} // namespace relay
@@ -0,0 +1,154 @@
+// relay_drop.h
+// 功能：拖入数据的直接解析（与 Win32 无关，main.cpp 与 bench/bench.cpp 共用）
+// - CF_HDROP：DROPFILES 头 + 双 0 结尾列表，一次线性扫描，不逐个调用 DragQueryFileW；
+//   回调拿到的是块内指针和长度，不拷贝、不截断，路径长度不受 MAX_PATH 限制
+// - CFSTR_SHELLIDLIST：CIDA（cidl + aoffset[cidl + 1]，[0] 为父文件夹），逐项给出父/子 PIDL，
+//   CombinePidl 拼成绝对 PIDL 后由调用方取文件系统路径
+// - 只信任传入的字节数（GlobalSize）：偏移越界、缺结尾 0、PIDL 链断裂都按截断处理，不会读出缓冲
+// - ExtendedLengthPath：超长路径交给文件 API 之前加 \\?\ 前缀（UNC 为 \\?\UNC\）
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "relay_core.h"
+
+namespace relay {
+
+// ---------------- CF_HDROP ----------------
+struct DropFilesView {
+    const uint8_t* list = nullptr;   // 第一个路径
+    size_t bytes = 0;                // list 到块末尾的字节数
+    bool wide = false;               // true：UTF-16；false：本地代码页
+};
+
+// unitBytes 为宽字符的字节数（Windows 上为 2；bench 在 Linux 上用 4 字节 wchar_t 模拟）
+inline bool ParseDropFilesHeader(const void* block, size_t bytes, DropFilesView& out, size_t unitBytes = 2) {
+    out = DropFilesView();
+    if (!block || bytes < sizeof(DropFilesHeader)) return false;
+    DropFilesHeader hdr;
+    memcpy(&hdr, block, sizeof(hdr));
+    if (hdr.pFiles < sizeof(DropFilesHeader) || hdr.pFiles >= bytes) return false;
+    out.wide = hdr.fWide != 0;
+    if (out.wide && hdr.pFiles % unitBytes) return false;
+    out.list = (const uint8_t*)block + hdr.pFiles;
+    out.bytes = bytes - hdr.pFiles;
+    return true;
+}
+
+// 逐个回调 f(const Unit* path, size_t len)，f 返回 false 时停止；遇到空串（列表结尾）或缓冲末尾结束，
+// 末尾没有 0 结尾的残段丢弃。返回回调的次数
+template <class Unit, class F>
+inline size_t ForEachDropPath(const uint8_t* list, size_t bytes, F f) {
+    const Unit* p = (const Unit*)list;
+    const Unit* end = p + bytes / sizeof(Unit);
+    size_t n = 0;
+    while (p < end && *p) {
+        const Unit* s = p;
+        while (p < end && *p) ++p;
+        if (p == end) break;
+        ++n;
+        if (!f(s, (size_t)(p - s))) break;
+        ++p;
+    }
+    return n;
+}
+
+// ---------------- CFSTR_SHELLIDLIST ----------------
+// PIDL 的总字节数（含 2 字节的结尾 cb=0）；断链或越界返回 0
+inline size_t PidlBytes(const uint8_t* p, size_t avail) {
+    size_t off = 0;
+    for (;;) {
+        if (avail - off < 2) return 0;
+        uint16_t cb;
+        memcpy(&cb, p + off, 2);
+        if (cb == 0) return off + 2;
+        if (cb < 2 || cb > avail - off) return 0;
+        off += cb;
+    }
+}
+
+// 逐项回调 f(parent, parentBytes, child, childBytes)，f 返回 false 时停止；
+// 头部或父文件夹无效时返回 0，单个子项无效时跳过。返回回调的次数
+template <class F>
+inline size_t ForEachShellItem(const void* cida, size_t bytes, F f) {
+    const uint8_t* base = (const uint8_t*)cida;
+    if (!base || bytes < 8) return 0;
+    uint32_t cidl;
+    memcpy(&cidl, base, 4);
+    if (cidl == 0 || cidl > (bytes - 4) / 4 - 1) return 0;
+    auto offset = [&](uint32_t i) {
+        uint32_t v;
+        memcpy(&v, base + 4 + (size_t)i * 4, 4);
+        return (size_t)v;
+    };
+    size_t parentOff = offset(0);
+    if (parentOff >= bytes) return 0;
+    size_t parentBytes = PidlBytes(base + parentOff, bytes - parentOff);
+    if (!parentBytes) return 0;
+    size_t n = 0;
+    for (uint32_t i = 1; i <= cidl; ++i) {
+        size_t off = offset(i);
+        if (off >= bytes) continue;
+        size_t childBytes = PidlBytes(base + off, bytes - off);
+        if (!childBytes) continue;
+        ++n;
+        if (!f(base + parentOff, parentBytes, base + off, childBytes)) break;
+    }
+    return n;
+}
+
+// 父 PIDL（去掉结尾）+ 子 PIDL（带结尾）写进 out；out 可跨项复用
+inline void CombinePidl(const uint8_t* parent, size_t parentBytes, const uint8_t* child, size_t childBytes,
+                        std::vector<uint8_t>& out) {
+    out.resize(parentBytes - 2 + childBytes);
+    memcpy(out.data(), parent, parentBytes - 2);
+    memcpy(out.data() + parentBytes - 2, child, childBytes);
+}
+
+// ---------------- long paths ----------------
+// 不带 \\?\ 时文件 API 只认 MAX_PATH（260，含结尾 0）以内的路径
+static const size_t LONG_PATH_THRESHOLD = 260;
+
+namespace detail {
+
+// \\?\ 之后系统不再把 / 换成 \，这里自己换
+template <class C>
+inline const C* BackslashesFrom(std::basic_string<C>& s, size_t from) {
+    for (size_t i = from; i < s.size(); ++i) {
+        if (s[i] == '/') s[i] = '\\';
+    }
+    return s.c_str();
+}
+
+} // namespace detail
+
+// len >= threshold 的绝对路径返回加了前缀的 out.c_str()，否则原样返回 p（相对路径、已带前缀的也原样）
+template <class C>
+inline const C* ExtendedLengthPath(const C* p, size_t len, std::basic_string<C>& out,
+                                   size_t threshold = LONG_PATH_THRESHOLD) {
+    if (len < threshold || len < 3) return p;
+    bool sep0 = p[0] == '\\' || p[0] == '/';
+    bool sep1 = p[1] == '\\' || p[1] == '/';
+    if (sep0 && sep1) {
+        if ((p[2] == '?' || p[2] == '.') && len >= 4 && (p[3] == '\\' || p[3] == '/')) return p;
+        static const C unc[] = {'\\', '\\', '?', '\\', 'U', 'N', 'C', '\\'};
+        out.assign(unc, unc + 8);
+        out.append(p + 2, len - 2);
+        return detail::BackslashesFrom(out, 8);
+    }
+    bool drive = ((p[0] >= 'A' && p[0] <= 'Z') || (p[0] >= 'a' && p[0] <= 'z')) && p[1] == ':' &&
+                 (p[2] == '\\' || p[2] == '/');
+    if (!drive) return p;
+    static const C pre[] = {'\\', '\\', '?', '\\'};
+    out.assign(pre, pre + 4);
+    out.append(p, len);
+    return detail::BackslashesFrom(out, 4);
+}
+
+} // namespace relay
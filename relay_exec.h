@@ -0,0 +1,354 @@
+// relay_exec.h
+// 功能：统一的后台执行器（与 Win32 无关，main.cpp 与 bench/bench.cpp 共用）
+// - 固定数量的工作线程；每个线程有自己的双端队列，自己从尾部取（LIFO，缓存热），空闲时从别人头部偷
+//   非工作线程（界面线程）提交的任务进公共注入队列
+// - 两级优先级：每次取任务都先找 INTERACTIVE，再找 BULK；BULK 最多占 workers-1 个线程，
+//   保证交互任务不必排在一整批批量任务后面
+// - 取消：CancelToken 在任务开始前被取消则不执行；完成回调在界面线程投递前再检查一次
+// - 完成回调攒批投递：队列由空变非空时才调用一次 signal（Windows 上 SetEvent，消息循环用
+//   MsgWaitForMultipleObjectsEx 等它），界面线程 DrainCompletions 一次取走整批
+// - Shutdown 先把已排队、未取消的任务做完再退出；之后的 Submit 在调用线程上直接执行
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace relay {
+
+enum TaskPriority { PRIORITY_INTERACTIVE, PRIORITY_BULK, PRIORITY_COUNT };
+
+class CancelToken {
+public:
+    CancelToken() {}    // 永不取消
+    bool Cancelled() const { return m_flag && m_flag->load(std::memory_order_acquire); }
+
+private:
+    friend class CancelSource;
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+class CancelSource {
+public:
+    CancelSource() : m_flag(std::make_shared<std::atomic<bool>>(false)) {}
+    CancelToken Token() const {
+        CancelToken t;
+        t.m_flag = m_flag;
+        return t;
+    }
+    void Cancel() { m_flag->store(true, std::memory_order_release); }
+    bool Cancelled() const { return m_flag->load(std::memory_order_acquire); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_flag;
+};
+
+struct ExecStats {
+    uint64_t submitted = 0;
+    uint64_t executed = 0;
+    uint64_t stolen = 0;        // 从别的工作线程队列偷来的
+    uint64_t cancelled = 0;     // 开始前 / 投递前被取消
+    uint64_t completions = 0;   // 在界面线程执行的完成回调
+    uint64_t batches = 0;       // DrainCompletions 取到非空批次的次数
+};
+
+class Executor {
+public:
+    typedef std::function<void()> Fn;
+
+    Executor() {}
+    explicit Executor(unsigned workers) { Start(workers); }
+    ~Executor() { Shutdown(); }
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    // workers 为 0 时按 CPU 核数（至少 1）
+    void Start(unsigned workers) {
+        if (!m_workers.empty()) return;
+        if (workers == 0) workers = std::thread::hardware_concurrency();
+        if (workers == 0) workers = 1;
+        m_bulkLimit = workers > 1 ? workers - 1 : 1;
+        m_stop.store(false);
+        for (unsigned i = 0; i < workers; ++i) m_workers.emplace_back(new Worker());
+        for (unsigned i = 0; i < workers; ++i) {
+            m_workers[i]->thread = std::thread([this, i] { WorkerLoop((int)i); });
+        }
+        m_running = true;
+    }
+
+    void Shutdown() {
+        if (!m_running) return;
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMu);
+            m_stop.store(true);
+        }
+        m_wake.notify_all();
+        for (auto& w : m_workers) w->thread.join();
+        m_workers.clear();
+        m_running = false;
+        std::lock_guard<std::mutex> lock(m_doneMu);
+        m_done.clear();
+    }
+
+    bool Running() const { return m_running; }
+    unsigned Workers() const { return (unsigned)m_workers.size(); }
+
+    // 界面线程设置：完成队列由空变非空时在工作线程上调用
+    void SetCompletionSignal(Fn signal) {
+        std::lock_guard<std::mutex> lock(m_doneMu);
+        m_signal = std::move(signal);
+    }
+
+    // work 在工作线程执行；done（可为空）在界面线程 DrainCompletions 时执行
+    void Submit(TaskPriority prio, Fn work, Fn done = Fn(), CancelToken token = CancelToken()) {
+        m_submitted.fetch_add(1, std::memory_order_relaxed);
+        Task t{std::move(work), std::move(done), std::move(token)};
+        if (!m_running) {
+            Run(t);
+            return;
+        }
+        int self = CurrentWorker(this);
+        if (self >= 0) {
+            Worker& w = *m_workers[(size_t)self];
+            std::lock_guard<std::mutex> lock(w.mu);
+            w.q[prio].push_back(std::move(t));
+        } else {
+            std::lock_guard<std::mutex> lock(m_injectMu);
+            m_inject[prio].push_back(std::move(t));
+        }
+        m_pending[prio].fetch_add(1, std::memory_order_seq_cst);
+        if (m_sleepers.load(std::memory_order_seq_cst) > 0) {
+            { std::lock_guard<std::mutex> lock(m_sleepMu); }
+            m_wake.notify_one();
+        }
+    }
+
+    // fn(0..count) 分给工作线程并行做，调用线程也一起做，返回时全部做完。下标由先到者认领，
+    // 来晚的帮手认领不到就直接返回，所以在工作线程上调用（帮手排在自己队列里）也不会等死
+    void ParallelFor(TaskPriority prio, size_t count, const std::function<void(size_t)>& fn) {
+        struct Shared {
+            std::atomic<size_t> next{0};
+            size_t count = 0;
+            size_t done = 0;
+            std::function<void(size_t)> fn;
+            std::mutex mu;
+            std::condition_variable cv;
+        };
+        if (count == 0) return;
+        std::shared_ptr<Shared> st = std::make_shared<Shared>();
+        st->count = count;
+        st->fn = fn;
+        auto claim = [st] {
+            size_t finished = 0;
+            for (size_t i; (i = st->next.fetch_add(1, std::memory_order_relaxed)) < st->count; ++finished) st->fn(i);
+            if (finished == 0) return;
+            std::lock_guard<std::mutex> lock(st->mu);
+            st->done += finished;
+            if (st->done == st->count) st->cv.notify_all();
+        };
+        size_t helpers = std::min(count - 1, (size_t)Workers());
+        for (size_t h = 0; h < helpers && m_running; ++h) Submit(prio, claim);
+        claim();
+        std::unique_lock<std::mutex> lock(st->mu);
+        st->cv.wait(lock, [&] { return st->done == st->count; });
+    }
+
+    // 界面线程调用：执行当前攒下的整批完成回调，返回执行的个数
+    size_t DrainCompletions() {
+        std::vector<Completion> batch;
+        {
+            std::lock_guard<std::mutex> lock(m_doneMu);
+            batch.swap(m_done);
+        }
+        if (batch.empty()) return 0;
+        m_batches.fetch_add(1, std::memory_order_relaxed);
+        size_t ran = 0;
+        for (Completion& c : batch) {
+            if (c.token.Cancelled()) {
+                m_cancelled.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            c.done();
+            ++ran;
+        }
+        m_completions.fetch_add(ran, std::memory_order_relaxed);
+        return ran;
+    }
+
+    size_t PendingTasks() const {
+        return (size_t)(m_pending[PRIORITY_INTERACTIVE].load() + m_pending[PRIORITY_BULK].load());
+    }
+
+    ExecStats Stats() const {
+        ExecStats s;
+        s.submitted = m_submitted.load();
+        s.executed = m_executed.load();
+        s.stolen = m_stolen.load();
+        s.cancelled = m_cancelled.load();
+        s.completions = m_completions.load();
+        s.batches = m_batches.load();
+        return s;
+    }
+
+private:
+    struct Task {
+        Fn work;
+        Fn done;
+        CancelToken token;
+    };
+    struct Completion {
+        Fn done;
+        CancelToken token;
+    };
+    struct alignas(64) Worker {
+        std::mutex mu;
+        std::deque<Task> q[PRIORITY_COUNT];
+        std::thread thread;
+    };
+
+    // 当前线程是否为本执行器的工作线程；是则返回下标
+    static int& TlsIndex() { static thread_local int index = -1; return index; }
+    static const Executor*& TlsOwner() { static thread_local const Executor* owner = nullptr; return owner; }
+    static int CurrentWorker(const Executor* ex) { return TlsOwner() == ex ? TlsIndex() : -1; }
+
+    bool PopOwn(int self, int prio, Task& out) {
+        Worker& w = *m_workers[(size_t)self];
+        std::lock_guard<std::mutex> lock(w.mu);
+        if (w.q[prio].empty()) return false;
+        out = std::move(w.q[prio].back());
+        w.q[prio].pop_back();
+        return true;
+    }
+    bool PopInject(int prio, Task& out) {
+        std::lock_guard<std::mutex> lock(m_injectMu);
+        if (m_inject[prio].empty()) return false;
+        out = std::move(m_inject[prio].front());
+        m_inject[prio].pop_front();
+        return true;
+    }
+    bool Steal(int self, int prio, Task& out) {
+        size_t n = m_workers.size();
+        for (size_t k = 1; k < n; ++k) {
+            Worker& w = *m_workers[((size_t)self + k) % n];
+            std::lock_guard<std::mutex> lock(w.mu);
+            if (w.q[prio].empty()) continue;
+            out = std::move(w.q[prio].front());
+            w.q[prio].pop_front();
+            m_stolen.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+    bool Take(int self, int prio, Task& out) {
+        if (m_pending[prio].load(std::memory_order_acquire) == 0) return false;
+        if (PopOwn(self, prio, out) || PopInject(prio, out) || Steal(self, prio, out)) {
+            m_pending[prio].fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+        return false;
+    }
+
+    // 占一个批量名额；满了返回 false
+    bool AcquireBulk() {
+        unsigned cur = m_bulkRunning.load(std::memory_order_relaxed);
+        while (cur < m_bulkLimit) {
+            if (m_bulkRunning.compare_exchange_weak(cur, cur + 1, std::memory_order_acq_rel)) return true;
+        }
+        return false;
+    }
+    void ReleaseBulk() {
+        m_bulkRunning.fetch_sub(1);
+        if (m_pending[PRIORITY_BULK].load() > 0 && m_sleepers.load() > 0) {
+            { std::lock_guard<std::mutex> lock(m_sleepMu); }
+            m_wake.notify_one();
+        }
+    }
+
+    void Run(Task& t) {
+        if (t.token.Cancelled()) {
+            m_cancelled.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (t.work) t.work();
+        m_executed.fetch_add(1, std::memory_order_relaxed);
+        if (!t.done) return;
+        Fn signal;
+        {
+            std::lock_guard<std::mutex> lock(m_doneMu);
+            if (m_done.empty()) signal = m_signal;
+            m_done.push_back(Completion{std::move(t.done), std::move(t.token)});
+        }
+        if (signal) signal();
+    }
+
+    bool HasRunnable() const {
+        return m_pending[PRIORITY_INTERACTIVE].load() > 0 ||
+               (m_pending[PRIORITY_BULK].load() > 0 && m_bulkRunning.load() < m_bulkLimit);
+    }
+
+    void WorkerLoop(int self) {
+        TlsIndex() = self;
+        TlsOwner() = this;
+        Task t;
+        for (;;) {
+            if (Take(self, PRIORITY_INTERACTIVE, t)) {
+                Run(t);
+                t = Task();
+                continue;
+            }
+            // 退出时不再限制批量名额，尽快做完剩下的
+            bool slot = AcquireBulk();
+            if (slot || m_stop.load()) {
+                bool got = Take(self, PRIORITY_BULK, t);
+                if (got) Run(t);
+                t = Task();
+                if (slot) ReleaseBulk();
+                if (got) continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_sleepMu);
+            m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+            m_wake.wait(lock, [this] { return m_stop.load() || HasRunnable(); });
+            m_sleepers.fetch_sub(1, std::memory_order_seq_cst);
+            if (m_stop.load() && PendingTasks() == 0) break;
+        }
+        TlsIndex() = -1;
+        TlsOwner() = nullptr;
+    }
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    bool m_running = false;
+    unsigned m_bulkLimit = 1;
+
+    std::mutex m_injectMu;
+    std::deque<Task> m_inject[PRIORITY_COUNT];
+    std::atomic<int64_t> m_pending[PRIORITY_COUNT] = {};
+    std::atomic<unsigned> m_bulkRunning{0};
+
+    std::mutex m_sleepMu;
+    std::condition_variable m_wake;
+    std::atomic<int> m_sleepers{0};
+    std::atomic<bool> m_stop{false};
+
+    std::mutex m_doneMu;
+    std::vector<Completion> m_done;
+    Fn m_signal;
+
+    std::atomic<uint64_t> m_submitted{0};
+    std::atomic<uint64_t> m_executed{0};
+    std::atomic<uint64_t> m_stolen{0};
+    std::atomic<uint64_t> m_cancelled{0};
+    std::atomic<uint64_t> m_completions{0};
+    std::atomic<uint64_t> m_batches{0};
+};
+
+} // namespace relay
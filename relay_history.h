@@ -0,0 +1,115 @@
+// relay_history.h
+// 功能：中转列表的撤销/重做历史（与 Win32 无关）
+// - 每一步是整个列表的一个版本（PVector），相邻版本结构共享：追加 k 项只多出 O(k + log n) 个节点，
+//   覆盖拖入只多出新列表本身，清空几乎不占内存
+// - 条目（路径 + 大小 + 修改时间）不可变，由各版本共享；撤销后恢复列表不必重新取文件属性
+// - depth 为最多可撤销的步数，超出丢最旧的；0 = 不记录历史
+// - 撤销后再做新操作会丢弃重做分支
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "relay_pvec.h"
+
+namespace relay {
+
+enum HistoryOp { HISTORY_NONE, HISTORY_OVERWRITE, HISTORY_APPEND, HISTORY_REMOVE, HISTORY_CLEAR, HISTORY_OP_COUNT };
+
+struct ListItem {
+    std::wstring path;
+    uint64_t size = 0;
+    uint64_t mtime = 0;
+};
+
+typedef std::shared_ptr<const ListItem> ListItemRef;
+typedef PVector<ListItemRef> ListState;
+
+inline ListItemRef MakeListItem(const wchar_t* path, size_t len, uint64_t size, uint64_t mtime) {
+    std::shared_ptr<ListItem> item = std::make_shared<ListItem>();
+    item->path.assign(path, len);
+    item->size = size;
+    item->mtime = mtime;
+    return item;
+}
+
+// 删除：保留 keep[i] 为 true 的条目。第一个被删的位置之前与原版本共享，之后重新挂
+template <class Keep>
+inline ListState RemoveFromState(const ListState& from, Keep keep) {
+    size_t n = from.Size(), first = 0;
+    while (first < n && keep(first)) ++first;
+    ListState out = from;
+    if (first == n) return out;
+    out.Truncate(first);
+    for (size_t i = first + 1; i < n; ++i) {
+        if (keep(i)) out.PushBack(from[i]);
+    }
+    return out;
+}
+
+class ListHistory {
+public:
+    explicit ListHistory(size_t depth = 50) : m_depth(depth) { m_steps.push_back(Step()); }
+
+    size_t Depth() const { return m_depth; }
+    void SetDepth(size_t depth) {
+        m_depth = depth;
+        Trim();
+    }
+
+    const ListState& Current() const { return m_steps[m_cur].state; }
+    size_t UndoCount() const { return m_cur; }
+    size_t RedoCount() const { return m_steps.size() - 1 - m_cur; }
+
+    void Push(HistoryOp op, ListState next) {
+        m_steps.erase(m_steps.begin() + (ptrdiff_t)(m_cur + 1), m_steps.end());
+        Step s;
+        s.op = op;
+        s.state = std::move(next);
+        m_steps.push_back(std::move(s));
+        m_cur = m_steps.size() - 1;
+        Trim();
+    }
+
+    // 返回被撤销/重做的那一步；无可撤销/重做时返回 HISTORY_NONE
+    HistoryOp Undo() {
+        if (m_cur == 0) return HISTORY_NONE;
+        return m_steps[m_cur--].op;
+    }
+    HistoryOp Redo() {
+        if (RedoCount() == 0) return HISTORY_NONE;
+        return m_steps[++m_cur].op;
+    }
+
+    // 各版本的节点去重后的占用由调用方统计（ForEachState + PVector::ForEachNode）
+    template <class F>
+    void ForEachState(F f) const {
+        for (const Step& s : m_steps) f(s.state);
+    }
+
+private:
+    struct Step {
+        HistoryOp op = HISTORY_NONE;
+        ListState state;
+    };
+
+    void Trim() {
+        while (m_steps.size() > m_depth + 1 && m_cur > 0) {
+            m_steps.pop_front();
+            --m_cur;
+        }
+        // depth 变小时当前步之后的重做分支也可能超出
+        while (m_steps.size() > m_depth + 1) m_steps.pop_back();
+    }
+
+    std::deque<Step> m_steps;
+    size_t m_cur = 0;
+    size_t m_depth;
+};
+
+} // namespace relay
@@ -0,0 +1,387 @@
+// relay_http.h
+// 功能：内置 HTTP 共享的协议部分（与 Win32、套接字无关）
+// - 请求头解析（只收 GET/HEAD，不收请求体）、Range 解析（单段；多段按不支持处理，回整个文件）
+// - 地址：/<token>/ 为索引页，/<token>/f/<下标>/<文件名> 为下载；token 每次开启共享时随机生成
+// - 响应头、HTTP 日期、ETag、Content-Disposition（RFC 5987 的 UTF-8 文件名）、索引页 HTML
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+namespace relay {
+
+struct HttpRequest {
+    std::string method;
+    std::string target;
+    std::string range;
+    std::string ifRange;
+    bool keepAlive = true;
+    bool hasBody = false;
+};
+
+enum HttpParseResult { HTTP_NEED_MORE, HTTP_DONE, HTTP_BAD, HTTP_TOO_LARGE };
+
+enum RangeResult { RANGE_NONE, RANGE_OK, RANGE_UNSATISFIABLE };
+
+enum HttpRoute { ROUTE_NOT_FOUND, ROUTE_INDEX, ROUTE_FILE };
+
+inline char LowerAscii(char c) { return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c; }
+
+inline bool EqualsNoCase(const char* a, size_t an, const char* b) {
+    size_t bn = strlen(b);
+    if (an != bn) return false;
+    for (size_t i = 0; i < an; ++i) {
+        if (LowerAscii(a[i]) != LowerAscii(b[i])) return false;
+    }
+    return true;
+}
+
+// 值里是否含有某个逗号分隔的 token（Connection: keep-alive, Upgrade）
+inline bool HeaderHasToken(const std::string& v, const char* token) {
+    size_t i = 0;
+    while (i < v.size()) {
+        while (i < v.size() && (v[i] == ' ' || v[i] == '\t' || v[i] == ',')) ++i;
+        size_t s = i;
+        while (i < v.size() && v[i] != ',') ++i;
+        size_t e = i;
+        while (e > s && (v[e - 1] == ' ' || v[e - 1] == '\t')) --e;
+        if (EqualsNoCase(v.data() + s, e - s, token)) return true;
+    }
+    return false;
+}
+
+// buf[0..n) 里凑齐一个请求头就解析；consumed = 请求头字节数（含空行）
+inline HttpParseResult ParseHttpRequest(const char* buf, size_t n, HttpRequest& req, size_t& consumed,
+                                        size_t maxHead = 8192) {
+    // 头结束：CRLFCRLF，也容忍裸 LF
+    size_t end = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (buf[i] != '\n') continue;
+        if (i + 1 < n && buf[i + 1] == '\n') { end = i + 2; break; }
+        if (i + 2 < n && buf[i + 1] == '\r' && buf[i + 2] == '\n') { end = i + 3; break; }
+    }
+    if (!end) return n > maxHead ? HTTP_TOO_LARGE : HTTP_NEED_MORE;
+    if (end > maxHead) return HTTP_TOO_LARGE;
+    consumed = end;
+
+    req = HttpRequest();
+    size_t p = 0;
+    // 请求行前的空行按 RFC 7230 忽略
+    while (p < end && (buf[p] == '\r' || buf[p] == '\n')) ++p;
+
+    auto lineEnd = [&](size_t from) {
+        size_t e = from;
+        while (e < end && buf[e] != '\n') ++e;
+        return e;
+    };
+
+    size_t le = lineEnd(p);
+    size_t lineStop = (le > p && buf[le - 1] == '\r') ? le - 1 : le;
+    const char* line = buf + p;
+    size_t len = lineStop - p;
+    const char* sp1 = (const char*)memchr(line, ' ', len);
+    if (!sp1) return HTTP_BAD;
+    const char* sp2 = (const char*)memchr(sp1 + 1, ' ', (size_t)(line + len - sp1 - 1));
+    if (!sp2 || sp1 == line || sp2 == sp1 + 1) return HTTP_BAD;
+    req.method.assign(line, sp1);
+    req.target.assign(sp1 + 1, sp2);
+    std::string version(sp2 + 1, line + len);
+    if (version == "HTTP/1.1") req.keepAlive = true;
+    else if (version == "HTTP/1.0") req.keepAlive = false;
+    else return HTTP_BAD;
+
+    std::string connection;
+    p = le + 1;
+    while (p < end) {
+        le = lineEnd(p);
+        lineStop = (le > p && buf[le - 1] == '\r') ? le - 1 : le;
+        if (lineStop == p) break;
+        const char* h = buf + p;
+        size_t hl = lineStop - p;
+        const char* colon = (const char*)memchr(h, ':', hl);
+        if (!colon || colon == h) return HTTP_BAD;
+        size_t nameLen = (size_t)(colon - h);
+        const char* v = colon + 1;
+        const char* ve = h + hl;
+        while (v < ve && (*v == ' ' || *v == '\t')) ++v;
+        while (ve > v && (ve[-1] == ' ' || ve[-1] == '\t')) --ve;
+
+        if (EqualsNoCase(h, nameLen, "range")) req.range.assign(v, ve);
+        else if (EqualsNoCase(h, nameLen, "if-range")) req.ifRange.assign(v, ve);
+        else if (EqualsNoCase(h, nameLen, "connection")) connection.assign(v, ve);
+        else if (EqualsNoCase(h, nameLen, "transfer-encoding")) req.hasBody = true;
+        else if (EqualsNoCase(h, nameLen, "content-length")) req.hasBody = !(ve - v == 1 && *v == '0');
+        p = le + 1;
+    }
+
+    if (HeaderHasToken(connection, "close")) req.keepAlive = false;
+    else if (HeaderHasToken(connection, "keep-alive")) req.keepAlive = true;
+    return HTTP_DONE;
+}
+
+inline bool ParseU64(const char* s, const char* e, uint64_t& out) {
+    if (s == e) return false;
+    uint64_t v = 0;
+    for (; s < e; ++s) {
+        if (*s < '0' || *s > '9') return false;
+        uint64_t d = (uint64_t)(*s - '0');
+        if (v > (UINT64_MAX - d) / 10) return false;
+        v = v * 10 + d;
+    }
+    out = v;
+    return true;
+}
+
+// Range: bytes=a-b / bytes=a- / bytes=-n；结果为闭区间 [first, last]
+inline RangeResult ParseRange(const std::string& v, uint64_t size, uint64_t& first, uint64_t& last) {
+    const char* s = v.c_str();
+    const char* e = s + v.size();
+    while (s < e && (*s == ' ' || *s == '\t')) ++s;
+    if (e - s < 6 || !EqualsNoCase(s, 6, "bytes=")) return RANGE_NONE;
+    s += 6;
+    while (e > s && (e[-1] == ' ' || e[-1] == '\t')) --e;
+    if (memchr(s, ',', (size_t)(e - s))) return RANGE_NONE;
+    const char* dash = (const char*)memchr(s, '-', (size_t)(e - s));
+    if (!dash) return RANGE_NONE;
+
+    uint64_t a = 0, b = 0;
+    if (dash == s) {
+        if (!ParseU64(dash + 1, e, b)) return RANGE_NONE;
+        if (b == 0 || size == 0) return RANGE_UNSATISFIABLE;
+        first = b >= size ? 0 : size - b;
+        last = size - 1;
+        return RANGE_OK;
+    }
+    if (!ParseU64(s, dash, a)) return RANGE_NONE;
+    if (dash + 1 == e) {
+        b = UINT64_MAX;
+    } else {
+        if (!ParseU64(dash + 1, e, b)) return RANGE_NONE;
+        if (b < a) return RANGE_NONE;
+    }
+    if (a >= size) return RANGE_UNSATISFIABLE;
+    first = a;
+    last = b >= size ? size - 1 : b;
+    return RANGE_OK;
+}
+
+// ---------------- encoding ----------------
+inline int HexVal(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    c = LowerAscii(c);
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return -1;
+}
+
+// 百分号编码：只保留 RFC 3986 的非保留字符
+inline void AppendPercentEncoded(const std::string& s, std::string& out) {
+    static const char HEX[] = "0123456789ABCDEF";
+    for (unsigned char c : s) {
+        bool keep = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ||
+                    c == '-' || c == '.' || c == '_' || c == '~';
+        if (keep) {
+            out.push_back((char)c);
+        } else {
+            out.push_back('%');
+            out.push_back(HEX[c >> 4]);
+            out.push_back(HEX[c & 15]);
+        }
+    }
+}
+
+inline void AppendHtmlEscaped(const std::string& s, std::string& out) {
+    for (char c : s) {
+        switch (c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        case '\'': out += "&#39;"; break;
+        default: out.push_back(c); break;
+        }
+    }
+}
+
+inline std::string HexToken(const uint8_t* bytes, size_t n) {
+    static const char HEX[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < n; ++i) {
+        out.push_back(HEX[bytes[i] >> 4]);
+        out.push_back(HEX[bytes[i] & 15]);
+    }
+    return out;
+}
+
+// 比较耗时与内容无关，避免按响应时间逐字猜 token
+inline bool TokenEquals(const char* a, size_t an, const std::string& b) {
+    if (an != b.size()) return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < an; ++i) diff |= (unsigned char)(a[i] ^ b[i]);
+    return diff == 0;
+}
+
+// /<token>/ 或 /<token>/f/<下标>/<任意文件名>；查询串忽略
+inline HttpRoute RouteTarget(const std::string& target, const std::string& token, uint32_t& index) {
+    size_t end = target.find_first_of("?#");
+    if (end == std::string::npos) end = target.size();
+    if (end == 0 || target[0] != '/') return ROUTE_NOT_FOUND;
+
+    size_t s = 1;
+    size_t slash = target.find('/', s);
+    if (slash == std::string::npos || slash > end) slash = end;
+    if (token.empty() || !TokenEquals(target.data() + s, slash - s, token)) return ROUTE_NOT_FOUND;
+    if (slash + 1 >= end) return ROUTE_INDEX;
+
+    s = slash + 1;
+    if (end - s < 2 || target[s] != 'f' || target[s + 1] != '/') return ROUTE_NOT_FOUND;
+    s += 2;
+    slash = target.find('/', s);
+    if (slash == std::string::npos || slash > end) slash = end;
+    uint64_t v = 0;
+    if (!ParseU64(target.data() + s, target.data() + slash, v) || v > UINT32_MAX) return ROUTE_NOT_FOUND;
+    index = (uint32_t)v;
+    return ROUTE_FILE;
+}
+
+// ---------------- response ----------------
+// RFC 7231 IMF-fixdate；unixSec 为 1970 起的秒数
+inline std::string HttpDate(uint64_t unixSec) {
+    static const char* const DAYS[] = {"Thu", "Fri", "Sat", "Sun", "Mon", "Tue", "Wed"};
+    static const char* const MONTHS[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                         "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    uint64_t days = unixSec / 86400, rem = unixSec % 86400;
+    // civil_from_days（H. Hinnant）
+    int64_t z = (int64_t)days + 719468;
+    int64_t era = z / 146097;
+    uint64_t doe = (uint64_t)(z - era * 146097);
+    uint64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t y = (int64_t)yoe + era * 400;
+    uint64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint64_t mp = (5 * doy + 2) / 153;
+    unsigned d = (unsigned)(doy - (153 * mp + 2) / 5 + 1);
+    unsigned m = (unsigned)(mp < 10 ? mp + 3 : mp - 9);
+    if (m <= 2) ++y;
+
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%s, %02u %s %04lld %02u:%02u:%02u GMT", DAYS[days % 7], d, MONTHS[m - 1],
+             (long long)y, (unsigned)(rem / 3600), (unsigned)(rem / 60 % 60), (unsigned)(rem % 60));
+    return buf;
+}
+
+inline std::string HttpETag(uint64_t size, uint64_t mtime) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "\"%llx-%llx\"", (unsigned long long)size, (unsigned long long)mtime);
+    return buf;
+}
+
+inline void AppendStatusLine(std::string& out, int status) {
+    const char* reason = "OK";
+    switch (status) {
+    case 206: reason = "Partial Content"; break;
+    case 400: reason = "Bad Request"; break;
+    case 404: reason = "Not Found"; break;
+    case 405: reason = "Method Not Allowed"; break;
+    case 416: reason = "Range Not Satisfiable"; break;
+    case 431: reason = "Request Header Fields Too Large"; break;
+    case 503: reason = "Service Unavailable"; break;
+    }
+    char buf[64];
+    snprintf(buf, sizeof(buf), "HTTP/1.1 %d %s\r\n", status, reason);
+    out += buf;
+}
+
+inline void AppendHeader(std::string& out, const char* name, const std::string& value) {
+    out += name;
+    out += ": ";
+    out += value;
+    out += "\r\n";
+}
+
+inline void AppendHeaderU64(std::string& out, const char* name, uint64_t value) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%llu", (unsigned long long)value);
+    AppendHeader(out, name, buf);
+}
+
+// 简单的错误响应（正文是一行文本）
+inline void BuildErrorResponse(std::string& out, int status, bool keepAlive, bool headOnly) {
+    std::string body;
+    AppendStatusLine(body, status);
+    body.erase(0, 9);   // "HTTP/1.1 "
+    out.clear();
+    AppendStatusLine(out, status);
+    AppendHeader(out, "Content-Type", "text/plain; charset=utf-8");
+    AppendHeaderU64(out, "Content-Length", body.size());
+    if (status == 405) AppendHeader(out, "Allow", "GET, HEAD");
+    AppendHeader(out, "Connection", keepAlive ? "keep-alive" : "close");
+    out += "\r\n";
+    if (!headOnly) out += body;
+}
+
+// attachment; filename="ascii"; filename*=UTF-8''pct
+inline std::string ContentDisposition(const std::string& utf8Name) {
+    std::string ascii;
+    for (char c : utf8Name) {
+        unsigned char u = (unsigned char)c;
+        ascii.push_back((u < 0x20 || u >= 0x7F || c == '"' || c == '\\') ? '_' : c);
+    }
+    std::string out = "attachment; filename=\"" + ascii + "\"; filename*=UTF-8''";
+    AppendPercentEncoded(utf8Name, out);
+    return out;
+}
+
+struct HttpListing {
+    std::string name;   // UTF-8
+    uint64_t size;
+    bool isDir;
+};
+
+inline void AppendSize(std::string& out, uint64_t size) {
+    static const char* const UNITS[] = {"B", "KB", "MB", "GB", "TB"};
+    double v = (double)size;
+    int u = 0;
+    while (v >= 1024 && u < 4) { v /= 1024; ++u; }
+    char buf[32];
+    if (u == 0) snprintf(buf, sizeof(buf), "%llu B", (unsigned long long)size);
+    else snprintf(buf, sizeof(buf), "%.1f %s", v, UNITS[u]);
+    out += buf;
+}
+
+inline void BuildIndexHtml(const HttpListing* items, size_t n, const std::string& token, std::string& out) {
+    out.clear();
+    out += "<!doctype html><html><head><meta charset=\"utf-8\">"
+           "<meta name=\"viewport\" content=\"width=device-width,initial-scale=1\">"
+           "<title>TransFile</title><style>"
+           "body{font:14px 'Segoe UI',sans-serif;margin:24px;color:#333}"
+           "table{border-collapse:collapse}td{padding:4px 12px 4px 0}td.s{text-align:right;color:#888}"
+           "a{color:#0366d6;text-decoration:none}"
+           "</style></head><body>";
+    char head[64];
+    snprintf(head, sizeof(head), "<h3>%zu 个文件</h3><table>", n);
+    out += head;
+    for (size_t i = 0; i < n; ++i) {
+        out += "<tr><td>";
+        if (items[i].isDir) {
+            AppendHtmlEscaped(items[i].name, out);
+            out += "/</td><td class=\"s\">文件夹</td></tr>";
+            continue;
+        }
+        char idx[24];
+        snprintf(idx, sizeof(idx), "%zu", i);
+        out += "<a href=\"/" + token + "/f/" + idx + "/";
+        AppendPercentEncoded(items[i].name, out);
+        out += "\">";
+        AppendHtmlEscaped(items[i].name, out);
+        out += "</a></td><td class=\"s\">";
+        AppendSize(out, items[i].size);
+        out += "</td></tr>";
+    }
+    out += "</table></body></html>";
+}
+
+} // namespace relay
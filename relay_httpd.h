@@ -0,0 +1,747 @@
+// relay_httpd.h
+// 功能：内置 HTTP 共享的服务端（Winsock / POSIX 套接字，main.cpp 与 bench/bench.cpp 共用）
+// - 单线程事件循环：非阻塞套接字 + poll/WSAPoll，一个线程同时服务大量连接；keep-alive、流水线请求
+// - 文件正文零拷贝：Linux 用 sendfile，Windows 用重叠 TransmitFile（进行中的连接不参与 poll；
+//   完成事件交给线程池等待，回调往唤醒套接字发一个字节叫醒循环）；不支持时退回 read + send
+// - 列表以快照形式发布（Publish），与界面线程只共享一个 shared_ptr
+// - 每次 Start 生成新的 128 位随机 token，不带 token 的地址一律 404
+// 编译：Windows 需 -lws2_32 -lmswsock -lbcrypt；Linux 需 -pthread
+
+#pragma once
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mswsock.h>
+#include <windows.h>
+#include <bcrypt.h>
+#else
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "relay_http.h"
+
+namespace relay {
+
+#ifdef _WIN32
+typedef SOCKET HttpSocket;
+typedef std::wstring HttpPath;
+static const HttpSocket HTTP_BAD_SOCKET = INVALID_SOCKET;
+#else
+typedef int HttpSocket;
+typedef std::string HttpPath;
+static const HttpSocket HTTP_BAD_SOCKET = -1;
+#endif
+
+struct HttpFile {
+    HttpPath path;
+    std::string name;       // UTF-8，显示与下载文件名
+    uint64_t size = 0;
+    uint64_t mtime = 0;     // unix 秒
+    bool isDir = false;
+};
+
+// 某一时刻的列表（按显示顺序）；发布后只读
+struct HttpShare {
+    std::vector<HttpFile> files;
+    uint64_t version = 0;   // 后台发布可能乱序到达：旧版本不覆盖新版本
+};
+
+struct HttpStats {
+    uint64_t accepted = 0;
+    uint64_t requests = 0;
+    uint64_t bytesSent = 0;
+    uint32_t active = 0;
+};
+
+inline bool SecureRandom(uint8_t* out, size_t n) {
+#ifdef _WIN32
+    return BCryptGenRandom(NULL, out, (ULONG)n, BCRYPT_USE_SYSTEM_PREFERRED_RNG) == 0;
+#else
+    int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    size_t got = 0;
+    while (got < n) {
+        ssize_t k = read(fd, out + got, n - got);
+        if (k <= 0) break;
+        got += (size_t)k;
+    }
+    close(fd);
+    return got == n;
+#endif
+}
+
+// 本机对外的 IPv4 地址（UDP connect 只选路由，不发包）；失败返回空串
+inline std::string PrimaryLanAddress() {
+    HttpSocket s = socket(AF_INET, SOCK_DGRAM, 0);
+    if (s == HTTP_BAD_SOCKET) return std::string();
+    sockaddr_in to{};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(53);
+    inet_pton(AF_INET, "10.255.255.255", &to.sin_addr);
+    std::string out;
+    if (connect(s, (sockaddr*)&to, sizeof(to)) == 0) {
+        sockaddr_in me{};
+        socklen_t len = sizeof(me);
+        char buf[INET_ADDRSTRLEN] = {0};
+        if (getsockname(s, (sockaddr*)&me, &len) == 0 && inet_ntop(AF_INET, &me.sin_addr, buf, sizeof(buf))) out = buf;
+    }
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
+    return out;
+}
+
+struct HttpServerOptions {
+    bool zeroCopy = true;       // false：始终 read + send（对比测试用）
+    int maxConns = 1024;
+    int idleTimeoutMs = 30000;
+};
+
+class HttpServer {
+public:
+    typedef HttpServerOptions Options;
+
+    HttpServer() {}
+    ~HttpServer() { Stop(); }
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    // bindAddr：127.0.0.1 仅本机，0.0.0.0 局域网；port 为 0 时由系统分配
+    bool Start(const char* bindAddr, uint16_t port, const Options& opt = Options()) {
+        if (m_thread.joinable()) return true;
+#ifdef _WIN32
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return false;
+#else
+        // 对端提前断开时 send/sendfile 不要触发 SIGPIPE
+        signal(SIGPIPE, SIG_IGN);
+#endif
+        m_opt = opt;
+        uint8_t raw[16];
+        if (!SecureRandom(raw, sizeof(raw))) { Cleanup(); return false; }
+        m_token = HexToken(raw, sizeof(raw));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (inet_pton(AF_INET, bindAddr, &addr.sin_addr) != 1) { Cleanup(); return false; }
+
+        m_listen = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (m_listen == HTTP_BAD_SOCKET) { Cleanup(); return false; }
+        int one = 1;
+#ifdef _WIN32
+        setsockopt(m_listen, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char*)&one, sizeof(one));
+#else
+        setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#endif
+        if (bind(m_listen, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_listen, 512) != 0) {
+            Cleanup();
+            return false;
+        }
+        sockaddr_in bound{};
+        socklen_t len = sizeof(bound);
+        getsockname(m_listen, (sockaddr*)&bound, &len);
+        m_port = ntohs(bound.sin_port);
+        SetNonBlocking(m_listen);
+
+        // 唤醒用的回环 UDP 套接字：Stop 往自己发一个字节
+        m_wake = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in wa{};
+        wa.sin_family = AF_INET;
+        inet_pton(AF_INET, "127.0.0.1", &wa.sin_addr);
+        if (m_wake == HTTP_BAD_SOCKET || bind(m_wake, (sockaddr*)&wa, sizeof(wa)) != 0) { Cleanup(); return false; }
+        len = sizeof(m_wakeAddr);
+        getsockname(m_wake, (sockaddr*)&m_wakeAddr, &len);
+        SetNonBlocking(m_wake);
+
+        m_stop = false;
+        m_thread = std::thread([this] { Loop(); });
+        return true;
+    }
+
+    void Stop() {
+        if (!m_thread.joinable()) return;
+        m_stop = true;
+        char b = 1;
+        sendto(m_wake, &b, 1, 0, (sockaddr*)&m_wakeAddr, sizeof(m_wakeAddr));
+        m_thread.join();
+        Cleanup();
+        // 关闭后列表可能已经变了：再次 Start 时等新快照发布前一律 404，不拿旧快照服务
+        std::lock_guard<std::mutex> lock(m_shareMu);
+        m_share.reset();
+    }
+
+    bool Running() const { return m_thread.joinable(); }
+    uint16_t Port() const { return m_port; }
+    const std::string& Token() const { return m_token; }
+
+    void Publish(std::shared_ptr<const HttpShare> share) {
+        std::lock_guard<std::mutex> lock(m_shareMu);
+        if (share) {
+            // Stop 清掉快照后版本下限仍保留，关闭前发出、之后才到的旧快照照样丢弃
+            if (share->version < m_shareVersion) return;
+            m_shareVersion = share->version;
+        }
+        m_share = std::move(share);
+    }
+
+    HttpStats Stats() const {
+        HttpStats s;
+        s.accepted = m_accepted.load();
+        s.requests = m_requests.load();
+        s.bytesSent = m_bytesSent.load();
+        s.active = m_active.load();
+        return s;
+    }
+
+private:
+#ifdef _WIN32
+    typedef HANDLE FileHandle;
+    static FileHandle BadFile() { return INVALID_HANDLE_VALUE; }
+#else
+    typedef int FileHandle;
+    static FileHandle BadFile() { return -1; }
+#endif
+
+    enum ConnState { C_READ, C_WRITE };
+
+    struct Conn {
+        HttpSocket s = HTTP_BAD_SOCKET;
+        ConnState state = C_READ;
+        std::string in;
+        std::string out;            // 响应头 / 小正文 / 拷贝模式下的文件块
+        size_t outPos = 0;
+        FileHandle file = BadFile();
+        uint64_t fileOff = 0;
+        uint64_t fileLeft = 0;
+        bool copyMode = false;
+        bool keepAlive = true;
+        bool dead = false;
+        int64_t lastMs = 0;
+#ifdef _WIN32
+        OVERLAPPED ov;
+        bool pending = false;       // TransmitFile 进行中
+        DWORD pendingBytes = 0;
+        HANDLE done = NULL;         // ov.hEvent，连接关闭时释放
+        HANDLE wait = NULL;         // done 上的线程池等待
+#endif
+    };
+
+    static int64_t NowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // ---- platform ----
+    static void SetNonBlocking(HttpSocket s) {
+#ifdef _WIN32
+        u_long on = 1;
+        ioctlsocket(s, FIONBIO, &on);
+#else
+        fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+        fcntl(s, F_SETFD, FD_CLOEXEC);
+#endif
+    }
+    static void CloseSocket(HttpSocket s) {
+#ifdef _WIN32
+        closesocket(s);
+#else
+        close(s);
+#endif
+    }
+    static bool WouldBlock() {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+    }
+    static void CloseFile(FileHandle& f) {
+        if (f == BadFile()) return;
+#ifdef _WIN32
+        CloseHandle(f);
+#else
+        close(f);
+#endif
+        f = BadFile();
+    }
+    static FileHandle OpenFile(const HttpPath& path, uint64_t& size, uint64_t& mtime) {
+#ifdef _WIN32
+        HANDLE h = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                               NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (h == INVALID_HANDLE_VALUE) return h;
+        LARGE_INTEGER sz;
+        FILETIME ft;
+        if (!GetFileSizeEx(h, &sz) || !GetFileTime(h, NULL, NULL, &ft)) { CloseHandle(h); return INVALID_HANDLE_VALUE; }
+        size = (uint64_t)sz.QuadPart;
+        uint64_t t = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+        mtime = t > 116444736000000000ull ? (t - 116444736000000000ull) / 10000000ull : 0;
+        return h;
+#else
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return fd;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) { close(fd); return -1; }
+        size = (uint64_t)st.st_size;
+        mtime = (uint64_t)st.st_mtime;
+        return fd;
+#endif
+    }
+    // 拷贝模式：从 off 读最多 n 字节
+    static size_t ReadAt(FileHandle f, uint64_t off, char* dst, size_t n) {
+#ifdef _WIN32
+        OVERLAPPED ov{};
+        ov.Offset = (DWORD)off;
+        ov.OffsetHigh = (DWORD)(off >> 32);
+        DWORD got = 0;
+        if (!ReadFile(f, dst, (DWORD)n, &got, &ov)) return 0;
+        return got;
+#else
+        ssize_t k = pread(f, dst, n, (off_t)off);
+        return k > 0 ? (size_t)k : 0;
+#endif
+    }
+    static int PollFds(std::vector<pollfd>& fds, int timeoutMs) {
+#ifdef _WIN32
+        return WSAPoll(fds.data(), (ULONG)fds.size(), timeoutMs);
+#else
+        return poll(fds.data(), (nfds_t)fds.size(), timeoutMs);
+#endif
+    }
+
+    void Cleanup() {
+        if (m_listen != HTTP_BAD_SOCKET) { CloseSocket(m_listen); m_listen = HTTP_BAD_SOCKET; }
+        if (m_wake != HTTP_BAD_SOCKET) { CloseSocket(m_wake); m_wake = HTTP_BAD_SOCKET; }
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    // ---- loop ----
+    void Loop() {
+        std::vector<std::unique_ptr<Conn>> conns;
+        std::vector<pollfd> fds;
+        std::vector<Conn*> polled;
+        char drain[64];
+
+        while (!m_stop) {
+            fds.clear();
+            polled.clear();
+            fds.push_back(pollfd{m_wake, POLLIN, 0});
+            bool acceptOpen = (int)conns.size() < m_opt.maxConns;
+            fds.push_back(pollfd{m_listen, (short)(acceptOpen ? POLLIN : 0), 0});
+            for (auto& c : conns) {
+#ifdef _WIN32
+                if (c->pending) continue;
+#endif
+                fds.push_back(pollfd{c->s, (short)(c->state == C_READ ? POLLIN : POLLOUT), 0});
+                polled.push_back(c.get());
+            }
+
+            int timeout = conns.empty() ? -1 : 1000;
+            int r = PollFds(fds, timeout);
+            if (m_stop) break;
+            if (r < 0) {
+#ifndef _WIN32
+                if (errno == EINTR) continue;
+#endif
+                break;
+            }
+
+            if (fds[0].revents) {
+                while (recv(m_wake, drain, sizeof(drain), 0) > 0) {}
+            }
+            if (fds[1].revents & POLLIN) Accept(conns);
+
+            for (size_t i = 0; i < polled.size(); ++i) {
+                short ev = fds[i + 2].revents;
+                if (!ev) continue;
+                Conn& c = *polled[i];
+                if (c.state == C_READ) OnReadable(c);
+                else if (ev & (POLLERR | POLLNVAL)) c.dead = true;
+                else Serve(c);
+            }
+#ifdef _WIN32
+            // TransmitFile 完成时回调发的唤醒字节已经在上面读掉；这里只做不阻塞的查询
+            for (auto& c : conns) {
+                if (c->pending) CheckTransmit(*c);
+            }
+#endif
+
+            // 回收断开的、超时的连接
+            int64_t now = NowMs();
+            for (size_t i = 0; i < conns.size();) {
+                Conn& c = *conns[i];
+                bool idle = m_opt.idleTimeoutMs > 0 && now - c.lastMs > m_opt.idleTimeoutMs;
+#ifdef _WIN32
+                if (c.pending) idle = false;
+#endif
+                if (c.dead || idle) {
+                    Release(c);
+                    conns[i] = std::move(conns.back());
+                    conns.pop_back();
+                    m_active = (uint32_t)conns.size();
+                } else {
+                    ++i;
+                }
+            }
+        }
+
+        for (auto& c : conns) Release(*c);
+        m_active = 0;
+    }
+
+    void Accept(std::vector<std::unique_ptr<Conn>>& conns) {
+        while ((int)conns.size() < m_opt.maxConns) {
+            HttpSocket s = accept(m_listen, NULL, NULL);
+            if (s == HTTP_BAD_SOCKET) break;
+            SetNonBlocking(s);
+            int one = 1;
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+            std::unique_ptr<Conn> c(new Conn());
+            c->s = s;
+            c->lastMs = NowMs();
+            conns.push_back(std::move(c));
+            m_accepted++;
+        }
+        m_active = (uint32_t)conns.size();
+    }
+
+    void Release(Conn& c) {
+#ifdef _WIN32
+        if (c.pending) {
+            // 重叠操作完成前 OVERLAPPED 不能释放
+            CancelIoEx((HANDLE)c.s, &c.ov);
+            DWORD bytes = 0, flags = 0;
+            WSAGetOverlappedResult(c.s, &c.ov, &bytes, TRUE, &flags);
+            c.pending = false;
+        }
+        EndTransmitWait(c);
+        if (c.done) { CloseHandle(c.done); c.done = NULL; }
+#endif
+        CloseFile(c.file);
+        if (c.s != HTTP_BAD_SOCKET) { CloseSocket(c.s); c.s = HTTP_BAD_SOCKET; }
+    }
+
+    void OnReadable(Conn& c) {
+        char buf[16384];
+        int n = (int)recv(c.s, buf, sizeof(buf), 0);
+        if (n == 0) { c.dead = true; return; }
+        if (n < 0) { if (!WouldBlock()) c.dead = true; return; }
+        c.lastMs = NowMs();
+        c.in.append(buf, (size_t)n);
+        Serve(c);
+    }
+
+    // 发当前响应，发完再取缓冲里的下一个请求。流水线的多个请求在这里循环处理，
+    // 不经由 FinishResponse -> TryRequest 递归（一次 recv 就可能带上千个请求）
+    void Serve(Conn& c) {
+        for (;;) {
+            if (c.state == C_READ && !TryRequest(c)) return;
+            if (!OnWritable(c)) return;
+        }
+    }
+
+    // 缓冲里有完整请求就生成响应并切到 C_WRITE；请求还不完整时返回 false
+    bool TryRequest(Conn& c) {
+        HttpRequest req;
+        size_t used = 0;
+        HttpParseResult r = ParseHttpRequest(c.in.data(), c.in.size(), req, used);
+        if (r == HTTP_NEED_MORE) return false;
+        if (r != HTTP_DONE) {
+            BuildErrorResponse(c.out, r == HTTP_TOO_LARGE ? 431 : 400, false, false);
+            c.keepAlive = false;
+            c.in.clear();
+        } else {
+            c.in.erase(0, used);
+            m_requests++;
+            Respond(c, req);
+        }
+        c.outPos = 0;
+        c.state = C_WRITE;
+        return true;
+    }
+
+    void Respond(Conn& c, const HttpRequest& req) {
+        bool head = req.method == "HEAD";
+        c.keepAlive = req.keepAlive;
+        if (req.hasBody) {
+            BuildErrorResponse(c.out, 400, false, head);
+            c.keepAlive = false;
+            return;
+        }
+        if (!head && req.method != "GET") {
+            BuildErrorResponse(c.out, 405, c.keepAlive, false);
+            return;
+        }
+
+        std::shared_ptr<const HttpShare> share;
+        {
+            std::lock_guard<std::mutex> lock(m_shareMu);
+            share = m_share;
+        }
+        uint32_t index = 0;
+        HttpRoute route = RouteTarget(req.target, m_token, index);
+        if (route == ROUTE_NOT_FOUND || !share) {
+            BuildErrorResponse(c.out, 404, c.keepAlive, head);
+            return;
+        }
+
+        if (route == ROUTE_INDEX) {
+            std::vector<HttpListing> items;
+            items.reserve(share->files.size());
+            for (const HttpFile& f : share->files) items.push_back(HttpListing{f.name, f.size, f.isDir});
+            std::string body;
+            BuildIndexHtml(items.data(), items.size(), m_token, body);
+            c.out.clear();
+            AppendStatusLine(c.out, 200);
+            AppendHeader(c.out, "Content-Type", "text/html; charset=utf-8");
+            AppendHeaderU64(c.out, "Content-Length", body.size());
+            AppendHeader(c.out, "Cache-Control", "no-store");
+            AppendHeader(c.out, "Connection", c.keepAlive ? "keep-alive" : "close");
+            c.out += "\r\n";
+            if (!head) c.out += body;
+            return;
+        }
+
+        if (index >= share->files.size() || share->files[index].isDir) {
+            BuildErrorResponse(c.out, 404, c.keepAlive, head);
+            return;
+        }
+        const HttpFile& f = share->files[index];
+        uint64_t size = 0, mtime = 0;
+        FileHandle fh = OpenFile(f.path, size, mtime);
+        if (fh == BadFile()) {
+            BuildErrorResponse(c.out, 404, c.keepAlive, head);
+            return;
+        }
+
+        std::string etag = HttpETag(size, mtime);
+        uint64_t first = 0, last = size ? size - 1 : 0;
+        RangeResult rr = RANGE_NONE;
+        if (!req.range.empty() && (req.ifRange.empty() || req.ifRange == etag)) {
+            rr = ParseRange(req.range, size, first, last);
+        }
+
+        c.out.clear();
+        if (rr == RANGE_UNSATISFIABLE) {
+            CloseFile(fh);
+            AppendStatusLine(c.out, 416);
+            char cr[48];
+            snprintf(cr, sizeof(cr), "bytes */%llu", (unsigned long long)size);
+            AppendHeader(c.out, "Content-Range", cr);
+            AppendHeaderU64(c.out, "Content-Length", 0);
+            AppendHeader(c.out, "Connection", c.keepAlive ? "keep-alive" : "close");
+            c.out += "\r\n";
+            return;
+        }
+
+        uint64_t length = size == 0 ? 0 : last - first + 1;
+        AppendStatusLine(c.out, rr == RANGE_OK ? 206 : 200);
+        AppendHeader(c.out, "Content-Type", "application/octet-stream");
+        AppendHeaderU64(c.out, "Content-Length", length);
+        if (rr == RANGE_OK) {
+            char cr[80];
+            snprintf(cr, sizeof(cr), "bytes %llu-%llu/%llu", (unsigned long long)first,
+                     (unsigned long long)last, (unsigned long long)size);
+            AppendHeader(c.out, "Content-Range", cr);
+        }
+        AppendHeader(c.out, "Accept-Ranges", "bytes");
+        AppendHeader(c.out, "ETag", etag);
+        AppendHeader(c.out, "Last-Modified", HttpDate(mtime));
+        AppendHeader(c.out, "Content-Disposition", ContentDisposition(f.name));
+        AppendHeader(c.out, "Connection", c.keepAlive ? "keep-alive" : "close");
+        c.out += "\r\n";
+
+        if (head || length == 0) {
+            CloseFile(fh);
+            return;
+        }
+        c.file = fh;
+        c.fileOff = first;
+        c.fileLeft = length;
+        c.copyMode = !m_opt.zeroCopy;
+    }
+
+    // 每次可写事件最多发这么多，避免一个大下载饿死其他连接
+    static const size_t WRITE_BUDGET = 4u << 20;
+    static const size_t COPY_CHUNK = 64u << 10;
+
+    // 响应整个发完且连接保持时返回 true（已切回 C_READ）；没发完、等事件或已断开返回 false
+    bool OnWritable(Conn& c) {
+        size_t budget = WRITE_BUDGET;
+        while (budget > 0) {
+            if (c.outPos < c.out.size()) {
+                int n = (int)send(c.s, c.out.data() + c.outPos, (int)(c.out.size() - c.outPos), SendFlags());
+                if (n < 0) { if (!WouldBlock()) c.dead = true; return false; }
+                c.outPos += (size_t)n;
+                m_bytesSent += (uint64_t)n;
+                budget -= std::min(budget, (size_t)n);
+                c.lastMs = NowMs();
+                continue;
+            }
+            if (c.fileLeft == 0) return FinishResponse(c);
+            if (c.copyMode) {
+                size_t want = (size_t)std::min<uint64_t>(c.fileLeft, (uint64_t)COPY_CHUNK);
+                c.out.resize(want);
+                size_t got = ReadAt(c.file, c.fileOff, &c.out[0], want);
+                if (got == 0) { c.dead = true; return false; }   // 文件被截短：长度已经承诺，只能断开
+                c.out.resize(got);
+                c.outPos = 0;
+                c.fileOff += got;
+                c.fileLeft -= got;
+                continue;
+            }
+            if (!SendFileChunk(c, budget)) return false;
+        }
+        return false;
+    }
+
+    static int SendFlags() {
+#ifdef MSG_NOSIGNAL
+        return MSG_NOSIGNAL;
+#else
+        return 0;
+#endif
+    }
+
+    // 零拷贝发送一段；返回 false 表示需要等下一次事件（或已断开）
+    bool SendFileChunk(Conn& c, size_t& budget) {
+#ifdef _WIN32
+        if (!c.done) c.done = CreateEventW(NULL, TRUE, FALSE, NULL);
+        if (!c.done) { c.copyMode = true; return true; }
+        DWORD n = (DWORD)std::min<uint64_t>(c.fileLeft, 64u << 20);
+        ZeroMemory(&c.ov, sizeof(c.ov));
+        c.ov.Offset = (DWORD)c.fileOff;
+        c.ov.OffsetHigh = (DWORD)(c.fileOff >> 32);
+        c.ov.hEvent = c.done;
+        c.pendingBytes = n;
+        if (TransmitFile(c.s, c.file, n, 0, &c.ov, NULL, 0)) {
+            c.pending = true;   // 同步完成时事件也已置位，同样由等待回调叫醒循环取结果
+        } else if (WSAGetLastError() == ERROR_IO_PENDING || WSAGetLastError() == WSA_IO_PENDING) {
+            c.pending = true;
+        } else {
+            c.copyMode = true;   // 不支持时退回拷贝
+            return true;
+        }
+        if (!RegisterWaitForSingleObject(&c.wait, c.done, TransmitDone, this, INFINITE, WT_EXECUTEONLYONCE)) {
+            // 没法等完成：取消这次发送并断开（长度已经承诺，不能改走拷贝）
+            c.wait = NULL;
+            CancelIoEx((HANDLE)c.s, &c.ov);
+            DWORD bytes = 0, flags = 0;
+            WSAGetOverlappedResult(c.s, &c.ov, &bytes, TRUE, &flags);
+            c.pending = false;
+            c.dead = true;
+        }
+        (void)budget;
+        return false;
+#else
+        off_t off = (off_t)c.fileOff;
+        size_t want = (size_t)std::min<uint64_t>(c.fileLeft, budget);
+        ssize_t n = sendfile(c.s, c.file, &off, want);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) return false;
+            if (errno == EINVAL || errno == ENOSYS) { c.copyMode = true; return true; }
+            c.dead = true;
+            return false;
+        }
+        if (n == 0) { c.dead = true; return false; }   // 文件被截短
+        c.fileOff += (uint64_t)n;
+        c.fileLeft -= (uint64_t)n;
+        m_bytesSent += (uint64_t)n;
+        budget -= std::min(budget, (size_t)n);
+        c.lastMs = NowMs();
+        return true;
+#endif
+    }
+
+#ifdef _WIN32
+    // 线程池线程上执行：只叫醒循环，结果由循环线程的 CheckTransmit 取
+    static VOID CALLBACK TransmitDone(PVOID self, BOOLEAN) {
+        HttpServer* s = (HttpServer*)self;
+        char b = 2;
+        sendto(s->m_wake, &b, 1, 0, (sockaddr*)&s->m_wakeAddr, sizeof(s->m_wakeAddr));
+    }
+
+    // 等到回调不再运行才返回：之后 Conn 和唤醒套接字都可以释放
+    static void EndTransmitWait(Conn& c) {
+        if (!c.wait) return;
+        UnregisterWaitEx(c.wait, INVALID_HANDLE_VALUE);
+        c.wait = NULL;
+    }
+
+    void CheckTransmit(Conn& c) {
+        DWORD bytes = 0, flags = 0;
+        if (!WSAGetOverlappedResult(c.s, &c.ov, &bytes, FALSE, &flags)) {
+            if (WSAGetLastError() == WSA_IO_INCOMPLETE) return;
+            EndTransmitWait(c);
+            c.pending = false;
+            c.dead = true;
+            return;
+        }
+        EndTransmitWait(c);
+        c.pending = false;
+        c.fileOff += bytes;
+        c.fileLeft -= std::min<uint64_t>(c.fileLeft, bytes);
+        m_bytesSent += bytes;
+        c.lastMs = NowMs();
+        if (bytes == 0) { c.dead = true; return; }
+        if (c.fileLeft == 0 && FinishResponse(c)) Serve(c);
+    }
+#endif
+
+    // 连接保持时切回 C_READ 并返回 true；缓冲里剩下的请求由调用方（Serve）接着处理
+    bool FinishResponse(Conn& c) {
+        CloseFile(c.file);
+        c.out.clear();
+        c.outPos = 0;
+        if (!c.keepAlive) { c.dead = true; return false; }
+        c.state = C_READ;
+        return true;
+    }
+
+    Options m_opt;
+    HttpSocket m_listen = HTTP_BAD_SOCKET;
+    HttpSocket m_wake = HTTP_BAD_SOCKET;
+    sockaddr_in m_wakeAddr{};
+    uint16_t m_port = 0;
+    std::string m_token;
+    std::thread m_thread;
+    std::atomic<bool> m_stop{false};
+
+    std::mutex m_shareMu;
+    std::shared_ptr<const HttpShare> m_share;
+    uint64_t m_shareVersion = 0;        // 发布过的最大版本
+
+    std::atomic<uint64_t> m_accepted{0};
+    std::atomic<uint64_t> m_requests{0};
+    std::atomic<uint64_t> m_bytesSent{0};
+    std::atomic<uint32_t> m_active{0};
+};
+
+} // namespace relay
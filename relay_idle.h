@@ -0,0 +1,66 @@
+// relay_idle.h
+// 功能：空闲模式的判定与压缩策略（与 Win32 无关，时间由调用方传入毫秒数）
+// - 最后一次交互后安静满 quietMs 进入空闲；任何交互立即退出空闲
+// - 进入空闲时由调用方释放 tip 资源、压缩列表、裁剪工作集；退出时按需懒重建
+// - CompactPolicy 决定列表缓冲是否值得收缩：富余太少时搬一次数据不划算
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace relay {
+
+struct CompactPolicy {
+    size_t minSlackBytes = 4096;    // 富余低于此值不收缩
+    unsigned maxSlackPercent = 25;  // 富余超过已用的这个百分比才收缩
+
+    bool ShouldCompact(size_t reservedBytes, size_t usedBytes) const {
+        if (reservedBytes <= usedBytes) return false;
+        size_t slack = reservedBytes - usedBytes;
+        if (usedBytes == 0) return slack > 0;
+        if (slack < minSlackBytes) return false;
+        return slack * 100 > usedBytes * maxSlackPercent;
+    }
+};
+
+class IdleTracker {
+public:
+    explicit IdleTracker(uint32_t quietMs = 0) : m_quietMs(quietMs) {}
+
+    void SetQuietMs(uint32_t ms) { m_quietMs = ms; }
+    uint32_t QuietMs() const { return m_quietMs; }
+    bool Enabled() const { return m_quietMs > 0; }
+    bool Idle() const { return m_idle; }
+
+    // 一次交互；返回 true 表示刚从空闲中醒来（调用方需要恢复懒释放的资源）
+    bool Touch(uint64_t nowMs) {
+        m_last = nowMs;
+        bool woke = m_idle;
+        m_idle = false;
+        return woke;
+    }
+
+    // 还要多久进入空闲（毫秒）；已空闲或未启用返回 UINT32_MAX
+    uint32_t MsUntilIdle(uint64_t nowMs) const {
+        if (!Enabled() || m_idle) return UINT32_MAX;
+        uint64_t due = m_last + m_quietMs;
+        return nowMs >= due ? 0 : (uint32_t)(due - nowMs);
+    }
+
+    // 到期时返回 true 并进入空闲；busy=true（如 tip 正在显示、正在拖拽）时推迟
+    bool Poll(uint64_t nowMs, bool busy) {
+        if (!Enabled() || m_idle) return false;
+        if (busy) { m_last = nowMs; return false; }
+        if (MsUntilIdle(nowMs) > 0) return false;
+        m_idle = true;
+        return true;
+    }
+
+private:
+    uint32_t m_quietMs;
+    uint64_t m_last = 0;
+    bool m_idle = false;
+};
+
+} // namespace relay
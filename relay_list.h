@@ -0,0 +1,87 @@
+// relay_list.h
+// 功能：中转列表的紧凑存储（与 Win32 无关）
+// - 所有路径连续存放在一块 wchar_t 缓冲里（每条以 0 结尾），条目只记偏移；文件名是路径内的偏移，不另存
+// - 没有 MAX_PATH 定长槽位，占用随实际路径长度变化
+// - Compact() 释放多余容量（空闲模式下调用）
+// 注意：Add 可能让缓冲重新分配，之前拿到的 Path()/Name() 指针随之失效
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <vector>
+
+#include "relay_sort.h"
+
+namespace relay {
+
+class PathList {
+public:
+    int Count() const { return (int)m_entries.size(); }
+
+    const wchar_t* Path(int i) const { return m_chars.data() + m_entries[i].off; }
+    const wchar_t* Name(int i) const { return Path(i) + m_entries[i].nameOff; }
+    uint64_t Size(int i) const { return m_entries[i].size; }
+    uint64_t Mtime(int i) const { return m_entries[i].mtime; }
+
+    void SetStat(int i, uint64_t size, uint64_t mtime) {
+        m_entries[i].size = size;
+        m_entries[i].mtime = mtime;
+    }
+
+    // 保留容量，便于下一次拖入复用
+    void Clear() {
+        m_chars.clear();
+        m_entries.clear();
+    }
+
+    // 空路径不收；返回新条目下标，失败返回 -1
+    int Add(const wchar_t* path, size_t len) {
+        if (!path || len == 0) return -1;
+        Entry e{};
+        e.off = (uint32_t)m_chars.size();
+        e.nameOff = (uint32_t)(NamePart(path) - path);
+        if (e.nameOff > len) e.nameOff = (uint32_t)len;
+        m_chars.insert(m_chars.end(), path, path + len);
+        m_chars.push_back(0);
+        m_entries.push_back(e);
+        return (int)m_entries.size() - 1;
+    }
+    int Add(const wchar_t* path) { return path ? Add(path, wcslen(path)) : -1; }
+
+    size_t UsedBytes() const {
+        return m_chars.size() * sizeof(wchar_t) + m_entries.size() * sizeof(Entry);
+    }
+    size_t ReservedBytes() const {
+        return m_chars.capacity() * sizeof(wchar_t) + m_entries.capacity() * sizeof(Entry);
+    }
+
+    // 把容量收缩到实际大小，返回释放的字节数；空列表时完全释放
+    size_t Compact() {
+        size_t before = ReservedBytes();
+        if (m_entries.empty()) {
+            std::vector<wchar_t>().swap(m_chars);
+            std::vector<Entry>().swap(m_entries);
+        } else {
+            m_chars.shrink_to_fit();
+            m_entries.shrink_to_fit();
+        }
+        size_t after = ReservedBytes();
+        return before > after ? before - after : 0;
+    }
+
+private:
+    struct Entry {
+        uint32_t off;       // 路径在 m_chars 中的起点
+        uint32_t nameOff;   // 文件名相对路径起点的偏移
+        uint64_t size;
+        uint64_t mtime;
+    };
+
+    std::vector<wchar_t> m_chars;
+    std::vector<Entry> m_entries;
+};
+
+} // namespace relay
@@ -0,0 +1,271 @@
+// relay_pvec.h
+// 功能：持久化（结构共享）向量，撤销/重做历史的底层容器（与 Win32 无关）
+// - 32 叉前缀树 + 尾块（同 Clojure PersistentVector）：取值 O(log32 n)，尾部追加均摊 O(1)
+// - 值语义：拷贝只加引用计数；修改时只复制被共享的那条路径（引用计数为 1 的节点原地改）
+//   所以一步历史的内存只和改动量成正比，与列表长度无关
+// - 引用计数不是原子的：同一棵树的各个版本只能在一个线程里使用
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+
+namespace relay {
+
+template <class T>
+class PVector {
+public:
+    static const unsigned BITS = 5;
+    static const unsigned WIDTH = 1u << BITS;
+    static const unsigned MASK = WIDTH - 1;
+
+    PVector() {}
+    PVector(const PVector& o) : m_size(o.m_size), m_shift(o.m_shift), m_root(o.m_root), m_tail(o.m_tail) {
+        if (m_root) ++m_root->rc;
+        if (m_tail) ++m_tail->rc;
+    }
+    PVector(PVector&& o) noexcept : m_size(o.m_size), m_shift(o.m_shift), m_root(o.m_root), m_tail(o.m_tail) {
+        o.m_size = 0;
+        o.m_shift = BITS;
+        o.m_root = nullptr;
+        o.m_tail = nullptr;
+    }
+    PVector& operator=(PVector o) noexcept {
+        std::swap(m_size, o.m_size);
+        std::swap(m_shift, o.m_shift);
+        std::swap(m_root, o.m_root);
+        std::swap(m_tail, o.m_tail);
+        return *this;
+    }
+    ~PVector() { Clear(); }
+
+    size_t Size() const { return m_size; }
+    bool Empty() const { return m_size == 0; }
+
+    const T& operator[](size_t i) const { return LeafFor(i)->v[i & MASK]; }
+
+    void Clear() {
+        if (m_root) Release(m_root, m_shift);
+        if (m_tail) Release(m_tail, 0);
+        m_root = nullptr;
+        m_tail = nullptr;
+        m_size = 0;
+        m_shift = BITS;
+    }
+
+    void PushBack(T x) {
+        size_t inTail = m_size - TailOffset();
+        if (!m_tail || inTail < WIDTH) {
+            m_tail = m_tail ? Unique(m_tail) : new Leaf();
+            m_tail->v[inTail] = std::move(x);
+            ++m_size;
+            return;
+        }
+        // 尾块满了：挂进树里，再开新尾块
+        Leaf* full = m_tail;
+        m_tail = nullptr;
+        if (!m_root) {
+            Inner* r = new Inner();
+            r->kids[0] = full;
+            m_root = r;
+        } else if ((m_size >> BITS) > ((size_t)1 << m_shift)) {
+            Inner* r = new Inner();
+            r->kids[0] = m_root;
+            r->kids[1] = NewPath(m_shift, full);
+            m_root = r;
+            m_shift += BITS;
+        } else {
+            m_root = PushTail(m_shift, static_cast<Inner*>(m_root), full);
+        }
+        m_tail = new Leaf();
+        m_tail->v[0] = std::move(x);
+        ++m_size;
+    }
+
+    void PopBack() {
+        if (m_size == 0) return;
+        if (m_size == 1) { Clear(); return; }
+        size_t inTail = m_size - TailOffset();
+        if (inTail > 1) {
+            m_tail = Unique(m_tail);
+            m_tail->v[inTail - 1] = T();
+            --m_size;
+            return;
+        }
+        // 尾块只剩一个：树里最后一个叶子变成新尾块
+        Leaf* last = LeafFor(m_size - 2);
+        ++last->rc;
+        Release(m_tail, 0);
+        m_tail = last;
+        m_root = PopTail(m_shift, m_root);
+        if (m_root && m_shift > BITS && !static_cast<Inner*>(m_root)->kids[1]) {
+            Inner* r = static_cast<Inner*>(m_root);
+            Node* only = r->kids[0];
+            ++only->rc;
+            Release(r, m_shift);
+            m_root = only;
+            m_shift -= BITS;
+        }
+        --m_size;
+    }
+
+    // 保留前 n 个；代价与删掉的数量成正比
+    void Truncate(size_t n) {
+        if (n == 0) { Clear(); return; }
+        while (m_size > n) PopBack();
+    }
+
+    void Set(size_t i, T x) {
+        if (i >= TailOffset()) {
+            m_tail = Unique(m_tail);
+            m_tail->v[i & MASK] = std::move(x);
+            return;
+        }
+        m_root = Unique(m_root, m_shift);
+        Node* n = m_root;
+        for (unsigned level = m_shift; level > 0; level -= BITS) {
+            Inner* in = static_cast<Inner*>(n);
+            Node*& kid = in->kids[(i >> level) & MASK];
+            kid = Unique(kid, level - BITS);
+            n = kid;
+        }
+        static_cast<Leaf*>(n)->v[i & MASK] = std::move(x);
+    }
+
+    // 按顺序逐个访问，每个叶子只走一次树
+    template <class F>
+    void ForEach(F f) const {
+        size_t tailOff = TailOffset();
+        for (size_t base = 0; base < tailOff; base += WIDTH) {
+            const Leaf* leaf = LeafFor(base);
+            for (unsigned k = 0; k < WIDTH; ++k) f(leaf->v[k]);
+        }
+        for (size_t i = tailOff; i < m_size; ++i) f(m_tail->v[i - tailOff]);
+    }
+
+    // 可达的每个节点调用 f(节点地址, 字节数)；用于统计多个版本共享后的实际占用
+    template <class F>
+    void ForEachNode(F f) const {
+        if (m_root) VisitNode(m_root, m_shift, f);
+        if (m_tail) f((const void*)m_tail, sizeof(Leaf));
+    }
+
+private:
+    struct Node {
+        uint32_t rc = 1;
+    };
+    struct Inner : Node {
+        Node* kids[WIDTH] = {};
+    };
+    struct Leaf : Node {
+        T v[WIDTH];
+    };
+
+    size_t TailOffset() const { return m_size < WIDTH ? 0 : ((m_size - 1) >> BITS) << BITS; }
+
+    Leaf* LeafFor(size_t i) const {
+        if (i >= TailOffset()) return m_tail;
+        Node* n = m_root;
+        for (unsigned level = m_shift; level > 0; level -= BITS) n = static_cast<Inner*>(n)->kids[(i >> level) & MASK];
+        return static_cast<Leaf*>(n);
+    }
+
+    // level 为节点所在层的位移：0 为叶子
+    static void Release(Node* n, unsigned level) {
+        if (--n->rc) return;
+        if (level == 0) {
+            delete static_cast<Leaf*>(n);
+            return;
+        }
+        Inner* in = static_cast<Inner*>(n);
+        for (Node* k : in->kids) {
+            if (k) Release(k, level - BITS);
+        }
+        delete in;
+    }
+
+    // 独占则原地改，否则复制一份（调用方持有的引用转给副本）
+    static Leaf* Unique(Leaf* l) {
+        if (l->rc == 1) return l;
+        Leaf* c = new Leaf();
+        for (unsigned k = 0; k < WIDTH; ++k) c->v[k] = l->v[k];
+        --l->rc;
+        return c;
+    }
+    static Node* Unique(Node* n, unsigned level) {
+        if (level == 0) return Unique(static_cast<Leaf*>(n));
+        if (n->rc == 1) return n;
+        Inner* in = static_cast<Inner*>(n);
+        Inner* c = new Inner();
+        for (unsigned k = 0; k < WIDTH; ++k) {
+            c->kids[k] = in->kids[k];
+            if (c->kids[k]) ++c->kids[k]->rc;
+        }
+        --in->rc;
+        return c;
+    }
+
+    static Node* NewPath(unsigned level, Leaf* leaf) {
+        if (level == 0) return leaf;
+        Inner* in = new Inner();
+        in->kids[0] = NewPath(level - BITS, leaf);
+        return in;
+    }
+
+    Node* PushTail(unsigned level, Inner* parent, Leaf* leaf) {
+        parent = static_cast<Inner*>(Unique(parent, level));
+        unsigned sub = (unsigned)((m_size - 1) >> level) & MASK;
+        if (level == BITS) {
+            parent->kids[sub] = leaf;
+        } else if (Node* kid = parent->kids[sub]) {
+            parent->kids[sub] = PushTail(level - BITS, static_cast<Inner*>(kid), leaf);
+        } else {
+            parent->kids[sub] = NewPath(level - BITS, leaf);
+        }
+        return parent;
+    }
+
+    // 去掉树里最后一个叶子（它已被挪作尾块）；子树空了返回 nullptr
+    Node* PopTail(unsigned level, Node* n) {
+        unsigned sub = (unsigned)((m_size - 2) >> level) & MASK;
+        if (sub == 0 && level == BITS) {
+            Release(n, level);
+            return nullptr;
+        }
+        // 先独占再往下改，子节点的引用才是自己的
+        Inner* in = static_cast<Inner*>(Unique(n, level));
+        if (level > BITS) {
+            Node* kid = PopTail(level - BITS, in->kids[sub]);
+            in->kids[sub] = kid;
+            if (!kid && sub == 0) {
+                Release(in, level);
+                return nullptr;
+            }
+            return in;
+        }
+        Release(in->kids[sub], 0);
+        in->kids[sub] = nullptr;
+        return in;
+    }
+
+    template <class F>
+    static void VisitNode(const Node* n, unsigned level, F& f) {
+        if (level == 0) {
+            f((const void*)n, sizeof(Leaf));
+            return;
+        }
+        f((const void*)n, sizeof(Inner));
+        for (const Node* k : static_cast<const Inner*>(n)->kids) {
+            if (k) VisitNode(k, level - BITS, f);
+        }
+    }
+
+    size_t m_size = 0;
+    unsigned m_shift = BITS;
+    Node* m_root = nullptr;
+    Leaf* m_tail = nullptr;
+};
+
+} // namespace relay
@@ -0,0 +1,458 @@
+// relay_sort.h
+// 功能：中转列表的排序 / 分组（与 Win32 无关，可在 Linux 上编译和压测）
+// - 排序方式：拖入顺序 / 名称（自然数字序，file2 < file10）/ 扩展名 / 大小 / 修改时间 / 所在文件夹
+// - 排序对象是紧凑的 key 数组（16 字节前缀 + 下标），不直接搬动路径字符串；
+//   只有前缀相同时才回退到完整字符串比较
+// - 数量较大时分块交给执行器并行排序再归并
+// - Ctrl 追加：新条目单独排序后与已有 key 归并，不整体重排
+// - 分组（文件夹 / 扩展名）只影响 tip 显示，拖出顺序始终等于排序顺序
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+#include <wctype.h>
+
+#include <algorithm>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "relay_exec.h"
+
+namespace relay {
+
+enum SortMode {
+    SORT_DROP = 0,   // 拖入顺序
+    SORT_NAME,       // 名称（自然序）
+    SORT_EXT,        // 扩展名，其次名称
+    SORT_SIZE,       // 大小，其次名称
+    SORT_MTIME,      // 修改时间，其次名称
+    SORT_FOLDER,     // 所在文件夹，其次名称
+    SORT_MODE_COUNT
+};
+
+enum GroupMode {
+    GROUP_NONE = 0,
+    GROUP_FOLDER,
+    GROUP_EXT,
+};
+
+// 排序输入：path 由调用方持有，排序期间必须保持有效
+struct SortItem {
+    const wchar_t* path;
+    uint64_t size;
+    uint64_t mtime;   // 任意单调时间单位（Win32 下为 FILETIME）
+};
+
+// ---------------- string helpers ----------------
+inline bool IsPathSep(wchar_t c) { return c == L'\\' || c == L'/'; }
+inline bool IsDigitW(wchar_t c) { return c >= L'0' && c <= L'9'; }
+
+inline unsigned FoldCharW(wchar_t c) {
+    if (c >= L'A' && c <= L'Z') return (unsigned)(c + 32);
+    if ((unsigned)c < 128) return (unsigned)c;
+    return (unsigned)towlower((wint_t)c);
+}
+
+// 路径中的文件名部分
+inline const wchar_t* NamePart(const wchar_t* path) {
+    const wchar_t* base = path;
+    for (const wchar_t* p = path; *p; ++p) {
+        if (IsPathSep(*p)) base = p + 1;
+    }
+    return base;
+}
+
+// 所在文件夹：[path, path+len)，不含末尾分隔符
+inline size_t FolderLen(const wchar_t* path) {
+    const wchar_t* name = NamePart(path);
+    if (name == path) return 0;
+    return (size_t)(name - path - 1);
+}
+
+// 扩展名（不含点），".bashrc" 这种没有扩展名
+inline const wchar_t* ExtPart(const wchar_t* path, size_t* len) {
+    const wchar_t* name = NamePart(path);
+    const wchar_t* dot = nullptr;
+    const wchar_t* p = name;
+    for (; *p; ++p) {
+        if (*p == L'.') dot = p;
+    }
+    if (!dot || dot == name) { *len = 0; return p; }
+    *len = (size_t)(p - dot - 1);
+    return dot + 1;
+}
+
+// 自然序比较：忽略大小写，连续数字按数值比较（忽略前导 0）
+// 数字与非数字相遇时，数字按 '0' 参与比较
+inline int NaturalCompareN(const wchar_t* a, size_t na, const wchar_t* b, size_t nb) {
+    const wchar_t* ae = a + na;
+    const wchar_t* be = b + nb;
+    while (a < ae && b < be) {
+        if (IsDigitW(*a) && IsDigitW(*b)) {
+            while (a < ae && *a == L'0') ++a;
+            while (b < be && *b == L'0') ++b;
+            const wchar_t* as = a;
+            const wchar_t* bs = b;
+            while (a < ae && IsDigitW(*a)) ++a;
+            while (b < be && IsDigitW(*b)) ++b;
+            size_t la = (size_t)(a - as), lb = (size_t)(b - bs);
+            if (la != lb) return la < lb ? -1 : 1;
+            for (size_t i = 0; i < la; ++i) {
+                if (as[i] != bs[i]) return as[i] < bs[i] ? -1 : 1;
+            }
+            continue;
+        }
+        unsigned ca = IsDigitW(*a) ? 0x30u : FoldCharW(*a);
+        unsigned cb = IsDigitW(*b) ? 0x30u : FoldCharW(*b);
+        if (ca != cb) return ca < cb ? -1 : 1;
+        ++a; ++b;
+    }
+    if (a < ae) return 1;
+    if (b < be) return -1;
+    return 0;
+}
+
+inline int NaturalCompare(const wchar_t* a, const wchar_t* b) {
+    return NaturalCompareN(a, wcslen(a), b, wcslen(b));
+}
+
+// 把自然序的前 16 个单位编码成两个 64 位整数（按 key[0], key[1] 字典序比较）：
+// key(a) < key(b) 必然有 NaturalCompare(a, b) < 0
+// 遇到编码不下的值（非 ASCII 字符、超长数字串）写 0xFF 后截止，剩下的交给完整比较
+inline void NaturalPrefixN(const wchar_t* s, size_t n, uint64_t key[2]) {
+    key[0] = key[1] = 0;
+    int used = 0;
+    bool stop = false;
+    auto put = [&](unsigned v) {
+        if (stop || used >= 16) return;
+        if (v >= 0xFF) { v = 0xFF; stop = true; }
+        key[used >> 3] |= (uint64_t)v << (56 - 8 * (used & 7));
+        ++used;
+    };
+
+    const wchar_t* e = s + n;
+    while (s < e && used < 16 && !stop) {
+        if (IsDigitW(*s)) {
+            while (s < e && *s == L'0') ++s;
+            const wchar_t* ds = s;
+            while (s < e && IsDigitW(*s)) ++s;
+            put(0x30);
+            put((unsigned)(s - ds));
+            for (const wchar_t* p = ds; p < s; ++p) put((unsigned)*p);
+        } else {
+            put(FoldCharW(*s));
+            ++s;
+        }
+    }
+}
+
+// ---------------- parallel sort ----------------
+// 分块排序 + 两两归并，分块交给执行器（调用线程也参与）；没有执行器、数据量小或单核时退化为 std::sort。
+// parts 为 0 时按执行器线程数 + 1 分块
+template <class T, class Less>
+void ParallelSort(T* first, T* last, Less less, Executor* exec, unsigned parts = 0) {
+    const size_t n = (size_t)(last - first);
+    const size_t kMinPerPart = 4096;
+
+    if (parts == 0) parts = exec ? exec->Workers() + 1 : 1;
+    if (parts > n / kMinPerPart) parts = (unsigned)(n / kMinPerPart);
+    if (!exec || parts <= 1) { std::sort(first, last, less); return; }
+
+    std::vector<size_t> bounds(parts + 1);
+    for (unsigned i = 0; i <= parts; ++i) bounds[i] = n * i / parts;
+
+    exec->ParallelFor(PRIORITY_INTERACTIVE, parts, [&](size_t i) {
+        std::sort(first + bounds[i], first + bounds[i + 1], less);
+    });
+    for (size_t width = 1; width < parts; width *= 2) {
+        size_t pairs = (parts - width + width * 2 - 1) / (width * 2);
+        exec->ParallelFor(PRIORITY_INTERACTIVE, pairs, [&](size_t k) {
+            size_t i = k * width * 2;
+            size_t lo = bounds[i];
+            size_t mid = bounds[i + width];
+            size_t hi = bounds[std::min<size_t>(i + width * 2, parts)];
+            std::inplace_merge(first + lo, first + mid, first + hi, less);
+        });
+    }
+}
+
+// ---------------- groups ----------------
+struct GroupRef {
+    const wchar_t* p;
+    size_t n;
+};
+
+struct GroupRefHash {
+    size_t operator()(const GroupRef& g) const {
+        size_t h = 1469598103934665603ull & (size_t)-1;
+        for (size_t i = 0; i < g.n; ++i) h = (h ^ FoldCharW(g.p[i])) * (size_t)1099511628211ull;
+        return h;
+    }
+};
+
+struct GroupRefEq {
+    bool operator()(const GroupRef& a, const GroupRef& b) const {
+        if (a.n != b.n) return false;
+        for (size_t i = 0; i < a.n; ++i) {
+            if (FoldCharW(a.p[i]) != FoldCharW(b.p[i])) return false;
+        }
+        return true;
+    }
+};
+
+inline GroupRef GroupOf(const wchar_t* path, GroupMode mode) {
+    GroupRef g{path, 0};
+    if (mode == GROUP_FOLDER) {
+        g.n = FolderLen(path);
+    } else if (mode == GROUP_EXT) {
+        g.p = ExtPart(path, &g.n);
+    }
+    return g;
+}
+
+inline GroupMode GroupModeForSort(SortMode mode) {
+    if (mode == SORT_FOLDER) return GROUP_FOLDER;
+    if (mode == SORT_EXT) return GROUP_EXT;
+    return GROUP_NONE;
+}
+
+// ---------------- sorted view ----------------
+class SortView {
+public:
+    SortMode Mode() const { return m_mode; }
+    uint32_t Size() const { return (uint32_t)m_order.size(); }
+    const uint32_t* Order() const { return m_order.data(); }
+
+    void Clear() {
+        m_keys.clear();
+        m_info.clear();
+        m_order.clear();
+        m_folders.Clear();
+        m_exts.Clear();
+    }
+
+    // 释放多余容量（空闲模式下调用）；内容不变
+    void Compact() {
+        m_keys.shrink_to_fit();
+        m_info.shrink_to_fit();
+        m_order.shrink_to_fit();
+        m_folders.Compact();
+        m_exts.Compact();
+    }
+
+    // 全量重建：items[0..count)；exec 非空时大批 key 分块并行排序
+    void Reset(SortMode mode, const SortItem* items, uint32_t count, Executor* exec = nullptr) {
+        m_mode = mode;
+        Clear();
+        Append(items, count, exec);
+    }
+
+    // 增量追加：items[0..Size()) 已在视图中，新条目为 items[Size()..count)
+    void Append(const SortItem* items, uint32_t count, Executor* exec = nullptr) {
+        const uint32_t old = Size();
+        if (count <= old) return;
+
+        if (m_mode == SORT_DROP) {
+            for (uint32_t i = old; i < count; ++i) m_order.push_back(i);
+            return;
+        }
+        AddInfo(items, count);
+
+        GroupTable* table = Table(GroupModeForSort(m_mode));
+        if (table && table->Update(items, m_info.data(), count, GroupModeForSort(m_mode))) {
+            // 名次是单调改写，已有 key 的相对顺序不变
+            for (Key& k : m_keys) k.hi = table->RankOfItem(k.index);
+        }
+
+        std::vector<Key> fresh(count - old);
+        for (uint32_t i = old; i < count; ++i) {
+            Key& k = fresh[i - old];
+            const Info& info = m_info[i];
+            uint64_t prefix[2];
+            NaturalPrefixN(items[i].path + info.nameOff, info.nameLen, prefix);
+            k.index = i;
+            k.lo = prefix[0];
+            switch (m_mode) {
+            case SORT_SIZE:  k.hi = items[i].size; break;
+            case SORT_MTIME: k.hi = items[i].mtime; break;
+            case SORT_EXT:
+            case SORT_FOLDER: k.hi = table->RankOfItem(i); break;
+            default:          k.hi = prefix[0]; k.lo = prefix[1]; break;   // 名称：两段前缀都用上
+            }
+        }
+
+        KeyLess less{items, m_info.data()};
+        ParallelSort(fresh.data(), fresh.data() + fresh.size(), less, exec);
+
+        if (m_keys.empty()) {
+            m_keys.swap(fresh);
+        } else {
+            std::vector<Key> merged(m_keys.size() + fresh.size());
+            std::merge(m_keys.begin(), m_keys.end(), fresh.begin(), fresh.end(), merged.begin(), less);
+            m_keys.swap(merged);
+        }
+
+        m_order.resize(m_keys.size());
+        for (size_t i = 0; i < m_keys.size(); ++i) m_order[i] = m_keys[i].index;
+    }
+
+    // tip 显示用：在排序顺序上按分组稳定重排，分组按自然序；items 与 Append 时的下标一致。
+    // 分组表首次用到时建立，之后随 Append 增量维护
+    void GroupedOrder(const SortItem* items, GroupMode mode, std::vector<uint32_t>& out) {
+        out.assign(m_order.begin(), m_order.end());
+        GroupTable* table = Table(mode);
+        if (!table) return;
+        AddInfo(items, Size());
+        table->Update(items, m_info.data(), Size(), mode);
+        std::stable_sort(out.begin(), out.end(), [table](uint32_t a, uint32_t b) {
+            return table->RankOfItem(a) < table->RankOfItem(b);
+        });
+    }
+
+private:
+    struct Key {
+        uint64_t hi;      // 主键：大小 / 时间 / 分组名次（按名称排序时为前缀前半段）
+        uint64_t lo;      // 名称自然序前缀
+        uint32_t index;   // 原始下标，最终平手时保证稳定
+    };
+
+    // 每条只扫一遍路径（按拖入顺序时到第一次分组才扫），之后比较、分组都用这里的偏移
+    struct Info {
+        uint32_t nameOff;   // 文件名在路径中的偏移（所在文件夹长度为 nameOff - 1）
+        uint32_t nameLen;
+        uint32_t extOff;    // 扩展名（不含点）在路径中的偏移；没有扩展名时 extLen 为 0
+        uint32_t extLen;
+    };
+
+    struct KeyLess {
+        const SortItem* items;
+        const Info* info;
+        bool operator()(const Key& a, const Key& b) const {
+            if (a.hi != b.hi) return a.hi < b.hi;
+            if (a.lo != b.lo) return a.lo < b.lo;
+            const Info& ia = info[a.index];
+            const Info& ib = info[b.index];
+            int c = NaturalCompareN(items[a.index].path + ia.nameOff, ia.nameLen,
+                                    items[b.index].path + ib.nameOff, ib.nameLen);
+            if (c != 0) return c < 0;
+            return a.index < b.index;
+        }
+    };
+
+    static GroupRef GroupOfInfo(const wchar_t* path, const Info& info, GroupMode mode) {
+        if (mode == GROUP_FOLDER) return GroupRef{path, info.nameOff ? info.nameOff - 1u : 0u};
+        return GroupRef{path + info.extOff, info.extLen};
+    }
+
+    // 文件夹 / 扩展名 -> 名次。分组名拷贝一份（列表缓冲会重新分配），查找表跨追加保留；
+    // 新分组单独排序后与已有分组归并，名次随之单调重排
+    class GroupTable {
+    public:
+        void Clear() {
+            m_names.clear();
+            m_index.clear();
+            m_sorted.clear();
+            m_rank.clear();
+            m_ofItem.clear();
+        }
+        void Compact() {
+            m_names.shrink_to_fit();
+            m_sorted.shrink_to_fit();
+            m_rank.shrink_to_fit();
+            m_ofItem.shrink_to_fit();
+        }
+
+        uint32_t RankOfItem(uint32_t i) const { return m_rank[m_ofItem[i]]; }
+
+        // 补齐 items[已登记..count) 的分组；出现新分组（名次有变）时返回 true
+        bool Update(const SortItem* items, const Info* info, uint32_t count, GroupMode mode) {
+            const uint32_t from = (uint32_t)m_ofItem.size();
+            if (count <= from) return false;
+            const uint32_t oldGroups = (uint32_t)m_names.size();
+            m_ofItem.resize(count);
+            for (uint32_t i = from; i < count; ++i) {
+                GroupRef g = GroupOfInfo(items[i].path, info[i], mode);
+                auto it = m_index.find(g);
+                if (it == m_index.end()) {
+                    m_names.emplace_back(g.p, g.n);
+                    const std::wstring& s = m_names.back();
+                    it = m_index.emplace(GroupRef{s.c_str(), s.size()}, (uint32_t)(m_names.size() - 1)).first;
+                }
+                m_ofItem[i] = it->second;
+            }
+            const uint32_t groups = (uint32_t)m_names.size();
+            if (groups == oldGroups) return false;
+
+            auto less = [this](uint32_t a, uint32_t b) { return Compare(a, b) < 0; };
+            std::vector<uint32_t> fresh(groups - oldGroups);
+            for (uint32_t g = oldGroups; g < groups; ++g) fresh[g - oldGroups] = g;
+            std::sort(fresh.begin(), fresh.end(), less);
+            std::vector<uint32_t> merged(groups);
+            std::merge(m_sorted.begin(), m_sorted.end(), fresh.begin(), fresh.end(), merged.begin(), less);
+            m_sorted.swap(merged);
+
+            // 自然序相等（如 "1" 与 "01"）的分组共享名次
+            m_rank.resize(groups);
+            uint32_t r = 0;
+            for (size_t i = 0; i < m_sorted.size(); ++i) {
+                if (i > 0 && Compare(m_sorted[i - 1], m_sorted[i]) != 0) ++r;
+                m_rank[m_sorted[i]] = r;
+            }
+            return true;
+        }
+
+    private:
+        int Compare(uint32_t a, uint32_t b) const {
+            const std::wstring& x = m_names[a];
+            const std::wstring& y = m_names[b];
+            return NaturalCompareN(x.c_str(), x.size(), y.c_str(), y.size());
+        }
+
+        std::deque<std::wstring> m_names;   // 按出现顺序；deque 保证 c_str() 不失效
+        std::unordered_map<GroupRef, uint32_t, GroupRefHash, GroupRefEq> m_index;
+        std::vector<uint32_t> m_sorted;     // 分组按自然序
+        std::vector<uint32_t> m_rank;       // 分组 -> 名次
+        std::vector<uint32_t> m_ofItem;     // 原始下标 -> 分组
+    };
+
+    GroupTable* Table(GroupMode mode) {
+        if (mode == GROUP_FOLDER) return &m_folders;
+        if (mode == GROUP_EXT) return &m_exts;
+        return nullptr;
+    }
+
+    void AddInfo(const SortItem* items, uint32_t count) {
+        for (uint32_t i = (uint32_t)m_info.size(); i < count; ++i) {
+            const wchar_t* path = items[i].path;
+            Info info{};
+            const wchar_t* dot = nullptr;
+            const wchar_t* p = path;
+            for (; *p; ++p) {
+                if (IsPathSep(*p)) { info.nameOff = (uint32_t)(p + 1 - path); dot = nullptr; }
+                else if (*p == L'.') dot = p;
+            }
+            info.nameLen = (uint32_t)(p - path) - info.nameOff;
+            // ".bashrc" 这种没有扩展名
+            if (dot && dot != path + info.nameOff) {
+                info.extOff = (uint32_t)(dot + 1 - path);
+                info.extLen = (uint32_t)(p - dot - 1);
+            } else {
+                info.extOff = (uint32_t)(p - path);
+            }
+            m_info.push_back(info);
+        }
+    }
+
+    SortMode m_mode = SORT_DROP;
+    std::vector<Key> m_keys;
+    std::vector<Info> m_info;        // 原始下标 -> 路径内偏移
+    std::vector<uint32_t> m_order;
+    GroupTable m_folders;
+    GroupTable m_exts;
+};
+
+} // namespace relay
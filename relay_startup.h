@@ -0,0 +1,216 @@
+// relay_startup.h
+// 功能：冷启动分阶段计时（与 Win32 无关，时间由调用方传入微秒数）
+// - main.cpp 带 --trace-startup[=文件] 启动时，WinMain 各阶段、首帧、首帧后的延迟初始化依次打点，
+//   全部做完后追加一行 JSON：
+//   {"pre_main_ms":3.120,"first_paint_ms":4.870,"ready_ms":9.410,"dropped":0,"phases":[["instance",0.052],...]}
+//   phases 为各阶段结束时距 WinMain 入口的毫秒数；pre_main_ms 为进程创建到 WinMain 入口（未知时为 -1）
+// - 固定容量，打点不分配内存；未开启时 Mark 只是一次判断
+// - ParseStartupLine 读回上面那一行，bench --startup-log 汇总多次/多台机器的分位数
+// - FindSwitch：在整条命令行里找开关（双引号内的空白不切分，引号本身去掉）
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace relay {
+
+class StartupTrace {
+public:
+    static const size_t MAX_PHASES = 32;
+
+    // 开启并以 nowUs 为零点
+    void Begin(uint64_t nowUs) {
+        m_enabled = true;
+        m_origin = nowUs;
+        m_count = 0;
+        m_dropped = 0;
+    }
+    bool Enabled() const { return m_enabled; }
+
+    void SetPreMainUs(uint64_t us) {
+        m_preMainUs = us;
+        m_hasPreMain = true;
+    }
+
+    // name 只存指针，须为字符串字面量；超出容量的打点只计数
+    void Mark(const char* name, uint64_t nowUs) {
+        if (!m_enabled) return;
+        if (m_count == MAX_PHASES) {
+            ++m_dropped;
+            return;
+        }
+        m_phases[m_count].name = name;
+        m_phases[m_count].us = nowUs > m_origin ? nowUs - m_origin : 0;
+        ++m_count;
+    }
+    // 同名只记第一次（首帧）
+    void MarkOnce(const char* name, uint64_t nowUs) {
+        if (m_enabled && !Find(name, nullptr)) Mark(name, nowUs);
+    }
+
+    size_t Count() const { return m_count; }
+    size_t Dropped() const { return m_dropped; }
+    const char* Name(size_t i) const { return m_phases[i].name; }
+    uint64_t Us(size_t i) const { return m_phases[i].us; }
+
+    bool Find(const char* name, uint64_t* us) const {
+        for (size_t i = 0; i < m_count; ++i) {
+            if (strcmp(m_phases[i].name, name) == 0) {
+                if (us) *us = m_phases[i].us;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 一行 JSON（不含换行）
+    std::string Format() const {
+        std::string out = "{\"pre_main_ms\":";
+        AppendMs(out, m_hasPreMain ? (int64_t)m_preMainUs : -1);
+        uint64_t us = 0;
+        out += ",\"first_paint_ms\":";
+        AppendMs(out, Find("first_paint", &us) ? (int64_t)us : -1);
+        out += ",\"ready_ms\":";
+        AppendMs(out, Find("ready", &us) ? (int64_t)us : -1);
+        char num[32];
+        snprintf(num, sizeof(num), ",\"dropped\":%u", (unsigned)m_dropped);
+        out += num;
+        out += ",\"phases\":[";
+        for (size_t i = 0; i < m_count; ++i) {
+            if (i) out += ',';
+            out += "[\"";
+            for (const char* p = m_phases[i].name; *p; ++p) {
+                if (*p == '"' || *p == '\\') out += '\\';
+                if ((unsigned char)*p >= 0x20) out += *p;
+            }
+            out += "\",";
+            AppendMs(out, (int64_t)m_phases[i].us);
+            out += ']';
+        }
+        out += "]}";
+        return out;
+    }
+
+private:
+    struct Phase {
+        const char* name;
+        uint64_t us;
+    };
+
+    static void AppendMs(std::string& out, int64_t us) {
+        char num[32];
+        if (us < 0) snprintf(num, sizeof(num), "-1");
+        else snprintf(num, sizeof(num), "%llu.%03u", (unsigned long long)(us / 1000), (unsigned)(us % 1000));
+        out += num;
+    }
+
+    bool m_enabled = false;
+    bool m_hasPreMain = false;
+    uint64_t m_origin = 0;
+    uint64_t m_preMainUs = 0;
+    Phase m_phases[MAX_PHASES];
+    size_t m_count = 0;
+    size_t m_dropped = 0;
+};
+
+// 读回 StartupTrace::Format 的一行；缺失的毫秒数为 -1
+struct StartupRecord {
+    double preMainMs = -1;
+    double firstPaintMs = -1;
+    double readyMs = -1;
+    std::vector<std::pair<std::string, double>> phases;
+};
+
+namespace detail {
+
+// 在 [p, end) 里找 key 后面紧跟的数字
+inline bool StartupNumberAfter(const char* p, const char* end, const char* key, double& out) {
+    size_t kn = strlen(key);
+    for (const char* q = p; q + kn <= end; ++q) {
+        if (memcmp(q, key, kn) != 0) continue;
+        const char* s = q + kn;
+        std::string num;
+        while (s < end && num.size() < 31 && (*s == '-' || *s == '.' || (*s >= '0' && *s <= '9'))) num += *s++;
+        if (num.empty()) return false;
+        out = strtod(num.c_str(), nullptr);
+        return true;
+    }
+    return false;
+}
+
+} // namespace detail
+
+inline bool ParseStartupLine(const char* s, size_t n, StartupRecord& out) {
+    out = StartupRecord();
+    const char* end = s + n;
+    if (n == 0 || *s != '{') return false;
+    if (!detail::StartupNumberAfter(s, end, "\"first_paint_ms\":", out.firstPaintMs)) return false;
+    detail::StartupNumberAfter(s, end, "\"pre_main_ms\":", out.preMainMs);
+    detail::StartupNumberAfter(s, end, "\"ready_ms\":", out.readyMs);
+
+    static const char KEY[] = "\"phases\":[";
+    const size_t kn = sizeof(KEY) - 1;
+    const char* p = s;
+    while (p + kn <= end && memcmp(p, KEY, kn) != 0) ++p;
+    if (p + kn > end) return true;
+    p += kn;
+    // ["名字",毫秒] 逐个读，遇到不认识的就停
+    while (p + 1 < end && p[0] == '[' && p[1] == '"') {
+        p += 2;
+        std::string name;
+        while (p < end && *p != '"') {
+            if (*p == '\\' && p + 1 < end) ++p;
+            name += *p++;
+        }
+        if (p + 1 >= end || p[1] != ',') break;
+        p += 2;
+        std::string num;
+        while (p < end && num.size() < 31 && (*p == '-' || *p == '.' || (*p >= '0' && *p <= '9'))) num += *p++;
+        if (num.empty() || p >= end || *p != ']') break;
+        out.phases.emplace_back(std::move(name), strtod(num.c_str(), nullptr));
+        ++p;
+        if (p < end && *p == ',') ++p;
+    }
+    return true;
+}
+
+// 命令行里有 name（如 "--trace-startup"）或 name=值 时返回 true；value 可为空指针
+template <class C>
+inline bool FindSwitch(const C* cmd, const C* name, std::basic_string<C>* value) {
+    if (!cmd || !name) return false;
+    size_t nameLen = 0;
+    while (name[nameLen]) ++nameLen;
+    if (nameLen == 0) return false;
+
+    std::basic_string<C> tok;
+    const C* p = cmd;
+    for (;;) {
+        while (*p == ' ' || *p == '\t') ++p;
+        if (!*p) return false;
+        tok.clear();
+        bool quoted = false;
+        for (; *p && (quoted || (*p != ' ' && *p != '\t')); ++p) {
+            if (*p == '"') quoted = !quoted;
+            else tok += *p;
+        }
+        if (tok.size() < nameLen || tok.compare(0, nameLen, name) != 0) continue;
+        if (tok.size() == nameLen) {
+            if (value) value->clear();
+            return true;
+        }
+        if (tok[nameLen] == '=') {
+            if (value) value->assign(tok, nameLen + 1, std::basic_string<C>::npos);
+            return true;
+        }
+    }
+}
+
+} // namespace relay
@@ -0,0 +1,556 @@
+// relay_zip.h
+// 功能：把中转列表按需流式写成一个 ZIP（与 Win32 无关，main.cpp 与 bench/bench.cpp 共用）
+// - 调用方只管 Read()：本地头、数据、数据描述符、中央目录按顺序边读边产生，不落盘、不整体缓存
+// - 文件按 chunk 切块；deflate 块带上一块末尾 32K 作预置字典，作为 BULK 任务交给 Executor 并行压缩，
+//   按序拼接输出（读取/CRC 在调用 Read 的线程上顺序进行，最多预读 window 个块）
+// - 存储模式：已压缩格式（jpg/mp4/zip...）原样存入，不占压缩任务
+// - 大小事先未知：本地头置 bit 3，数据后跟数据描述符；压缩后可能超过 4G 的条目（按 deflate 最坏膨胀算）
+//   与超过 4G 的归档按 ZIP64 写
+// - 条目名为 UTF-8（bit 11），目录名以 '/' 结尾
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <wchar.h>
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "relay_deflate.h"
+#include "relay_exec.h"
+#include "relay_sort.h"
+
+namespace relay {
+
+enum ZipMethod { ZIP_AUTO, ZIP_DEFLATE, ZIP_STORE };
+
+struct ZipEntry {
+    std::string name;       // UTF-8，'/' 分隔；目录以 '/' 结尾
+    uint16_t dosTime = 0;
+    uint16_t dosDate = 0x21;    // 1980-01-01
+    uint64_t sizeHint = 0;      // 打开前已知的大小，用来决定是否按 ZIP64 写
+    uint32_t source = 0;        // 调用方自己的下标（ZipInput::Open 用）
+    bool isDir = false;
+    bool store = false;
+};
+
+// 一个条目的数据源；Read 返回 0 表示结束（出错也按结束处理，条目按实际读到的内容收尾）
+class ZipSource {
+public:
+    virtual ~ZipSource() {}
+    virtual size_t Read(uint8_t* dst, size_t n) = 0;
+};
+
+class ZipInput {
+public:
+    virtual ~ZipInput() {}
+    // 打不开返回 nullptr，该条目被跳过
+    virtual std::unique_ptr<ZipSource> Open(const ZipEntry& e) = 0;
+};
+
+// ---------------- helpers ----------------
+inline void DosDateTime(int year, int month, int day, int hour, int minute, int second,
+                        uint16_t& dosDate, uint16_t& dosTime) {
+    if (year < 1980) { year = 1980; month = 1; day = 1; hour = minute = second = 0; }
+    if (year > 2107) year = 2107;
+    dosDate = (uint16_t)(((year - 1980) << 9) | (month << 5) | day);
+    dosTime = (uint16_t)((hour << 11) | (minute << 5) | (second / 2));
+}
+
+// wchar_t 为 UTF-16（Windows）或 UTF-32（Linux）都可以
+inline void AppendUtf8(const wchar_t* s, size_t n, std::string& out) {
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t c = (uint32_t)s[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < n && (uint32_t)s[i + 1] >= 0xDC00 && (uint32_t)s[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)s[i + 1] - 0xDC00);
+            ++i;
+        } else if ((c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) {
+            c = 0xFFFD;
+        }
+        if (c < 0x80) {
+            out.push_back((char)c);
+        } else if (c < 0x800) {
+            out.push_back((char)(0xC0 | (c >> 6)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        } else if (c < 0x10000) {
+            out.push_back((char)(0xE0 | (c >> 12)));
+            out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        } else {
+            out.push_back((char)(0xF0 | (c >> 18)));
+            out.push_back((char)(0x80 | ((c >> 12) & 0x3F)));
+            out.push_back((char)(0x80 | ((c >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (c & 0x3F)));
+        }
+    }
+}
+
+// 本身已压缩过的格式，再 deflate 只是浪费 CPU
+inline bool IsCompressedExt(const wchar_t* name) {
+    static const wchar_t* const EXTS[] = {
+        L"zip", L"7z", L"rar", L"gz", L"tgz", L"bz2", L"xz", L"zst", L"lz4", L"cab", L"jar", L"apk",
+        L"docx", L"xlsx", L"pptx", L"epub", L"jpg", L"jpeg", L"png", L"gif", L"webp", L"heic", L"avif",
+        L"mp3", L"m4a", L"aac", L"ogg", L"opus", L"flac", L"mp4", L"m4v", L"mkv", L"mov", L"avi", L"webm",
+    };
+    size_t n = 0;
+    const wchar_t* ext = ExtPart(name, &n);
+    if (n == 0) return false;
+    for (const wchar_t* e : EXTS) {
+        size_t k = wcslen(e);
+        if (k != n) continue;
+        size_t i = 0;
+        while (i < n && FoldCharW(ext[i]) == FoldCharW(e[i])) ++i;
+        if (i == n) return true;
+    }
+    return false;
+}
+
+inline bool UseStore(ZipMethod method, const wchar_t* name) {
+    if (method == ZIP_STORE) return true;
+    if (method == ZIP_DEFLATE) return false;
+    return IsCompressedExt(name);
+}
+
+// ---------------- size limits ----------------
+// 条目是否按 ZIP64 写在打开时就得定下来（本地头在数据之前）。deflate 遇到不可压数据会比原文略大，
+// 所以按压缩后的上界判断，再留 64K 余量给打开之后又变大的文件
+inline uint64_t ZipDeflateBound(uint64_t size, size_t chunkBytes) {
+    return Deflater::Bound(size, size / chunkBytes + 1);
+}
+
+inline bool ZipNeedsZip64(uint64_t sizeHint, bool store, size_t chunkBytes) {
+    uint64_t worst = store ? sizeHint : ZipDeflateBound(sizeHint, chunkBytes);
+    return worst >= 0xFFFF0000ull;
+}
+
+// 没按 ZIP64 开的条目最多收这么多原始字节，压缩后仍能放进 32 位（多出来的部分丢弃）
+inline uint64_t ZipRawLimit(bool store, size_t chunkBytes) {
+    if (store) return 0xFFFFFFFFull;
+    uint64_t lo = 0, hi = 0xFFFFFFFFull;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo + 1) / 2;
+        if (ZipDeflateBound(mid, chunkBytes) <= 0xFFFFFFFFull) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+// ---------------- streaming writer ----------------
+class ZipStream {
+public:
+    static const size_t DEFAULT_CHUNK = 128 * 1024;
+
+    // exec 为空：在调用 Read 的线程上同步压缩；parallel 为同时在压的块数（0 = 执行器线程数），
+    // 只影响预读窗口。输出与两者无关（块边界和字典相同）
+    ZipStream(std::vector<ZipEntry> entries, ZipInput* input, Executor* exec, unsigned parallel = 0,
+              size_t chunkBytes = DEFAULT_CHUNK)
+        : m_entries(std::move(entries)), m_input(input), m_exec(exec),
+          m_chunkBytes(chunkBytes < 4096 ? 4096 : chunkBytes) {
+        unsigned t = !exec ? 1 : (parallel ? parallel : exec->Workers());
+        if (t < 1) t = 1;
+        m_window = t * 4 < 8 ? 8 : t * 4;
+        m_windowBytes = (size_t)(t * 2 + 1) * m_chunkBytes;
+        m_deflateLimit = ZipRawLimit(false, m_chunkBytes);
+    }
+
+    // 已交给执行器的块引用着本对象，等它们做完
+    ~ZipStream() {
+        m_cancel.Cancel();
+        std::unique_lock<std::mutex> lock(m_mu);
+        m_cvDone.wait(lock, [this] { return m_outstanding == 0; });
+    }
+
+    ZipStream(const ZipStream&) = delete;
+    ZipStream& operator=(const ZipStream&) = delete;
+
+    // 填满 dst 或到达结尾；返回 0 表示整个归档已输出完
+    size_t Read(uint8_t* dst, size_t n) {
+        size_t got = 0;
+        while (got < n) {
+            if (m_outPos == m_out.size()) {
+                m_out.clear();
+                m_outPos = 0;
+                if (!Advance()) break;
+                continue;
+            }
+            size_t k = std::min(n - got, m_out.size() - m_outPos);
+            memcpy(dst + got, m_out.data() + m_outPos, k);
+            m_outPos += k;
+            got += k;
+        }
+        m_produced += got;
+        return got;
+    }
+
+    bool Finished() const { return m_state == S_DONE && m_outPos == m_out.size(); }
+    uint64_t Produced() const { return m_produced; }
+    uint32_t EntriesWritten() const { return m_written; }
+
+private:
+    struct Chunk {
+        uint32_t entry = 0;
+        bool first = false, last = false;
+        bool store = false;
+        bool zip64 = false;
+        uint32_t crc = 0;           // last 块：整个条目的 CRC
+        uint64_t rawTotal = 0;      // last 块：整个条目的原始大小
+        size_t rawSize = 0;         // 本块原始字节数（预读窗口计数用）
+        std::vector<uint8_t> dict;
+        std::vector<uint8_t> raw;
+        std::vector<uint8_t> out;
+        bool done = false;
+    };
+
+    struct Feed {
+        std::unique_ptr<ZipSource> src;
+        uint32_t entry = 0;
+        bool zip64 = false;
+        uint64_t limit = 0;             // 原始字节上限（非 ZIP64 条目压缩后不能超过 32 位）
+        bool started = false;
+        uint32_t crc = 0;
+        uint64_t total = 0;
+        std::vector<uint8_t> ahead;     // 预读的下一块，用来判断当前块是不是最后一块
+        std::vector<uint8_t> tail;      // 上一块末尾 32K（下一块的字典）
+    };
+
+    enum State { S_DATA, S_TRAILER, S_DONE };
+
+    // ---- little-endian output ----
+    static void Put16(std::vector<uint8_t>& v, uint32_t x) { v.push_back((uint8_t)x); v.push_back((uint8_t)(x >> 8)); }
+    static void Put32(std::vector<uint8_t>& v, uint32_t x) { Put16(v, x & 0xFFFF); Put16(v, x >> 16); }
+    static void Put64(std::vector<uint8_t>& v, uint64_t x) { Put32(v, (uint32_t)x); Put32(v, (uint32_t)(x >> 32)); }
+
+    // ---- executor tasks ----
+    // 每个在压的块借一个 Deflater（哈希表不小），流结束时随对象释放
+    std::unique_ptr<Deflater> BorrowDeflater() {
+        std::lock_guard<std::mutex> lock(m_mu);
+        if (m_idleDeflaters.empty()) return std::unique_ptr<Deflater>(new Deflater());
+        std::unique_ptr<Deflater> z = std::move(m_idleDeflaters.back());
+        m_idleDeflaters.pop_back();
+        return z;
+    }
+
+    void CompressTask(Chunk* c) {
+        // 流已被丢弃：不必再压，只把块标成完成
+        if (!m_cancel.Cancelled()) {
+            std::unique_ptr<Deflater> z = BorrowDeflater();
+            Compress(*z, *c);
+            std::lock_guard<std::mutex> lock(m_mu);
+            m_idleDeflaters.push_back(std::move(z));
+        }
+        // 持锁通知：析构一看到 m_outstanding 为 0 就会销毁 m_cvDone
+        std::lock_guard<std::mutex> lock(m_mu);
+        c->done = true;
+        --m_outstanding;
+        m_cvDone.notify_all();
+    }
+
+    static void Compress(Deflater& z, Chunk& c) {
+        c.out.reserve(c.raw.size() / 2 + 64);
+        z.Compress(c.dict.data(), c.dict.size(), c.raw.data(), c.raw.size(), c.last, c.out);
+        std::vector<uint8_t>().swap(c.raw);
+        std::vector<uint8_t>().swap(c.dict);
+    }
+
+    void Submit(std::unique_ptr<Chunk> c) {
+        Chunk* p = c.get();
+        p->rawSize = p->raw.size();
+        m_inflightBytes += p->rawSize;
+        m_pending.push_back(std::move(c));
+        if (p->store) {
+            p->out.swap(p->raw);
+            p->done = true;
+            return;
+        }
+        if (!m_exec) {
+            Compress(m_syncDeflater, *p);
+            p->done = true;
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mu);
+            ++m_outstanding;
+        }
+        m_exec->Submit(PRIORITY_BULK, [this, p] { CompressTask(p); });
+    }
+
+    size_t ReadFull(ZipSource& src, uint8_t* dst, size_t n) {
+        size_t got = 0;
+        while (got < n) {
+            size_t k = src.Read(dst + got, n - got);
+            if (k == 0) break;
+            got += k;
+        }
+        return got;
+    }
+
+    void ReadAhead(Feed& f) {
+        f.ahead.resize(m_chunkBytes);
+        size_t cap = m_chunkBytes;
+        uint64_t room = f.limit > f.total ? f.limit - f.total : 0;
+        if (room < cap) cap = (size_t)room;
+        f.ahead.resize(ReadFull(*f.src, f.ahead.data(), cap));
+    }
+
+    // 读一块交给压缩；没有可读的了返回 false
+    bool FeedOne() {
+        while (!m_feed.src) {
+            if (m_feedNext >= m_entries.size()) return false;
+            uint32_t idx = m_feedNext++;
+            const ZipEntry& e = m_entries[idx];
+            if (e.isDir) {
+                std::unique_ptr<Chunk> c(new Chunk());
+                c->entry = idx;
+                c->first = c->last = true;
+                c->store = true;
+                Submit(std::move(c));
+                return true;
+            }
+            std::unique_ptr<ZipSource> src = m_input->Open(e);
+            if (!src) continue;
+            m_feed = Feed();
+            m_feed.src = std::move(src);
+            m_feed.entry = idx;
+            m_feed.zip64 = ZipNeedsZip64(e.sizeHint, e.store, m_chunkBytes);
+            m_feed.limit = m_feed.zip64 ? UINT64_MAX : e.store ? 0xFFFFFFFFull : m_deflateLimit;
+            ReadAhead(m_feed);
+        }
+
+        const ZipEntry& e = m_entries[m_feed.entry];
+        std::unique_ptr<Chunk> c(new Chunk());
+        c->entry = m_feed.entry;
+        c->zip64 = m_feed.zip64;
+        c->first = !m_feed.started;
+        c->raw.swap(m_feed.ahead);
+        m_feed.started = true;
+        // 同一条目的方法以第一块为准；空文件按存储写，长度 0
+        if (c->first) m_entryStore = e.store || c->raw.empty();
+        c->store = m_entryStore;
+        m_feed.crc = Crc32(m_feed.crc, c->raw.data(), c->raw.size());
+        m_feed.total += c->raw.size();
+
+        if (!c->raw.empty()) ReadAhead(m_feed);
+        c->last = m_feed.ahead.empty();
+
+        if (!c->store) {
+            c->dict = m_feed.tail;
+            size_t keep = std::min(c->raw.size(), (size_t)Deflater::WINDOW);
+            if (keep == Deflater::WINDOW || m_feed.tail.empty()) {
+                m_feed.tail.assign(c->raw.end() - keep, c->raw.end());
+            } else {
+                m_feed.tail.insert(m_feed.tail.end(), c->raw.begin(), c->raw.end());
+                if (m_feed.tail.size() > Deflater::WINDOW) {
+                    m_feed.tail.erase(m_feed.tail.begin(), m_feed.tail.end() - Deflater::WINDOW);
+                }
+            }
+        }
+
+        if (c->last) {
+            c->crc = m_feed.crc;
+            c->rawTotal = m_feed.total;
+            m_feed = Feed();
+        }
+        Submit(std::move(c));
+        return true;
+    }
+
+    void Fill() {
+        while (m_pending.size() < m_window && m_inflightBytes < m_windowBytes) {
+            if (!FeedOne()) break;
+        }
+    }
+
+    // ---- records ----
+    void LocalHeader(const ZipEntry& e, bool store, bool zip64) {
+        m_entryOffset = m_offset;
+        uint16_t flags = 0x0800;        // UTF-8 名称
+        if (!e.isDir) flags |= 0x0008;  // 大小在数据描述符里
+        std::vector<uint8_t>& v = m_out;
+        size_t start = v.size();
+        Put32(v, 0x04034b50);
+        Put16(v, zip64 ? 45 : 20);
+        Put16(v, flags);
+        Put16(v, store ? 0 : 8);
+        Put16(v, e.dosTime);
+        Put16(v, e.dosDate);
+        Put32(v, 0);                            // crc
+        Put32(v, zip64 ? 0xFFFFFFFFu : 0);      // compressed
+        Put32(v, zip64 ? 0xFFFFFFFFu : 0);      // uncompressed
+        Put16(v, (uint32_t)e.name.size());
+        Put16(v, zip64 ? 20 : 0);
+        v.insert(v.end(), e.name.begin(), e.name.end());
+        if (zip64) {
+            Put16(v, 0x0001);
+            Put16(v, 16);
+            Put64(v, 0);
+            Put64(v, 0);
+        }
+        m_offset += v.size() - start;
+        m_entryCompressed = 0;
+    }
+
+    void DataDescriptor(uint32_t crc, uint64_t csize, uint64_t usize, bool zip64) {
+        std::vector<uint8_t>& v = m_out;
+        size_t start = v.size();
+        Put32(v, 0x08074b50);
+        Put32(v, crc);
+        if (zip64) { Put64(v, csize); Put64(v, usize); }
+        else { Put32(v, (uint32_t)csize); Put32(v, (uint32_t)usize); }
+        m_offset += v.size() - start;
+    }
+
+    void CentralRecord(const ZipEntry& e, bool store, bool zip64, uint32_t crc, uint64_t csize, uint64_t usize) {
+        bool bigU = zip64 || usize >= 0xFFFFFFFFull;
+        bool bigC = zip64 || csize >= 0xFFFFFFFFull;
+        bool bigO = m_entryOffset >= 0xFFFFFFFFull;
+        uint16_t extra = (uint16_t)((bigU ? 8 : 0) + (bigC ? 8 : 0) + (bigO ? 8 : 0));
+        uint16_t flags = 0x0800;
+        if (!e.isDir) flags |= 0x0008;
+
+        std::vector<uint8_t>& v = m_central;
+        Put32(v, 0x02014b50);
+        Put16(v, 63);                           // made by: 6.3, MS-DOS
+        Put16(v, (zip64 || extra) ? 45 : 20);
+        Put16(v, flags);
+        Put16(v, store ? 0 : 8);
+        Put16(v, e.dosTime);
+        Put16(v, e.dosDate);
+        Put32(v, crc);
+        Put32(v, bigC ? 0xFFFFFFFFu : (uint32_t)csize);
+        Put32(v, bigU ? 0xFFFFFFFFu : (uint32_t)usize);
+        Put16(v, (uint32_t)e.name.size());
+        Put16(v, extra ? extra + 4u : 0u);
+        Put16(v, 0);                            // comment
+        Put16(v, 0);                            // disk
+        Put16(v, 0);                            // internal attr
+        Put32(v, e.isDir ? 0x10 : 0x20);        // FILE_ATTRIBUTE_DIRECTORY / ARCHIVE
+        Put32(v, bigO ? 0xFFFFFFFFu : (uint32_t)m_entryOffset);
+        v.insert(v.end(), e.name.begin(), e.name.end());
+        if (extra) {
+            Put16(v, 0x0001);
+            Put16(v, extra);
+            if (bigU) Put64(v, usize);
+            if (bigC) Put64(v, csize);
+            if (bigO) Put64(v, m_entryOffset);
+        }
+        m_written++;
+    }
+
+    void Trailer() {
+        uint64_t cdOffset = m_offset;
+        uint64_t cdSize = m_central.size();
+        m_out.insert(m_out.end(), m_central.begin(), m_central.end());
+        std::vector<uint8_t>().swap(m_central);
+        m_offset += cdSize;
+
+        std::vector<uint8_t>& v = m_out;
+        bool zip64 = m_written >= 0xFFFF || cdSize >= 0xFFFFFFFFull || cdOffset >= 0xFFFFFFFFull;
+        if (zip64) {
+            uint64_t eocd64 = m_offset;
+            Put32(v, 0x06064b50);
+            Put64(v, 44);
+            Put16(v, 45);
+            Put16(v, 45);
+            Put32(v, 0);
+            Put32(v, 0);
+            Put64(v, m_written);
+            Put64(v, m_written);
+            Put64(v, cdSize);
+            Put64(v, cdOffset);
+            Put32(v, 0x07064b50);
+            Put32(v, 0);
+            Put64(v, eocd64);
+            Put32(v, 1);
+        }
+        Put32(v, 0x06054b50);
+        Put16(v, 0);
+        Put16(v, 0);
+        Put16(v, m_written >= 0xFFFF ? 0xFFFF : m_written);
+        Put16(v, m_written >= 0xFFFF ? 0xFFFF : m_written);
+        Put32(v, cdSize >= 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)cdSize);
+        Put32(v, cdOffset >= 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)cdOffset);
+        Put16(v, 0);
+    }
+
+    // 产生下一段输出；全部结束返回 false
+    bool Advance() {
+        if (m_state == S_DONE) return false;
+        if (m_state == S_TRAILER) {
+            Trailer();
+            m_state = S_DONE;
+            return true;
+        }
+
+        Fill();
+        if (m_pending.empty()) {
+            m_state = S_TRAILER;
+            return true;
+        }
+
+        Chunk& c = *m_pending.front();
+        if (!c.done) {
+            std::unique_lock<std::mutex> lock(m_mu);
+            m_cvDone.wait(lock, [&c] { return c.done; });
+        }
+
+        const ZipEntry& e = m_entries[c.entry];
+        if (c.first) LocalHeader(e, c.store, c.zip64);
+
+        m_out.insert(m_out.end(), c.out.begin(), c.out.end());
+        m_offset += c.out.size();
+        m_entryCompressed += c.out.size();
+
+        if (c.last) {
+            if (!e.isDir) DataDescriptor(c.crc, m_entryCompressed, c.rawTotal, c.zip64);
+            CentralRecord(e, c.store, c.zip64, c.crc, m_entryCompressed, c.rawTotal);
+        }
+
+        m_inflightBytes -= c.rawSize;
+        m_pending.pop_front();
+        return true;
+    }
+
+    std::vector<ZipEntry> m_entries;
+    ZipInput* m_input;
+    Executor* m_exec;
+    size_t m_chunkBytes;
+    size_t m_window = 8;
+    size_t m_windowBytes = 0;
+    uint64_t m_deflateLimit = 0;    // ZipRawLimit(false)，构造时算一次
+
+    // 读取侧
+    Feed m_feed;
+    uint32_t m_feedNext = 0;
+    bool m_entryStore = false;
+    Deflater m_syncDeflater;
+
+    // 按输出顺序排队的块
+    std::deque<std::unique_ptr<Chunk>> m_pending;
+    size_t m_inflightBytes = 0;
+
+    // 执行器上在压的块
+    std::mutex m_mu;
+    std::condition_variable m_cvDone;
+    size_t m_outstanding = 0;
+    std::vector<std::unique_ptr<Deflater>> m_idleDeflaters;
+    CancelSource m_cancel;
+
+    // 输出侧
+    State m_state = S_DATA;
+    std::vector<uint8_t> m_out;
+    size_t m_outPos = 0;
+    uint64_t m_offset = 0;
+    uint64_t m_entryOffset = 0;
+    uint64_t m_entryCompressed = 0;
+    std::vector<uint8_t> m_central;
+    uint32_t m_written = 0;
+    uint64_t m_produced = 0;
+};
+
+} // namespace relay